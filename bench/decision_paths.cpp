@@ -0,0 +1,247 @@
+/**
+ * Latency of the scheduling decision path on synthetic clusters
+ *
+ * Copyright 2017 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Measures the functions evaluated for every job start and co-scheduling decision on clusters of 16 up to 100k
+ * nodes with two slots of 8 CPUs each. Slot 0 of every node is used by jobs spanning 16 nodes. A new job uses
+ * slot 1 of 4 nodes and overloads them, slot 1 of all other nodes is free. The clusters are restored into
+ * controllers without agents, i.e. nothing is started and no privileges are required. The hosts files written by
+ * generate_command are kept in a temporary directory. Usage:
+ *
+ *   decision_paths [iterations] [max nodes]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <fast-lib/message/migfra/task.hpp>
+
+#include "poncos/controller_cgroup.hpp"
+#include "poncos/controller_offline.hpp"
+#include "poncos/scheduler_multi_app.hpp"
+
+constexpr size_t NODES_PER_JOB = 16;
+constexpr unsigned int CPUS_PER_SLOT = 8;
+// nodes of the new job, all of them are overloaded
+constexpr size_t NEW_JOB_NODES = 4;
+// membw utilization of a slot (fraction of the capacity), the jobs on slot 0 use 10-40% of the node
+constexpr double NEW_JOB_UTIL = 0.6;
+constexpr double CORUNNER_UTIL = 0.4;
+
+// results of the measured functions, keeps the compiler from dropping the calls
+static size_t sink = 0;
+
+// runs fn iterations times and prints the mean, median and 99th percentile in us
+static void bench(const std::string &name, const size_t iterations, const std::function<void()> &fn) {
+	std::vector<double> times;
+	times.reserve(iterations);
+	for (size_t i = 0; i < iterations; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+		times.push_back(duration.count());
+	}
+	std::sort(times.begin(), times.end());
+
+	const double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+	std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1);
+	std::cout << " mean: " << std::setw(10) << mean << " us";
+	std::cout << "  median: " << std::setw(10) << times[times.size() / 2] << " us";
+	std::cout << "  p99: " << std::setw(10) << times[times.size() * 99 / 100] << " us" << std::endl;
+}
+
+static system_configT synthetic_config() {
+	system_configT config;
+	for (unsigned int s = 0; s < 2; ++s) {
+		std::vector<unsigned int> cpus(CPUS_PER_SLOT);
+		std::iota(cpus.begin(), cpus.end(), s * CPUS_PER_SLOT);
+		config.slots.emplace_back(cpus, std::vector<unsigned int>{s});
+	}
+	return config;
+}
+
+static YAML::Node synthetic_job(const size_t id, const controllerT::execute_config &config) {
+	YAML::Node job;
+	job["id"] = id;
+	job["job"] = jobT(config.size(), CPUS_PER_SLOT, "/bin/true", true);
+	job["config"] = config;
+	job["cores"] = std::vector<size_t>();
+	job["memory"] = 0;
+	job["pid"] = 0;
+	job["start-time"] = 0;
+	job["frozen"] = false;
+	return job;
+}
+
+// controller snapshot of a cluster of nodes, see above. The new job has the highest id.
+static YAML::Node synthetic_cluster(const system_configT &config, const size_t nodes) {
+	YAML::Node snapshot;
+	std::vector<std::string> lines;
+	for (size_t n = 0; n < nodes; ++n) {
+		lines.push_back("node" + std::to_string(n) + " membw=100");
+	}
+	snapshot["machines"] = lines;
+	snapshot["node-slots"] = std::vector<std::vector<slotT>>(nodes, config.slots);
+
+	snapshot["jobs"] = YAML::Node(YAML::NodeType::Sequence);
+	for (size_t id = 0; id < nodes / NODES_PER_JOB; ++id) {
+		controllerT::execute_config job_config;
+		for (size_t n = 0; n < NODES_PER_JOB; ++n) {
+			job_config.emplace_back(id * NODES_PER_JOB + n, 0);
+		}
+
+		snapshot["jobs"].push_back(synthetic_job(id, job_config));
+	}
+
+	size_t id = nodes / NODES_PER_JOB;
+	if (nodes >= NEW_JOB_NODES) {
+		controllerT::execute_config job_config;
+		for (size_t n = 0; n < NEW_JOB_NODES; ++n) {
+			job_config.emplace_back(n, 1);
+		}
+		snapshot["jobs"].push_back(synthetic_job(id++, job_config));
+	}
+	snapshot["counter"] = id;
+
+	for (const auto key : {"drained", "removed", "released"}) {
+		snapshot[key] = YAML::Node(YAML::NodeType::Sequence);
+	}
+	snapshot["state"] = YAML::Node();
+	return snapshot;
+}
+
+// the cgroup controller without agents, generate_command only reads the machines and slots
+class cgroup_benchT : public cgroup_controller {
+  public:
+	cgroup_benchT(const system_configT &system_config) : cgroup_controller(nullptr, "", system_config) {}
+	~cgroup_benchT() {
+		restore(synthetic_cluster(system_config, 0));
+		done();
+	}
+
+	using cgroup_controller::generate_command;
+};
+
+static void bench_task_container(const size_t iterations) {
+	// the task sent to an agent to create the cgroup of a slot, see cgroup_controller::create_domain
+	auto task = std::make_shared<fast::msg::migfra::Start>();
+	task->vm_name = "poncos_42";
+	task->vcpu_map = std::vector<std::vector<unsigned int>>{synthetic_config().slots[0].cpus};
+	task->memnode_map = std::vector<std::vector<unsigned int>>{{0}};
+	fast::msg::migfra::Task_container container;
+	container.tasks.push_back(task);
+
+	std::cout << "Task_container" << std::endl;
+	bench("to_string", iterations, [&] { sink += container.to_string().size(); });
+	const std::string message = container.to_string();
+	bench("from_string", iterations, [&] {
+		fast::msg::migfra::Task_container parsed;
+		parsed.from_string(message);
+		sink += parsed.tasks.size();
+	});
+}
+
+static void bench_cluster(const system_configT &config, const size_t nodes, const size_t iterations) {
+	std::cout << nodes << " nodes" << std::endl;
+	const YAML::Node snapshot = synthetic_cluster(config, nodes);
+
+	controller_capabilitiesT capabilities;
+	capabilities.update = true;
+	offline_controllerT controller(config, capabilities);
+	controller.restore(snapshot);
+
+	multi_app_sched scheduler(config);
+	scheduler.track_machines(controller);
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<double> utilization(0.1, CORUNNER_UTIL);
+	for (size_t m = 0; m < nodes; ++m) {
+		scheduler.util[m][0].membw = utilization(generator) * scheduler.capacity[m].membw;
+	}
+
+	const size_t new_job = nodes / NODES_PER_JOB;
+	const controllerT::execute_config job_config = controller.id_to_config[new_job];
+	for (const auto &c : job_config) {
+		scheduler.util[c.first][0].membw = CORUNNER_UTIL * scheduler.capacity[c.first].membw;
+		scheduler.util[c.first][1].membw = NEW_JOB_UTIL * scheduler.capacity[c.first].membw;
+	}
+	const auto marked = scheduler.check_resources(controller, job_config);
+	const auto candidates = scheduler.find_swap_candidates(controller, marked);
+	const auto new_config = scheduler.generate_new_config(job_config, marked, candidates);
+	if (marked.size() != NEW_JOB_NODES || new_config.empty()) {
+		std::cerr << "the new job cannot be swapped" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	bench("check_resources", iterations, [&] { sink += scheduler.check_resources(controller, job_config).size(); });
+	bench("find_swap_candidates", iterations,
+		  [&] { sink += scheduler.find_swap_candidates(controller, marked).size(); });
+	bench("generate_new_config", iterations,
+		  [&] { sink += scheduler.generate_new_config(job_config, marked, candidates).size(); });
+	// all free slots are requested, i.e. the predicate checks every node
+	const size_t free_cpus = (nodes - NEW_JOB_NODES) * CPUS_PER_SLOT;
+	bench("wait_for_ressource", iterations, [&] { controller.wait_for_ressource(free_cpus, 1); });
+
+	// swaps the new job back and forth
+	bool swapped = false;
+	bench("update_config", iterations, [&] {
+		controller.update_config(new_job, swapped ? job_config : new_config);
+		swapped = !swapped;
+	});
+
+	// the command of a job spanning NODES_PER_JOB nodes
+	cgroup_benchT cgroup(config);
+	cgroup.restore(snapshot);
+	const jobT job = controller.id_to_job[0];
+	bench("generate_command", iterations,
+		  [&] { sink += cgroup.generate_command(job, 0, controller.id_to_config[0]).size(); });
+}
+
+int main(int argc, char const *argv[]) {
+	const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 100;
+	const size_t max_nodes = argc > 2 ? std::stoul(argv[2]) : 100000;
+	if (iterations == 0) {
+		std::cerr << "usage: " << argv[0] << " [iterations] [max nodes]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+#ifdef FASTLIB_ENABLE_LOGGING
+	// restoring a cluster logs every node, only warnings are of interest here
+	spdlog::set_level(spdlog::level::warn);
+#endif
+
+	// generate_command writes the hosts file of the job to the working directory
+	char dir_template[] = "/tmp/poncos_bench_XXXXXX";
+	const std::string dir(mkdtemp(dir_template));
+	if (chdir(dir.c_str()) != 0) return EXIT_FAILURE;
+
+	bench_task_container(iterations);
+	const system_configT config = synthetic_config();
+	for (const size_t nodes : {16, 256, 4096, 100000}) {
+		if (nodes > max_nodes) break;
+		bench_cluster(config, nodes, iterations);
+	}
+
+	DIR *entries = opendir(dir.c_str());
+	while (const dirent *entry = readdir(entries)) {
+		if (entry->d_name[0] != '.') unlink(entry->d_name);
+	}
+	closedir(entries);
+	rmdir(dir.c_str());
+	return sink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/**
+ * Startup latency of the slot launcher compared to cgroup_wrapper.sh
+ *
+ * Copyright 2017 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Starts /bin/true repeatedly directly, through the shell wrapper and through poncos_launch.
+ * Both join a mock cgroup in a temporary directory, so no privileges are required. Usage:
+ *
+ *   launcher_startup <path to cgroup_wrapper.sh> <path to poncos_launch> [iterations]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const std::string DOMAIN = "poncos_bench";
+
+// runs the command once, returns the time until it terminated in us
+static double run(const std::vector<std::string> &command) {
+	std::vector<char *> args;
+	for (const auto &arg : command) {
+		args.push_back(const_cast<char *>(arg.c_str()));
+	}
+	args.push_back(nullptr);
+
+	const auto start = std::chrono::steady_clock::now();
+	const pid_t pid = fork();
+	if (pid == 0) {
+		// silence the output of the wrapper
+		if (freopen("/dev/null", "w", stdout) == nullptr) _exit(EXIT_FAILURE);
+		execv(args[0], args.data());
+		_exit(EXIT_FAILURE);
+	}
+
+	int status;
+	waitpid(pid, &status, 0);
+	const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		std::cerr << "'" << command[0] << "' failed" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	return duration.count();
+}
+
+static void bench(const std::string &name, const std::vector<std::string> &command, const size_t iterations) {
+	std::vector<double> times;
+	times.reserve(iterations);
+	for (size_t i = 0; i < iterations; ++i) {
+		times.push_back(run(command));
+	}
+	std::sort(times.begin(), times.end());
+
+	const double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+	std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1);
+	std::cout << " mean: " << std::setw(9) << mean << " us";
+	std::cout << "  median: " << std::setw(9) << times[times.size() / 2] << " us";
+	std::cout << "  p99: " << std::setw(9) << times[times.size() * 99 / 100] << " us" << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+	if (argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <cgroup_wrapper.sh> <poncos_launch> [iterations]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::string wrapper(argv[1]);
+	const std::string launcher(argv[2]);
+	const size_t iterations = argc > 3 ? std::stoul(argv[3]) : 200;
+
+	// mock cgroup
+	char root_template[] = "/tmp/poncos_bench_XXXXXX";
+	const std::string root(mkdtemp(root_template));
+	const std::string cgroup = root + "/" + DOMAIN;
+	mkdir(cgroup.c_str(), 0755);
+	std::ofstream(cgroup + "/tasks").close();
+	setenv("CGROUP_ROOT", root.c_str(), 1);
+
+	std::cout << iterations << " launches of /bin/true" << std::endl;
+	bench("direct", {"/bin/true"}, iterations);
+	bench("cgroup_wrapper", {"/bin/bash", wrapper, DOMAIN, "/bin/true"}, iterations);
+	bench("poncos_launch", {launcher, DOMAIN, "--cpus", "0", "--cgroup-dir", cgroup, "--", "/bin/true"}, iterations);
+
+	unlink((cgroup + "/tasks").c_str());
+	rmdir(cgroup.c_str());
+	rmdir(root.c_str());
+}
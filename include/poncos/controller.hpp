@@ -2,34 +2,94 @@
 #define poncos_controller
 
 #include <array>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <fast-lib/message/migfra/result.hpp>
 #include <fast-lib/message/migfra/task.hpp>
-#include <fast-lib/message/migfra/time_measurement.hpp>
 #include <fast-lib/mqtt_communicator.hpp>
 
+#include <sys/types.h>
+
+#include "poncos/event_trace.hpp"
 #include "poncos/job.hpp"
+#include "poncos/job_table.hpp"
+#include "poncos/journal.hpp"
+#include "poncos/metrics.hpp"
 #include "poncos/poncos.hpp"
+#include "poncos/slot_table.hpp"
 #include "poncos/system_config.hpp"
 
+// aggregated capacity of all machines of a controller, e.g. reported to a top-level dispatcher
+struct capacity_summaryT {
+	size_t machines = 0;
+	size_t drained = 0;
+	// CPUs of all machines that are not drained
+	size_t total_cpus = 0;
+	size_t free_cpus = 0;
+	// largest memory (MiB) left on a single machine, numeric_limits<size_t>::max() if memory is not constrained
+	size_t free_memory = 0;
+	// largest job the machines can run once they are idle: the CPUs of one slot per machine (drained ones included)
+	// and the memory of the largest machine
+	size_t max_job_cpus = 0;
+	size_t max_job_memory = 0;
+	size_t running = 0;
+	// number of jobs started so far, i.e. the id of the next job
+	size_t started = 0;
+	// load reported by the scheduler, e.g. the average dominant share of the resources (0..1)
+	double load = 0;
+};
+
+// handling of the jobs running on a drained machine
+enum class drain_policyT { keep, kill };
+drain_policyT drain_policy_from_string(const std::string &policy);
+
 class controllerT {
   public:
 	// entries in the vector are read as: (machine index in machinefiles, #slot)
 	using execute_config_elemT = std::pair<size_t, size_t>;
 	using execute_config = std::vector<execute_config_elemT>;
-	// index = entry in machines, pair = both slots, numeric_limits<size_t>::max if empty
-	using slot_allocationT = std::vector<size_t>;
-	using machine_usageT = std::vector<slot_allocationT>;
+	// slot layout of a host without config= in the machine file, e.g. generated from its topology
+	using node_config_sourceT = std::function<system_configT(const std::string &host)>;
+	// index = entry in machines, slot; numeric_limits<size_t>::max if empty
+	using machine_usageT = slot_tableT<size_t>;
+	// index = machine, slot, CPU index within the slot; id of the job using the CPU or numeric_limits<size_t>::max
+	using core_usageT = std::vector<std::vector<std::vector<size_t>>>;
+
+	// marks a slot in machine_usage that is shared by several sub-slot jobs, see core_usage for the owners
+	static constexpr size_t shared_slot = std::numeric_limits<size_t>::max() - 1;
+	// returned by execute() if a machine of the job was drained while its domains were created
+	static constexpr size_t not_started = std::numeric_limits<size_t>::max();
+
+	// a job started by the controller, the entry is reused once the job completed and its thread was joined
+	struct job_entryT {
+		jobT job;
+		execute_config config;
+		// CPU indices within the slot of sub-slot jobs, empty if the whole slots are used
+		std::vector<size_t> cores;
+		size_t memory = 0;
+		// process of the job (pid, start time in clock ticks after boot) to detect pid reuse after a restart
+		std::pair<pid_t, unsigned long long> process;
+		bool running = false;
+		bool frozen = false;
+		std::chrono::steady_clock::time_point frozen_since;
+		// waits for the completion of the job
+		std::thread thread;
+	};
 
   public:
+	// hosts without config= use the layout of node_configs or the global system_config if there is no source
 	controllerT(std::shared_ptr<fast::MQTT_communicator> _comm, const std::string &machine_filename,
-				const system_configT &system_config);
+				const system_configT &system_config, node_config_sourceT node_configs = nullptr);
 	virtual ~controllerT();
 
 	virtual void init() = 0;
@@ -52,17 +112,119 @@ class controllerT {
 	virtual void update_config(const size_t id, const execute_config &new_config) = 0;
 	virtual bool update_supported() = 0;
 
-	size_t execute(const jobT &job, const execute_config &config, std::function<void(size_t)> callback);
+	// sets the memory bandwidth allocation (in percent) of all domains with the supplied id, 0 restores the
+	// settings of their slots
+	virtual void set_mba(const size_t id, const unsigned int mba) = 0;
+	// current memory bandwidth allocation of the domains with the supplied id (100 == unrestricted)
+	virtual unsigned int get_mba(const size_t id) const = 0;
+	virtual bool mba_supported() = 0;
+
+	// changes the slot boundaries of machine (e.g. 16/8 instead of 12/12 CPUs) and resizes the cpusets of the
+	// domains running on it. The layout is reset to the node config once a job on the machine completes.
+	void resize_slots(const size_t machine, const std::vector<slotT> &new_layout);
+	virtual bool resize_supported() = 0;
+
+	// returns the id of the job or not_started, nothing is left on the machines in this case and the callback is
+	// not called. queue_id is the id of the job in the job queue, it is recorded with the start event to relate
+	// both ids.
+	size_t execute(const jobT &job, const execute_config &config, std::function<void(size_t)> callback,
+				   const size_t queue_id = std::numeric_limits<size_t>::max());
+	// starts a job on the CPUs with the supplied indices of a single slot, the slot can be shared with other
+	// sub-slot jobs
+	size_t execute(const jobT &job, const execute_config_elemT &slot, const std::vector<size_t> &cores,
+				   std::function<void(size_t)> callback, const size_t queue_id = std::numeric_limits<size_t>::max());
+	virtual bool subslot_supported() = 0;
+	// consumes the next id without starting a job, e.g. for a job that can never be started, i.e. the ids of the
+	// controller stay the ones of the job queue
+	void reject();
 
-	void wait_for_ressource(const size_t, const size_t);
+	// waits until enough machines have slots_per_host unused slots with requested CPUs in total, only machines
+	// with memory (MiB) left are considered
+	void wait_for_ressource(const size_t requested, const size_t slots_per_host, const size_t memory = 0);
+	// waits until any slot has at least requested unused CPUs on a machine with memory (MiB) left
+	void wait_for_cores(const size_t requested, const size_t memory = 0);
 	void wait_for_change();
-	void wait_for_completion_of(const size_t);
+	// waits until the job with id completed, the controller is unlocked afterwards
+	void wait_for_completion_of(const size_t id);
 	void done();
 
+	// sets an environment variable of all jobs started afterwards
+	void set_job_env(const std::string &name, const std::string &value);
+
 	// unlock the controller, should typically not called by hand
 	void unlock();
 
+	// records all state changes in the journal, jobs survive a crash as they run in their own process group
+	void use_journal(std::shared_ptr<journalT> journal);
+	// restores the state stored in the journal and adopts the jobs still running, i.e. callback is called once
+	// they completed. Jobs frozen before the restart are thawed. Returns false if the journal is empty. Must be
+	// called before init().
+	bool recover(std::function<void(size_t)> callback);
+	// true if the state was recovered, init() keeps the running domains
+	bool recovered() const { return _recovered; }
+	// true if the job with id is running
+	bool running(const size_t id) const;
+	// machines, slot layouts and running jobs, as stored in the snapshots of the journal
+	YAML::Node snapshot() const { return emit_snapshot(); }
+	// replaces machines and jobs with the ones of a snapshot, the jobs are neither started nor stopped. Only
+	// supported without communicator, e.g. to replay recorded decisions offline.
+	void restore(const YAML::Node &snapshot);
+
+	// records the lifecycle events of the jobs in trace
+	void use_trace(std::shared_ptr<event_traceT> trace);
+	// does nothing without trace
+	void record_event(const event_typeT type, const size_t id, const size_t machine = event_traceT::none,
+					  const size_t peer = event_traceT::none) const;
+
+	// publishes the slot occupancy, job counts and freeze durations, the machines are labeled by their host name
+	void use_metrics(std::shared_ptr<metricsT> metrics);
+
+	// every request to an agent must be answered within deadline (0 waits forever), idempotent requests are
+	// resent up to retries times. Machines whose agent misses the deadline are drained.
+	void set_agent_deadline(const std::chrono::milliseconds deadline, const size_t retries,
+							const drain_policyT policy);
+	// waits for the reply of the agent of machine on topic, resend repeats an idempotent request. Drains the
+	// machine and returns false if the deadline was missed, returns false immediately for drained machines.
+	bool await_agent(const size_t machine, const std::string &topic, std::string &reply,
+					 const std::function<void()> &resend = nullptr);
+	// capacity summary as of the last job start or completion, safe to be called from any thread
+	capacity_summaryT summary() const;
+	// sets the load of the summary
+	void set_load(const double load);
+
+	// queues adding a host (a line of the machine file) or removing it, safe to be called from any thread. The
+	// changes are applied by the scheduler the next time it waits for resources. No further jobs are started on a
+	// removed host, its domains are torn down once its jobs completed. A removed host may be added again.
+	void add_machine(const std::string &line);
+	void remove_machine(const std::string &host);
+	// queues adding all hosts of lines (the lines of a machine file) and removing all others
+	void sync_machines(const std::vector<std::string> &lines);
+
+	// no further jobs are started on machine, its jobs are killed or keep running depending on the drain policy.
+	// Requests to its agents are skipped until the machine is undrained.
+	void drain(const size_t machine);
+	// accepts jobs on a drained machine again
+	void undrain(const size_t machine);
+
 	execute_config generate_opposing_config(const size_t id) const;
+	// name of the domain (cgroup/resctrl group) and log files of id
+	std::string cmd_name_from_id(const size_t id) const;
+	// ids of all jobs running on the slot
+	std::vector<size_t> domains_on(const execute_config_elemT &config_elem) const;
+	// CPUs of the slot used by id
+	std::vector<unsigned int> cpus_of(const size_t id, const execute_config_elemT &config_elem) const;
+	// indices of the unused CPUs of the slot
+	std::vector<size_t> free_cores(const execute_config_elemT &config_elem) const;
+	// memory in MiB reserved by the jobs running on machine
+	size_t used_memory(const size_t machine) const;
+	// true if memory (MiB) fits next to the jobs running on machine, always true if the capacity is unknown
+	bool memory_fits(const size_t machine, const size_t memory) const;
+	// true if new jobs may be started on machine, i.e. it is not drained and memory (MiB) fits
+	bool admits(const size_t machine, const size_t memory) const;
+	// raises the memory reserved per node by id to the measured footprint (MiB)
+	void set_memory_footprint(const size_t id, const size_t memory);
+	// memory reserved per node by id in MiB, the requirement of the job or its measured footprint if larger
+	size_t memory_of(const size_t id) const;
 
 	// getters
 	// a list of all machines
@@ -70,23 +232,110 @@ class controllerT {
 	// numbers of total slots available
 	const size_t &available_slots;
 	// stores the current usage of the machines
-	// index = entry in machines, pair = both slots, numeric_limits<size_t>::max if empty
+	// index = entry in machines, slot; numeric_limits<size_t>::max if empty
 	const machine_usageT &machine_usage;
-	// maps ids to the execution configuration
-	const std::vector<execute_config> &id_to_config;
-	// maps ids to the jobs
-	const std::vector<jobT> &id_to_job;
+	// CPU usage of shared slots, only valid if machine_usage of the slot is shared_slot
+	const core_usageT &core_usage;
+	// maps ids to the execution configuration, valid for running jobs and within the completion callback
+	const job_table_fieldT<job_entryT, execute_config> id_to_config;
+	// maps ids to the jobs, see id_to_config
+	const job_table_fieldT<job_entryT, jobT> id_to_job;
 	// stores the slot configuration as defined by a specification in YAML format
 	const system_configT &system_config;
+	// slot layout per machine as defined in the machine file, system_config if not specified
+	const std::vector<system_configT> &node_config;
+	// calibrated memory bandwidth capacity per machine in GB/s, 0 if not specified
+	const std::vector<double> &membw_capacity;
+	// NIC and local I/O throughput capacity per machine in GB/s, 0 if not constrained
+	const std::vector<double> &net_capacity;
+	const std::vector<double> &io_capacity;
+	// memory capacity per machine in MiB, 0 if not constrained
+	const std::vector<size_t> &mem_capacity;
+	// current slot layout per machine, identical to node_config unless resized
+	const std::vector<std::vector<slotT>> &node_slots;
+	// number of jobs started so far, i.e. the id of the next job
+	const size_t &next_id;
+	// machines drained after their agents missed a deadline
+	const std::vector<bool> &drained;
+	// machines removed at runtime, their indices stay valid
+	const std::vector<bool> &removed;
 
   protected:
-	// executed by a new thread, calls system to start the application
-	void execute_command_internal(std::string command, size_t counter, const std::function<void(size_t)> &callback);
+	// executed by a new thread, waits for the completion of the application started as process pid
+	void execute_command_internal(std::string command, pid_t pid, size_t counter,
+								  const std::function<void(size_t)> &callback);
+	// executed by a new thread, waits for the completion of a job adopted by recover()
+	void adopt_command_internal(size_t counter, pid_t pid, unsigned long long start_time,
+								const std::function<void(size_t)> &callback);
+	// cleanup once the job with id completed, expects worker_counter_mutex to be locked
+	void finish(const size_t id, const std::function<void(size_t)> &callback);
 	virtual std::string generate_command(const jobT &command, size_t counter, const execute_config &config) const = 0;
-	virtual std::string domain_name_from_config_elem(const execute_config_elemT &config_elem) const = 0;
-	std::string cmd_name_from_id(const size_t id) const;
+	virtual std::string domain_name_from_config_elem(const execute_config_elemT &config_elem,
+													 const size_t id) const = 0;
+
+	// mpiexec arguments passing the domain name of id (PONCOS_JOB) and the job environment
+	std::string job_env_args(const size_t id) const;
+
+	// applies T to the domains of id on config, or to all domains on config if id is numeric_limits<size_t>::max
+	template <typename T> void suspend_resume_config(const execute_config &config, const size_t id);
+
+	// sends tasks to the migfra agent of machine, does nothing if the machine is drained
+	void send_tasks(const size_t machine, const fast::msg::migfra::Task_container &tasks);
+	// waits for the results of the tasks sent to machine, tasks are resent if idempotent (see await_agent())
+	bool receive_results(const size_t machine, fast::msg::migfra::Result_container &response, const bool idempotent);
+
+	// applies the current node_slots of machine to the domain of id
+	virtual void repin_domain(const size_t machine, const size_t id) = 0;
+	// resets the slot layout of machine to its node config, the domain of skip_id is not repinned
+	void reset_slots(const size_t machine, const size_t skip_id);
+
+	// appends a record of the controller to the journal, does nothing without journal or while recovering
+	void journal_record(YAML::Node record) const;
+	// state of derived controllers stored in snapshots and replay of the records they append
+	virtual YAML::Node emit_state() const { return YAML::Node(); }
+	virtual void load_state(const YAML::Node & /*node*/) {}
+	virtual void replay(const YAML::Node & /*record*/) {}
 
-	template <typename T> void suspend_resume_config(const execute_config &config);
+	// starts the domains of a machine added at runtime and tears down those of a removed machine once its jobs
+	// completed, both are called with worker_counter_mutex locked
+	virtual void machine_added(const size_t /*machine*/) {}
+	virtual void machine_removed(const size_t /*machine*/) {}
+
+  private:
+	void read_machine_file(const std::string &filename);
+	// appends host (a line of the machine file) and subscribes to its agents, returns its index
+	size_t append_machine(const std::string &line);
+	void reset_machines();
+	void subscribe_agents(const size_t machine);
+	void unsubscribe_agents(const size_t machine);
+	// waits until predicate holds, applies the changes of the machines while waiting
+	void wait_until(const std::function<bool()> &predicate);
+	// undrains the machines whose agents replied after they were drained, expects worker_counter_mutex to be locked
+	void probe_drained();
+	// the following expect worker_counter_mutex to be locked
+	void apply_machine_changes();
+	void add_machine_now(const std::string &line);
+	void remove_machine_now(const std::string &host);
+	// adds host or takes it back if it was removed, false if it is already used
+	bool add_machine_locked(const std::string &line, size_t &machine);
+	// tears down the domains of a removed machine without jobs
+	void release_machine(const size_t machine);
+	// no job runs on machine
+	bool idle(const size_t machine) const;
+	size_t start(const jobT &job, std::function<void(size_t)> callback, const size_t queue_id);
+	// joins the threads of completed jobs and frees their entries
+	void reclaim_jobs();
+
+	YAML::Node emit_snapshot() const;
+	void load_snapshot(const YAML::Node &node);
+	void replay_record(const YAML::Node &record);
+	// restores a job started before the restart
+	void restore_job(const size_t id, const jobT &job, const execute_config &config, const std::vector<size_t> &cores);
+	void release_job(const size_t id);
+	// terminates the job with id, its completion is handled as usual
+	void kill_job(const size_t id);
+	// recomputes the summary, expects worker_counter_mutex to be locked
+	void update_summary();
 
   protected:
 	// a counter that is increased with every new cgroup created
@@ -98,30 +347,56 @@ class controllerT {
 	std::condition_variable worker_counter_cv;
 	std::unique_lock<std::mutex> work_counter_lock;
 
-	// threads used to run the applications
-	std::vector<std::thread> thread_pool;
-
-	// maps ids to the thread_pool
-	// TODO shouldn't that index be identical?
-	std::vector<size_t> id_to_tpool;
-
 	// reference to a mqtt communictor
 	std::shared_ptr<fast::MQTT_communicator> comm;
 
-	// timestamps of job start/stop/migration
-	fast::msg::migfra::Time_measurement timestamps;
+	// job start/stop/freeze/migration events are recorded if set
+	std::shared_ptr<event_traceT> trace;
+
+	// utilization and latencies are published if set
+	std::shared_ptr<metricsT> metrics;
+
+	// state changes are recorded if set
+	std::shared_ptr<journalT> journal;
 
   private:
 	// see above for docu
 	size_t _available_slots;
 	std::vector<std::string> _machines;
+	// line of the machine file per machine
+	std::vector<std::string> _machine_lines;
+	// system configs per file name, configs used by multiple hosts are only loaded once
+	std::unordered_map<std::string, system_configT> _configs;
 	machine_usageT _machine_usage;
-	std::vector<execute_config> _id_to_config;
-	std::vector<jobT> _id_to_job;
+	core_usageT _core_usage;
+	// running jobs and completed jobs not reclaimed yet, indexed by id
+	job_tableT<job_entryT> _jobs;
+	std::vector<system_configT> _node_config;
+	std::vector<double> _membw_capacity;
+	std::vector<double> _net_capacity;
+	std::vector<double> _io_capacity;
+	std::vector<size_t> _mem_capacity;
+	std::vector<std::vector<slotT>> _node_slots;
+	std::vector<std::pair<std::string, std::string>> _job_env;
+	std::vector<bool> _drained;
+	std::vector<bool> _removed;
+	// removed machines whose domains were torn down
+	std::vector<bool> _released;
+	// queued changes of the machines: add (line), remove (host) or sync (lines)
+	std::vector<std::pair<std::string, std::vector<std::string>>> _machine_changes;
+	std::mutex machine_changes_mutex;
+	// last tasks sent per machine, resent if idempotent
+	std::vector<std::string> _sent_tasks;
+	std::chrono::milliseconds _agent_deadline;
+	size_t _agent_retries;
+	drain_policyT _drain_policy;
+	capacity_summaryT _summary;
+	mutable std::mutex summary_mutex;
+	bool _recovered;
 	bool _done_called;
+	node_config_sourceT _node_config_source;
 };
 
 std::ostream &operator<<(std::ostream &os, const controllerT::execute_config_elemT &config_elem);
-// std::ostream &operator<<(std::ostream &os, const controllerT::slot_allocationT &slot_allocation);
 
 #endif /* end of include guard: poncos_controller */
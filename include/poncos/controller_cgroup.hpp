@@ -13,18 +13,22 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "poncos/controller.hpp"
 #include "poncos/job.hpp"
 #include "poncos/poncos.hpp"
+#include "poncos/resctrl.hpp"
 
 #include <fast-lib/mqtt_communicator.hpp>
 
 class cgroup_controller : public controllerT {
   public:
 	cgroup_controller(const std::shared_ptr<fast::MQTT_communicator> &_comm, const std::string &machine_filename,
-					  const system_configT &system_config);
+					  const system_configT &system_config, const std::string &resctrl_path = "",
+					  node_config_sourceT node_configs = nullptr);
 	~cgroup_controller();
 
 	void init();
@@ -39,12 +43,55 @@ class cgroup_controller : public controllerT {
 	void update_config(const size_t id, const execute_config &new_config);
 	bool update_supported() { return false; }
 
+	// memory bandwidth allocation via resctrl
+	void set_mba(const size_t id, const unsigned int mba);
+	unsigned int get_mba(const size_t id) const;
+	bool mba_supported() { return use_resctrl; }
+
+	// cpusets can be resized at runtime
+	bool resize_supported() { return true; }
+
+	// slots can be shared by jobs using disjoint subsets of its CPUs
+	bool subslot_supported() { return true; }
+
+  protected:
+	// mpiexec command line of a job, writes its hosts file
+	std::string generate_command(const jobT &job, size_t counter, const execute_config &config) const;
+
   private:
 	controllerT::execute_config sort_config_by_hostname(const execute_config &config) const;
-	std::string generate_command(const jobT &job, size_t counter, const execute_config &config) const;
-	std::string domain_name_from_config_elem(const execute_config_elemT &config_elem) const;
+	// groups config by host (hosts = host, slots) and returns the number of ranks of job started on each of them
+	std::vector<size_t> distribute_ranks(const jobT &job, const execute_config &config,
+										 std::vector<std::pair<size_t, std::vector<size_t>>> &hosts) const;
+	// current CPUs of every launcher process of id on machine
+	std::vector<std::vector<unsigned int>> launcher_cpus(const size_t id, const size_t machine) const;
+	std::string generate_launcher(const size_t id, const std::vector<unsigned int> &cpus,
+								  const std::vector<unsigned int> &mems, const size_t procs) const;
+	std::string generate_launcher(const size_t id, const size_t machine, const std::vector<size_t> &slots,
+								  const size_t procs) const;
+	std::string generate_subslot_command(const jobT &job, size_t counter, const execute_config_elemT &slot) const;
+	std::string domain_name_from_config_elem(const execute_config_elemT &config_elem, const size_t id) const;
+	void repin_domain(const size_t machine, const size_t id);
+
+	// schemata of the resctrl group of id on machine, only the MBA is written unless the group is created
+	std::string resctrl_schemata(const size_t id, const size_t machine, const bool create) const;
+	// machines of id whose resctrl groups are managed, i.e. the ones not drained
+	std::vector<size_t> resctrl_machines(const size_t id) const;
+	void create_resctrl_groups(const size_t id);
+	void delete_resctrl_groups(const size_t id);
+
+	YAML::Node emit_state() const;
+	void load_state(const YAML::Node &node);
+	void replay(const YAML::Node &record);
 
   private:
+	// resctrl groups are created alongside the cgroups if enabled
+	bool use_resctrl;
+	// resctrl mount point of the nodes, %h is replaced by the host name
+	std::string resctrl_root;
+	resctrlT resctrl;
+	// memory bandwidth allocation set by set_mba(), unrestricted if not stored
+	std::unordered_map<size_t, unsigned int> id_to_mba;
 };
 
 #endif /* end of include guard: poncos_controller_cgroup */
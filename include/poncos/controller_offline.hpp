@@ -0,0 +1,74 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_controller_offline
+#define poncos_controller_offline
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "poncos/controller.hpp"
+
+// features of the controller a recorded decision depended on
+struct controller_capabilitiesT : public fast::Serializable {
+	YAML::Node emit() const override;
+	void load(const YAML::Node &node) override;
+
+	bool update = false;
+	bool mba = false;
+	bool resize = false;
+	bool subslot = false;
+};
+controller_capabilitiesT capabilities_of(controllerT &controller);
+
+// Controller without agents: no domains are created and no jobs are started. The machines and jobs are set with
+// restore(), i.e. the schedulers see the state recorded by another controller. Used to replay scheduler
+// decisions offline.
+class offline_controllerT : public controllerT {
+  public:
+	offline_controllerT(const system_configT &system_config, const controller_capabilitiesT &capabilities);
+	~offline_controllerT();
+
+	void init() {}
+	void dismantle() {}
+
+	void create_domain(const size_t /*id*/) {}
+	void delete_domain(const size_t /*id*/) {}
+
+	// the configuration is applied without migrating anything
+	void update_config(const size_t id, const execute_config &new_config);
+	bool update_supported() { return capabilities.update; }
+
+	// the allocation is only stored
+	void set_mba(const size_t id, const unsigned int mba);
+	unsigned int get_mba(const size_t id) const;
+	bool mba_supported() { return capabilities.mba; }
+
+	bool resize_supported() { return capabilities.resize; }
+	bool subslot_supported() { return capabilities.subslot; }
+
+  private:
+	std::string generate_command(const jobT &job, size_t counter, const execute_config &config) const;
+	std::string domain_name_from_config_elem(const execute_config_elemT &config_elem, const size_t id) const;
+	void repin_domain(const size_t /*machine*/, const size_t /*id*/) {}
+
+	// memory bandwidth allocations in the format of the cgroup controller
+	YAML::Node emit_state() const;
+	void load_state(const YAML::Node &node);
+
+  private:
+	controller_capabilitiesT capabilities;
+	std::unordered_map<size_t, unsigned int> id_to_mba;
+};
+
+YAML_CONVERT_IMPL(controller_capabilitiesT)
+
+#endif /* end of include guard: poncos_controller_offline */
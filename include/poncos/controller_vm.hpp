@@ -28,7 +28,8 @@
 class vm_controller : public controllerT {
   public:
 	vm_controller(const std::shared_ptr<fast::MQTT_communicator> &_comm, const std::string &machine_filename,
-				  const system_configT &system_config, std::string _slot_path);
+				  const system_configT &system_config, std::string _slot_path,
+				  node_config_sourceT node_configs = nullptr);
 	~vm_controller();
 
 	void init();
@@ -43,14 +44,32 @@ class vm_controller : public controllerT {
 	void update_config(const size_t id, const execute_config &new_config);
 	bool update_supported() { return true; }
 
+	// not supported
+	void set_mba(const size_t id, const unsigned int mba);
+	unsigned int get_mba(const size_t /*id*/) const { return 100; }
+	bool mba_supported() { return false; }
+	bool resize_supported() { return false; }
+	bool subslot_supported() { return false; }
+
   private:
 	std::string generate_command(const jobT &job, size_t counter, const execute_config &config) const;
-	std::string domain_name_from_config_elem(const execute_config_elemT &config_elem) const;
+	std::string domain_name_from_config_elem(const execute_config_elemT &config_elem, const size_t id) const;
+	void repin_domain(const size_t machine, const size_t id);
 	std::vector<std::vector<unsigned int>> generate_vcpu_map(size_t slot_id) const;
 	std::shared_ptr<fast::msg::migfra::Start> generate_start_task(size_t slot, vm_pool_elemT &free_vm);
 
 	void start_all_VMs();
 	void stop_all_VMs();
+	// takes VMs from the pool and sends the tasks to start them on all slots of mach
+	void send_start_tasks(const size_t mach);
+	void send_stop_tasks(const size_t mach);
+	void machine_added(const size_t machine);
+	void machine_removed(const size_t machine);
+
+	YAML::Node emit_state() const;
+	void load_state(const YAML::Node &node);
+	void replay(const YAML::Node &record);
+	void record_vm_locations() const;
 
 	std::string get_hostname_from_machinename(const std::pair<size_t, size_t> &config) const;
 
@@ -62,6 +81,8 @@ class vm_controller : public controllerT {
 	// vector index -> machine index (see: machines)
 	// vector elem  -> array of VM names per slot
 	std::vector<std::vector<std::string>> vm_locations;
+	// VMs taken from the pool, returned once their machine is removed
+	std::unordered_map<std::string, vm_pool_elemT> vm_pool_elems;
 };
 
 #endif /* end of include guard: poncos_controller_vm */
@@ -0,0 +1,40 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_decision_log
+#define poncos_decision_log
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fast-lib/serializable.hpp>
+
+// Audit log of the decisions of a scheduler. Every record is a YAML node holding the inputs of a decision (e.g.
+// the state of the controller and the measured utilization) and its outcome, written as a single line in flow
+// style. Records are flushed right away, i.e. the log is complete up to the last decision if poncos crashes.
+// poncos_replay runs the recorded decisions through the current scheduler code.
+class decision_logT {
+  public:
+	decision_logT(const std::string &path);
+
+	// safe to be called from any thread
+	void append(const YAML::Node &record);
+
+	// reads the records of a log, a torn last line is dropped
+	static std::vector<YAML::Node> read(const std::string &path);
+
+  private:
+	std::ofstream file;
+	std::mutex mtx;
+};
+
+#endif /* end of include guard: poncos_decision_log */
@@ -0,0 +1,117 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_event_trace
+#define poncos_event_trace
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class event_typeT : uint32_t {
+	job_submitted,
+	job_started,
+	job_finished,
+	job_frozen,
+	job_thawed,
+	migration_started,
+	migration_finished,
+	measurement_started,
+	measurement_finished,
+	resize_started,
+	resize_finished
+};
+const char *to_string(const event_typeT type);
+
+// binary record of the trace file
+struct eventT {
+	// ns since the trace was created
+	uint64_t time;
+	// id of the job, numeric_limits<uint64_t>::max if the event is not related to a job
+	uint64_t id;
+	// machine index, the destination of a migration in peer. job_submitted carries the id of the job queue, the
+	// matching job_started carries the same id in peer.
+	uint32_t machine;
+	uint32_t peer;
+	event_typeT type;
+	uint32_t reserved;
+};
+
+// Records the lifecycle events of the jobs into a ring buffer in memory. Recording is lock-free and never blocks,
+// a background thread appends the events to a binary file (magic followed by eventT records) once per interval.
+// If the flusher falls behind by more than the capacity of the ring, the oldest events are overwritten and
+// counted as dropped. export_chrome() converts a trace into the Chrome trace event format (chrome://tracing,
+// Perfetto).
+class event_traceT {
+  public:
+	using clockT = std::chrono::steady_clock;
+	static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+	// capacity is rounded up to a power of two
+	event_traceT(const std::string &path, size_t capacity = 1 << 16,
+				 std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+	~event_traceT();
+
+	// starts/stops the background flusher, stop() writes all remaining events
+	void start();
+	void stop();
+
+	// safe to be called from any thread
+	void record(const event_typeT type, const size_t id, const size_t machine = none, const size_t peer = none);
+	// number of events overwritten before they were written to the file
+	uint64_t dropped();
+
+	// reads the events of a trace file
+	static std::vector<eventT> read(const std::string &path);
+	static void export_chrome(const std::vector<eventT> &events, std::ostream &os);
+
+  private:
+	struct cellT {
+		// index + 1 of the event stored, 0 while it is written
+		std::atomic<uint64_t> seq{0};
+		std::atomic<uint64_t> time{0};
+		std::atomic<uint64_t> id{0};
+		std::atomic<uint32_t> machine{0};
+		std::atomic<uint32_t> peer{0};
+		std::atomic<uint32_t> type{0};
+	};
+
+	// expects mtx to be locked
+	void flush_locked();
+
+  private:
+	clockT::time_point origin;
+	std::unique_ptr<cellT[]> ring;
+	uint64_t mask;
+	std::atomic<uint64_t> head{0};
+	// index of the next event to be written to the file
+	uint64_t tail = 0;
+	uint64_t dropped_events = 0;
+	std::chrono::milliseconds interval;
+
+	FILE *file;
+	std::vector<eventT> buffer;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::thread flusher;
+	bool running = false;
+};
+
+#endif /* end of include guard: poncos_event_trace */
@@ -0,0 +1,69 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_interference_model
+#define poncos_interference_model
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "poncos/job.hpp"
+
+#include <fast-lib/serializable.hpp>
+
+// mean runtime of an application class, either alone (empty partner) or sharing nodes with partner
+struct interference_entryT : public fast::Serializable {
+	YAML::Node emit() const override;
+	void load(const YAML::Node &node) override;
+
+	std::string application;
+	std::string partner;
+	size_t runs = 0;
+	double runtime = 0;
+};
+
+// Pairwise interference between application classes learned from the runtimes of completed jobs.
+// The slowdown of an application caused by a partner is its mean runtime while sharing nodes with the
+// partner divided by its mean runtime when running alone. The model can be stored in YAML format to
+// keep the history across runs of poncos.
+class interference_modelT : public fast::Serializable {
+  public:
+	interference_modelT() = default;
+	// loads the model from file if it exists
+	interference_modelT(const std::string &filename);
+
+	// application class of a job, the name of its executable
+	static std::string class_of(const jobT &job);
+
+	// adds the runtime of a job of application that shared its nodes with partner (empty if alone)
+	void record(const std::string &application, const std::string &partner, double runtime);
+	// slowdown of application when sharing nodes with partner, 0 if unknown
+	double slowdown(const std::string &application, const std::string &partner);
+
+	void save(const std::string &filename);
+
+	// the entries of the applications in classes alone and with a partner in classes, in the format of emit()
+	YAML::Node emit_classes(const std::set<std::string> &classes) const;
+
+	YAML::Node emit() const override;
+	void load(const YAML::Node &node) override;
+
+  private:
+	std::map<std::pair<std::string, std::string>, interference_entryT> entries;
+	mutable std::mutex mtx;
+};
+
+YAML_CONVERT_IMPL(interference_entryT)
+
+#endif /* end of include guard: poncos_interference_model */
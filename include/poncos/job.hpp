@@ -1,8 +1,22 @@
 #ifndef poncos_job
 #define poncos_job
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <fast-lib/serializable.hpp>
 
+#include "poncos/event_trace.hpp"
+#include "poncos/metrics.hpp"
+#include "poncos/journal.hpp"
+
 struct jobT : public fast::Serializable {
 	jobT() = default;
 	jobT(size_t nprocs, size_t threads_per_proc, std::string command, bool uses_sr_protocol);
@@ -15,20 +29,99 @@ struct jobT : public fast::Serializable {
 	size_t threads_per_proc;
 	std::string command;
 	bool uses_sr_protocol;
+	// memory required on every node the job runs on in MiB, 0 if unknown
+	size_t memory = 0;
 };
 std::ostream &operator<<(std::ostream &os, const jobT &job);
 
+enum class job_statusT { pending, running, done };
+std::ostream &operator<<(std::ostream &os, const job_statusT &status);
+
+// Reads the jobs of a trace one at a time, see job_queueT::feed()
+class job_sourceT {
+  public:
+	virtual ~job_sourceT() = default;
+
+	// reads the next job and its submit time relative to the start of the trace, false at the end of the trace
+	virtual bool next(jobT &job, std::chrono::milliseconds &submit) = 0;
+};
+
+// Jobs are submitted to the queue while the schedulers consume them. The queue is open until close() is
+// called, i.e. the schedulers wait for further submissions once all jobs were started. Jobs are identified
+// by the order of their submission. Only the jobs not started yet are kept, i.e. the memory used does not grow
+// with the number of jobs submitted.
 struct job_queueT : public fast::Serializable {
 	job_queueT() = default;
 	job_queueT(const std::string &queue_filename);
 	job_queueT(std::vector<jobT> jobs);
+	~job_queueT();
 
 	YAML::Node emit() const override;
 	void load(const YAML::Node &node) override;
 
+	// appends job and sets id, false if the queue was closed
+	bool submit(const jobT &job, size_t &id);
+	// submits the jobs of source by a background thread once their submit time has passed, scaled by speedup.
+	// At most window jobs are pending at a time. The first skip jobs of source were submitted before a restart
+	// (see fed()). The queue is closed at the end of the trace if close is set.
+	void feed(std::unique_ptr<job_sourceT> source, const bool close, const double speedup = 1,
+			  const size_t window = 1024, const size_t skip = 0);
+	// number of jobs submitted by feed(), restored by recover()
+	size_t fed();
+	// no further jobs are accepted, the schedulers return once all jobs were started
+	void close();
+	bool closed();
+	// true if a job is waiting to be started
+	bool ready();
+	// number of jobs submitted so far
+	size_t size();
+	// waits for the next job and marks it running, false if the queue was closed and all jobs were started
+	bool next(size_t &id, jobT &job);
+	// marks the job with id as completed
+	void finished(const size_t id);
+	// returns the last job taken by next() to the front of the queue, e.g. because it could not be started
+	void requeue(const size_t id, const jobT &job);
+	// status of the job with id, false if there is no such job
+	bool status(const size_t id, job_statusT &ret);
+	// ids of the pending and running jobs at one point in time, returns the number of submitted jobs
+	size_t unfinished(std::vector<size_t> &pending, std::vector<size_t> &running);
+
+	// records the submission of every job in trace
+	void use_trace(std::shared_ptr<event_traceT> trace);
+	// publishes the number of submitted and pending jobs
+	void use_metrics(std::shared_ptr<metricsT> metrics);
+	// records the submitted jobs in journal, the jobs loaded before are stored by the next journalT::compact()
+	void use_journal(std::shared_ptr<journalT> journal);
+	// restores the jobs stored in the journal. The jobs with an id below started were started before the restart,
+	// running tells which of them are still running.
+	void recover(const size_t started, const std::function<bool(size_t)> &running);
+
 	std::string title;
-	std::vector<jobT> jobs;
 	std::string id;
+
+  private:
+	bool submit_job(const jobT &job, size_t &id, const bool from_source);
+	void feed_internal(std::unique_ptr<job_sourceT> source, const bool close, const double speedup,
+					   const size_t window, const size_t skip);
+
+  private:
+	// jobs not started yet, the first one has the id next_job
+	std::deque<jobT> pending;
+	size_t next_job = 0;
+	// status of the jobs from status_base on, the jobs below are done
+	std::deque<job_statusT> statuses;
+	size_t status_base = 0;
+	// jobs submitted by feed()
+	size_t fed_jobs = 0;
+	bool is_closed = false;
+	std::shared_ptr<journalT> journal;
+	std::shared_ptr<event_traceT> trace;
+	std::shared_ptr<metricsT> metrics;
+	std::mutex mtx;
+	std::condition_variable cv;
+
+	std::thread feeder;
+	bool feeding = false;
 };
 
 YAML_CONVERT_IMPL(jobT)
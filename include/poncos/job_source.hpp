@@ -0,0 +1,61 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_job_source
+#define poncos_job_source
+
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include "poncos/job.hpp"
+
+// Reads the job-list of a queue file entry by entry instead of loading the whole file. This requires a top-level
+// "job-list:" with entries in block style (one "- " per job, as in example/NPB.yml), other files are loaded as a
+// whole with yaml-cpp. An optional "submit: <s>" per entry is the submit time of the job relative to the start of
+// the queue, 0 otherwise.
+class yaml_job_sourceT : public job_sourceT {
+  public:
+	yaml_job_sourceT(const std::string &filename);
+
+	bool next(jobT &job, std::chrono::milliseconds &submit) override;
+
+  private:
+	std::ifstream file;
+	// first line of the next entry, already read
+	std::string lookahead;
+	// indentation of the "- " of the entries
+	size_t indent;
+	bool done;
+
+	// job-list of a file that cannot be streamed and the index of the next entry
+	YAML::Node loaded;
+	size_t loaded_next;
+};
+
+// Reads a trace in the Standard Workload Format of the Parallel Workloads Archive. Every job requests the
+// processors of the trace (1 thread per process) and runs command, in which %r is replaced by the runtime in
+// seconds, %n by the job number and %p by the number of processors. Jobs without processors or runtime and jobs
+// requesting more than max_procs are skipped with a warning.
+class swf_job_sourceT : public job_sourceT {
+  public:
+	swf_job_sourceT(const std::string &filename, std::string command = "sleep %r",
+					size_t max_procs = std::numeric_limits<size_t>::max());
+
+	bool next(jobT &job, std::chrono::milliseconds &submit) override;
+
+  private:
+	std::ifstream file;
+	std::string command;
+	size_t max_procs;
+};
+
+#endif /* end of include guard: poncos_job_source */
@@ -0,0 +1,115 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_job_table
+#define poncos_job_table
+
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Entries of the jobs indexed by their id. Ids are not reused unless the highest id is erased (a job that could not
+// be started), but the storage of an erased entry is reused by the next job, i.e. the table is bounded by the
+// number of jobs alive at the same time instead of the number of jobs started. The index is dense from the oldest id alive, i.e. a long running job keeps the slots of the ids
+// started after it.
+template <typename T> class job_tableT {
+  public:
+	// adds the entry of id, ids must be higher than the ones of all entries
+	T &insert(const size_t id) {
+		if (index.empty()) first_id = id;
+		assert(id >= first_id + index.size());
+		index.resize(id - first_id + 1, npos);
+
+		size_t slot;
+		if (free_slots.empty()) {
+			slot = entries.size();
+			entries.emplace_back();
+		} else {
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+		index.back() = slot;
+		++alive;
+		return entries[slot];
+	}
+
+	// the storage of the entry is reused by the next insert()
+	void erase(const size_t id) {
+		assert(contains(id));
+		size_t &slot = index[id - first_id];
+		entries[slot] = T();
+		free_slots.push_back(slot);
+		slot = npos;
+		--alive;
+
+		while (!index.empty() && index.front() == npos) {
+			index.pop_front();
+			++first_id;
+		}
+		while (!index.empty() && index.back() == npos) {
+			index.pop_back();
+		}
+	}
+
+	bool contains(const size_t id) const {
+		return id >= first_id && id - first_id < index.size() && index[id - first_id] != npos;
+	}
+
+	T &operator[](const size_t id) {
+		assert(contains(id));
+		return entries[index[id - first_id]];
+	}
+	const T &operator[](const size_t id) const {
+		assert(contains(id));
+		return entries[index[id - first_id]];
+	}
+
+	// ids of all entries in ascending order
+	std::vector<size_t> ids() const {
+		std::vector<size_t> ret;
+		ret.reserve(alive);
+		for (size_t i = 0; i < index.size(); ++i) {
+			if (index[i] != npos) ret.push_back(first_id + i);
+		}
+		return ret;
+	}
+	size_t size() const { return alive; }
+	// most entries alive at the same time so far
+	size_t capacity() const { return entries.size(); }
+
+  private:
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+	std::vector<T> entries;
+	std::vector<size_t> free_slots;
+	// id - first_id -> index in entries, npos if the job was erased
+	std::deque<size_t> index;
+	size_t first_id = 0;
+	size_t alive = 0;
+};
+
+template <typename T> constexpr size_t job_tableT<T>::npos;
+
+// read-only access to one member of the entries of a job table, e.g. table_field[id] == table[id].*member
+template <typename T, typename M> class job_table_fieldT {
+  public:
+	job_table_fieldT(const job_tableT<T> &table, M T::*member) : table(table), member(member) {}
+
+	const M &operator[](const size_t id) const { return table[id].*member; }
+
+  private:
+	const job_tableT<T> &table;
+	M T::*member;
+};
+
+#endif /* end of include guard: poncos_job_table */
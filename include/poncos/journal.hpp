@@ -0,0 +1,93 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_journal
+#define poncos_journal
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fast-lib/serializable.hpp>
+
+// Append-only journal of the state changes of poncos, used to recover after a crash or restart without tearing
+// down the running jobs. Records are YAML nodes written to a memory-mapped file (length, checksum, payload). A
+// background thread flushes the file to disk at most once per sync interval, so a crash loses at most the
+// records of the last interval; a torn record at the end of the file is detected by its checksum and dropped.
+//
+// Participants register a source that emits their complete state. compact() writes the state of all sources
+// into <path>.snapshot and truncates the journal, i.e. recovery reads the snapshot and replays the records
+// appended afterwards. Snapshot and journal carry a generation to detect a crash in between both steps.
+class journalT {
+  public:
+	journalT(std::string path, std::chrono::milliseconds sync_interval = std::chrono::milliseconds(100));
+	~journalT();
+
+	// state of the sources as of the last compaction, null if there was none
+	const YAML::Node &snapshot() const { return loaded_snapshot; }
+	// records appended after the last compaction, as read when the journal was opened
+	const std::vector<YAML::Node> &records() const { return loaded_records; }
+	// true if a snapshot or records were read, i.e. poncos is restarted
+	bool recovered() const;
+
+	// the source is stored as snapshot()[name]
+	void add_source(const std::string &name, std::function<YAML::Node()> emit);
+	// appends a record, it is flushed to disk with the next sync
+	void append(const YAML::Node &record);
+	// applies a state change and appends the record it returns (if not null) while the journal is locked, i.e.
+	// the change is either part of the next snapshot or of the records appended after it
+	void apply(const std::function<YAML::Node()> &change);
+	// flushes all records to disk
+	void sync();
+	// number of records appended since the last compaction
+	size_t size();
+	// stores the state of all sources as snapshot and drops all records
+	void compact();
+	// drops snapshot and records, e.g. once all jobs completed
+	void clear();
+
+  private:
+	void open();
+	void read();
+	void reset(const uint64_t generation);
+	void grow(const size_t required);
+	void append_locked(const YAML::Node &record);
+	void sync_locked();
+
+  private:
+	std::string path;
+	std::chrono::milliseconds sync_interval;
+
+	int fd;
+	char *map;
+	size_t map_size;
+	// offset of the end marker, i.e. where the next record is written
+	size_t tail;
+	uint64_t generation;
+	size_t record_count;
+	bool dirty;
+
+	YAML::Node loaded_snapshot;
+	std::vector<YAML::Node> loaded_records;
+	std::vector<std::pair<std::string, std::function<YAML::Node()>>> sources;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::thread syncer;
+	bool running;
+};
+
+#endif /* end of include guard: poncos_journal */
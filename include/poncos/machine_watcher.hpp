@@ -0,0 +1,48 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_machine_watcher
+#define poncos_machine_watcher
+
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "poncos/controller.hpp"
+
+// Polls the modification time of the machine file and hands the hosts listed in it to the controller once it
+// changed, i.e. hosts can be added or removed by editing the file (see controllerT::sync_machines()).
+class machine_watcherT {
+  public:
+	machine_watcherT(controllerT &controller, std::string filename, std::chrono::milliseconds interval);
+	~machine_watcherT();
+
+	// starts/stops the background polling thread
+	void start();
+	void stop();
+
+  private:
+	// modification time of the file, 0 if it cannot be read
+	std::time_t modification_time() const;
+
+  private:
+	controllerT &controller;
+	std::string filename;
+	std::chrono::milliseconds interval;
+	std::time_t last_change;
+
+	std::thread watcher;
+	std::mutex mtx;
+	bool running;
+};
+
+#endif /* end of include guard: poncos_machine_watcher */
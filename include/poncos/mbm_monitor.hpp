@@ -0,0 +1,72 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_mbm_monitor
+#define poncos_mbm_monitor
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "poncos/resctrl.hpp"
+
+// Passive memory bandwidth measurement based on the MBM counters of resctrl monitoring groups.
+// Watched groups are sampled periodically by a background thread, the bandwidth is computed over
+// a sliding window and normalized with the calibrated peak bandwidth of the node.
+class mbm_monitorT {
+  public:
+	using clockT = std::chrono::steady_clock;
+
+	// peak_bw in bytes/s; event is either mbm_total_bytes or mbm_local_bytes
+	mbm_monitorT(resctrlT resctrl, double peak_bw, std::chrono::milliseconds window,
+				 std::string event = "mbm_total_bytes");
+	~mbm_monitorT();
+
+	// starts/stops the background sampling thread
+	void start();
+	void stop();
+	// samples all watched groups once, as done by the background thread
+	void poll();
+
+	// starts sampling the group; groups are dropped automatically once they are removed
+	void watch(const std::string &host, const std::string &group);
+
+	// bandwidth in bytes/s over the current window, waits for a full window if the group was not watched before
+	double bandwidth(const std::string &host, const std::string &group);
+	// bandwidth normalized to the peak bandwidth of the node
+	double utilization(const std::string &host, const std::string &group);
+
+  private:
+	using sampleT = std::pair<clockT::time_point, unsigned long long>;
+	using keyT = std::pair<std::string, std::string>;
+
+	// adds a new sample to all watched groups; expects mtx to be locked
+	void sample_all();
+	void sample(const keyT &key, std::deque<sampleT> &samples) const;
+
+  private:
+	resctrlT resctrl;
+	double peak_bw;
+	std::chrono::milliseconds window;
+	std::string event;
+
+	// samples per (host, group), oldest first
+	std::map<keyT, std::deque<sampleT>> samples;
+	std::mutex mtx;
+
+	std::thread sampler;
+	bool running;
+};
+
+#endif /* end of include guard: poncos_mbm_monitor */
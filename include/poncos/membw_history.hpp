@@ -0,0 +1,117 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_membw_history
+#define poncos_membw_history
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// binary records of the history file, names are truncated and zero-padded
+struct membw_sampleT {
+	// ms since the epoch
+	int64_t time;
+	uint64_t job;
+	uint32_t slot;
+	uint32_t reserved;
+	// fraction of the membw capacity of the node used by the slot
+	double utilization;
+	// GB/s, normalized to the peak if the node is not calibrated
+	double membw;
+	char host[24];
+	// application class of the job, see interference_modelT::class_of()
+	char application[24];
+};
+
+// samples of a slot within one interval
+struct membw_aggregateT {
+	// ms since the epoch, start of the interval
+	int64_t time;
+	uint32_t slot;
+	uint32_t samples;
+	double utilization_sum;
+	double utilization_max;
+	double membw_sum;
+	char host[24];
+};
+
+// samples matched by a query, empty fields match everything
+struct membw_queryT {
+	static constexpr size_t any = std::numeric_limits<size_t>::max();
+
+	std::string host;
+	size_t slot = any;
+	size_t job = any;
+	std::string application;
+	// samples taken before are ignored
+	std::chrono::system_clock::time_point since;
+};
+
+// History of the memory bandwidth measured per node, slot and job, stored in a memory-mapped file that is kept
+// across runs of poncos. The file holds two rings: the last sample_capacity samples and the last
+// aggregate_capacity aggregates, i.e. the samples of a slot downsampled to one record per interval. The oldest
+// records are overwritten once a ring is full, so the retention of the samples is much shorter than the one of
+// the aggregates. The aggregate of the current interval of a slot is written once the slot is sampled in a later
+// interval or the history is closed.
+class membw_historyT {
+  public:
+	membw_historyT(const std::string &path, size_t sample_capacity = 1 << 18, size_t aggregate_capacity = 1 << 18,
+				   std::chrono::seconds interval = std::chrono::seconds(300));
+	~membw_historyT();
+
+	void record(const std::string &host, const size_t slot, const size_t job, const std::string &application,
+				const double utilization, const double membw);
+
+	// samples matching query, oldest first
+	std::vector<membw_sampleT> samples(const membw_queryT &query) const;
+	// aggregates of the slots matching host and slot of query, including the ones of the current intervals
+	std::vector<membw_aggregateT> aggregates(const membw_queryT &query) const;
+	// p-th percentile (0..1) of the utilization of the samples matching query, 0 if there is none
+	double percentile(const membw_queryT &query, const double p) const;
+	// change of the utilization of host (sum of its slots) per hour since the supplied time, least squares fit of
+	// the mean utilization per interval. 0 if there are less than two intervals.
+	double trend(const std::string &host, const std::chrono::system_clock::time_point &since) const;
+
+	// reads the samples and aggregates of a history file, oldest first
+	static void read(const std::string &path, std::vector<membw_sampleT> &samples,
+					 std::vector<membw_aggregateT> &aggregates);
+	// CSV with a header line
+	static void export_samples(const std::vector<membw_sampleT> &samples, std::ostream &os);
+	static void export_aggregates(const std::vector<membw_aggregateT> &aggregates, std::ostream &os);
+
+  private:
+	struct headerT;
+
+	headerT &header() const;
+	membw_sampleT *sample_ring() const;
+	membw_aggregateT *aggregate_ring() const;
+	// expects mtx to be locked
+	void append_aggregate(const membw_aggregateT &aggregate);
+
+  private:
+	std::string path;
+	int fd;
+	char *map;
+	size_t map_size;
+	int64_t interval_ms;
+
+	// aggregates of the current interval per (host, slot)
+	std::map<std::pair<std::string, uint32_t>, membw_aggregateT> open_aggregates;
+	mutable std::mutex mtx;
+};
+
+#endif /* end of include guard: poncos_membw_history */
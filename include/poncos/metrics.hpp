@@ -0,0 +1,85 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_metrics
+#define poncos_metrics
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class counterT { jobs_submitted, jobs_started, jobs_finished, freezes, migrations, measurements, count };
+enum class gaugeT { queue_pending, jobs_running, machines, drained, cpus_total, cpus_free, load, count };
+enum class histogramT { placement_decision, swap_decision, measurement, migration, frozen, count };
+// per machine
+enum class node_gaugeT { slots_used, membw, net, io, count };
+
+// Metrics of the scheduler exposed in the Prometheus text format. Updates are lock-free (relaxed atomics) and
+// may be called from any thread; the text is only rendered once the endpoint is scraped. The endpoint is served
+// by a background thread on a local TCP port ("<port>" or "<address>:<port>") or a Unix socket ("unix:<path>").
+class metricsT {
+  public:
+	metricsT(std::string endpoint);
+	~metricsT();
+
+	// starts/stops serving the endpoint
+	void start();
+	void stop();
+
+	void add(const counterT counter, const uint64_t value = 1);
+	void set(const gaugeT gauge, const double value);
+	// durations in seconds
+	void observe(const histogramT histogram, const double value);
+	void set(const node_gaugeT gauge, const size_t machine, const double value);
+	// name of the machine in the labels, machines without name are not exported
+	void name_node(const size_t machine, const std::string &host);
+
+	// all metrics in the Prometheus text exposition format
+	std::string render() const;
+
+  private:
+	// bucket counts are not cumulative, render() sums them up
+	struct histogram_dataT {
+		std::array<std::atomic<uint64_t>, 16> buckets;
+		std::atomic<double> sum;
+	};
+	struct node_dataT {
+		std::array<std::atomic<double>, static_cast<size_t>(node_gaugeT::count)> values;
+	};
+	static constexpr size_t NODE_CHUNK = 256;
+	static constexpr size_t MAX_NODE_CHUNKS = 4096;
+
+	// returns the values of machine, allocated lock-free on first use
+	node_dataT &node(const size_t machine);
+	void serve();
+	void answer(const int fd) const;
+
+  private:
+	std::string endpoint;
+
+	std::array<std::atomic<uint64_t>, static_cast<size_t>(counterT::count)> counters;
+	std::array<std::atomic<double>, static_cast<size_t>(gaugeT::count)> gauges;
+	std::array<histogram_dataT, static_cast<size_t>(histogramT::count)> histograms;
+	// chunks of NODE_CHUNK machines
+	std::array<std::atomic<node_dataT *>, MAX_NODE_CHUNKS> node_chunks;
+
+	std::vector<std::string> node_names;
+	mutable std::mutex names_mutex;
+
+	int listen_fd;
+	std::thread server;
+	std::atomic<bool> running{false};
+};
+
+#endif /* end of include guard: poncos_metrics */
@@ -36,6 +36,15 @@ struct sched_configT {
 
 void read_file(const std::string &filename, std::vector<std::string> &command_queue);
 std::string read_file_to_string(const std::string &filename);
+// replaces "%h" in path with host, used for paths of node local file systems (e.g. sysfs)
+std::string expand_host_path(const std::string &path, const std::string &host);
+// true if host names the machine poncos runs on
+bool is_local_host(const std::string &host);
+// checks that path resolves to the node local file system of every machine, i.e. marker exists below the expanded
+// path of each host. A path without "%h" is only accepted for a single local host and not if machines may be added
+// (elastic). Returns the first problem found, empty if there is none.
+std::string check_host_path(const std::string &path, const std::vector<std::string> &machines,
+							const std::string &marker, const bool elastic);
 
 namespace std {
 // The following operator<< are implemented in the std namespace to allow fastlib
@@ -0,0 +1,126 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Progress reporting of applications. Include this header into the application and call report() once
+ * per iteration of the main loop:
+ *
+ *   progress_reporterT progress;
+ *   for (...) {
+ *       ...
+ *       progress.report();
+ *   }
+ *
+ * The reporter publishes the total number of iterations at most once per interval via MQTT. It is
+ * configured by the environment poncos passes to the job (PONCOS_JOB, PONCOS_MQTT_SERVER,
+ * PONCOS_MQTT_PORT) and does nothing if started without poncos. Only MPI rank 0 reports, unless
+ * PONCOS_PROGRESS_RANK selects another rank.
+ */
+
+#ifndef poncos_progress
+#define poncos_progress
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <fast-lib/mqtt_communicator.hpp>
+#include <fast-lib/serializable.hpp>
+
+// topic: fast/poncos/progress
+struct progress_msgT : public fast::Serializable {
+	progress_msgT() = default;
+	progress_msgT(std::string job, size_t iterations) : job(std::move(job)), iterations(iterations) {}
+
+	YAML::Node emit() const override {
+		YAML::Node node;
+		node["job"] = job;
+		node["iterations"] = iterations;
+		return node;
+	}
+	void load(const YAML::Node &node) override {
+		fast::load(job, node["job"]);
+		fast::load(iterations, node["iterations"]);
+	}
+
+	// name of the domain of the job (see controllerT::cmd_name_from_id())
+	std::string job;
+	// iterations completed since the start of the job
+	size_t iterations = 0;
+};
+
+YAML_CONVERT_IMPL(progress_msgT)
+
+const std::string progress_topic = "fast/poncos/progress";
+
+class progress_reporterT {
+  public:
+	progress_reporterT(std::chrono::milliseconds interval = std::chrono::milliseconds(1000))
+		: interval(interval), iterations(0), last_report(std::chrono::steady_clock::now()) {
+		const char *job_env = std::getenv("PONCOS_JOB");
+		const char *server_env = std::getenv("PONCOS_MQTT_SERVER");
+		if (job_env == nullptr || server_env == nullptr) return;
+		if (rank() != report_rank()) return;
+
+		job = job_env;
+		const char *port_env = std::getenv("PONCOS_MQTT_PORT");
+		const int port = port_env == nullptr ? 1883 : std::atoi(port_env);
+
+		// progress reporting must never stop the application
+		try {
+			comm = std::make_shared<fast::MQTT_communicator>("", progress_topic, server_env, port, 60,
+															 std::chrono::seconds(10));
+		} catch (const std::exception &) {
+			comm = nullptr;
+		}
+	}
+	~progress_reporterT() { publish(); }
+
+	// adds completed iterations, publishes the total at most once per interval
+	void report(size_t completed = 1) {
+		if (comm == nullptr) return;
+
+		iterations += completed;
+		const auto now = std::chrono::steady_clock::now();
+		if (now - last_report < interval) return;
+
+		last_report = now;
+		publish();
+	}
+
+  private:
+	void publish() {
+		if (comm == nullptr) return;
+		comm->send_message(progress_msgT(job, iterations).to_string(), progress_topic, 0);
+	}
+
+	// MPI rank as set by the common MPI launchers
+	static long rank() {
+		for (const char *var : {"PMI_RANK", "OMPI_COMM_WORLD_RANK", "SLURM_PROCID"}) {
+			const char *value = std::getenv(var);
+			if (value != nullptr) return std::atol(value);
+		}
+		return 0;
+	}
+	static long report_rank() {
+		const char *value = std::getenv("PONCOS_PROGRESS_RANK");
+		return value == nullptr ? 0 : std::atol(value);
+	}
+
+  private:
+	std::chrono::milliseconds interval;
+	size_t iterations;
+	std::chrono::steady_clock::time_point last_report;
+	std::string job;
+	std::shared_ptr<fast::MQTT_communicator> comm;
+};
+
+#endif /* end of include guard: poncos_progress */
@@ -0,0 +1,55 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_progress_monitor
+#define poncos_progress_monitor
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <fast-lib/mqtt_communicator.hpp>
+
+// Collects the progress messages published by applications using progress_reporterT (see progress.hpp)
+// and computes the throughput (iterations per second) of the jobs. Samples are timestamped on arrival.
+class progress_monitorT {
+  public:
+	using clockT = std::chrono::steady_clock;
+
+	// samples older than history are dropped
+	progress_monitorT(std::shared_ptr<fast::MQTT_communicator> comm,
+					  std::chrono::seconds history = std::chrono::seconds(600));
+
+	// starts/stops listening for progress messages
+	void start();
+	void stop();
+
+	// iterations per second of the job between from and to, 0 if the job did not report twice in between
+	double throughput(const std::string &job, clockT::time_point from, clockT::time_point to = clockT::now());
+	// the job reports its progress
+	bool reports(const std::string &job);
+
+  private:
+	void receive(const std::string &message);
+
+  private:
+	std::shared_ptr<fast::MQTT_communicator> comm;
+	std::chrono::seconds history;
+
+	// (arrival, iterations) per job
+	std::map<std::string, std::deque<std::pair<clockT::time_point, size_t>>> samples;
+	std::mutex mtx;
+};
+
+#endif /* end of include guard: poncos_progress_monitor */
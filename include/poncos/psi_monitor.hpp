@@ -0,0 +1,80 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_psi_monitor
+#define poncos_psi_monitor
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+// stall fractions (0..1) of the "some" line of cpu.pressure, memory.pressure and io.pressure
+struct pressureT {
+	double cpu = 0;
+	double memory = 0;
+	double io = 0;
+};
+std::ostream &operator<<(std::ostream &os, const pressureT &pressure);
+
+// Reads the Linux pressure stall information of cgroups and keeps an exponentially weighted moving
+// average of the stall fraction per resource. The cgroup root may contain "%h" (see expand_host_path()).
+class psi_monitorT {
+  public:
+	using clockT = std::chrono::steady_clock;
+
+	// alpha is the weight of a new sample in the moving average
+	psi_monitorT(std::string root, std::chrono::milliseconds interval, double alpha = 0.2);
+	~psi_monitorT();
+
+	// starts/stops the background sampling thread
+	void start();
+	void stop();
+	// samples all watched cgroups once, as done by the background thread
+	void poll();
+
+	// starts sampling the cgroup; cgroups are dropped automatically once they are removed
+	void watch(const std::string &host, const std::string &group);
+	// returns the current averages, zero if the group is not watched
+	pressureT pressure(const std::string &host, const std::string &group);
+
+  private:
+	using keyT = std::pair<std::string, std::string>;
+	struct stateT {
+		// last value of the total stall time in us per resource
+		std::array<unsigned long long, 3> totals;
+		clockT::time_point time;
+		pressureT avg;
+		bool initialized = false;
+	};
+
+	// adds a new sample to all watched groups; expects mtx to be locked
+	void sample_all();
+	// returns false if the cgroup does not exist anymore
+	bool sample(const keyT &key, stateT &state) const;
+	std::string group_path(const keyT &key) const;
+
+  private:
+	std::string root;
+	std::chrono::milliseconds interval;
+	double alpha;
+
+	std::map<keyT, stateT> states;
+	std::mutex mtx;
+
+	std::thread sampler;
+	bool running;
+};
+
+#endif /* end of include guard: poncos_psi_monitor */
@@ -0,0 +1,133 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_rack
+#define poncos_rack
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fast-lib/mqtt_communicator.hpp>
+#include <fast-lib/serializable.hpp>
+
+#include "poncos/controller.hpp"
+#include "poncos/job.hpp"
+
+// topic: fast/poncos/racks/<rack>/status
+struct rack_statusT : public fast::Serializable {
+	YAML::Node emit() const override;
+	void load(const YAML::Node &node) override;
+
+	std::string rack;
+	capacity_summaryT capacity;
+	// number of jobs submitted to the rack, the ids below are known to the rack
+	size_t submitted = 0;
+	// ids of the jobs in the queue of the rack
+	std::vector<size_t> pending;
+	std::vector<size_t> running;
+};
+
+// Publishes the capacity summary of the controller and the jobs of the queue of a rack periodically. Used by
+// poncos instances managing a single rack (--rack) of a two-level setup.
+class rack_reporterT {
+  public:
+	rack_reporterT(std::shared_ptr<fast::MQTT_communicator> comm, const controllerT &controller, job_queueT &job_queue,
+				   std::string rack, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+	~rack_reporterT();
+
+	// starts/stops reporting
+	void start();
+	void stop();
+
+  private:
+	void report();
+
+  private:
+	std::shared_ptr<fast::MQTT_communicator> comm;
+	const controllerT &controller;
+	job_queueT &job_queue;
+	std::string rack;
+	std::chrono::milliseconds interval;
+
+	std::thread reporter;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool running = false;
+};
+
+// Top-level scheduler of a two-level setup (--racks). Every rack is managed by its own poncos instance that
+// creates, measures and co-schedules the domains of its nodes and reports its aggregated capacity. The dispatcher
+// only decides on the rack of a job: the least loaded rack with enough free CPUs and memory. Jobs are forwarded
+// to the submission server of the rack, i.e. a rack never waits for the top-level to handle its nodes. Jobs no
+// rack can run are dropped, the pending jobs of a rack that stopped reporting are dispatched to another one.
+class rack_dispatcherT {
+  public:
+	rack_dispatcherT(std::shared_ptr<fast::MQTT_communicator> comm, std::vector<std::string> racks);
+
+	// dispatches the jobs of job_queue until it is closed and all jobs completed, the racks are closed afterwards
+	void dispatch(job_queueT &job_queue);
+	// reason why no rack can ever run job as of the last reports, empty if a rack may run it
+	std::string reject_reason(const jobT &job);
+
+  private:
+	struct dispatched_jobT {
+		// id in the queue of the dispatcher
+		size_t queue_id;
+		jobT job;
+	};
+
+	struct rackT {
+		std::string name;
+		rack_statusT status;
+		std::chrono::steady_clock::time_point last_report;
+		bool reported = false;
+		// false once the rack refused a job, e.g. its queue was closed by someone else, or stopped reporting
+		bool open = true;
+		// jobs submitted to the rack by their id in the rack
+		std::map<size_t, dispatched_jobT> jobs;
+	};
+
+	void receive(const std::string &message);
+	// next job of the queue or a job of a dead rack, false once the queue is closed and all jobs completed
+	bool next_job(size_t &queue_id, jobT &job);
+	// rack with the lowest load that can start job right away, racks.size() if there is none. The racks in refused
+	// are skipped.
+	size_t select(const jobT &job, const std::vector<size_t> &refused) const;
+	// reason why no open rack but those in refused can ever run job, expects mtx to be locked
+	std::string infeasible(const jobT &job, const std::vector<size_t> &refused) const;
+	// gives up the racks that did not report for RACK_EXPIRY, expects mtx to be locked
+	void expire_racks();
+	// free CPUs of the rack minus the CPUs of the jobs not started by the rack as of its last report
+	size_t expected_free_cpus(const rackT &rack) const;
+	// status of the job as replied by the rack, unknown if the rack did not reply
+	std::string submit(const size_t rack, const size_t queue_id, const jobT &job);
+	void close(const size_t rack);
+
+  private:
+	std::shared_ptr<fast::MQTT_communicator> comm;
+	std::vector<rackT> racks;
+	job_queueT *job_queue = nullptr;
+	// jobs of dead racks to be dispatched again
+	std::deque<dispatched_jobT> rerouted;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+};
+
+YAML_CONVERT_IMPL(rack_statusT)
+
+#endif /* end of include guard: poncos_rack */
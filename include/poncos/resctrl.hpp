@@ -0,0 +1,51 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_resctrl
+#define poncos_resctrl
+
+#include <string>
+#include <vector>
+
+// Thin wrapper around the Linux resctrl file system (memory bandwidth allocation and
+// L3 cache allocation). The root path may contain "%h", which is replaced by the host name
+// the group lives on, e.g. to access the resctrl trees of several nodes or a mock tree.
+class resctrlT {
+  public:
+	resctrlT(std::string root = "/sys/fs/resctrl");
+
+	// creates the resctrl group 'name' on 'host' with the given schemata
+	void create_group(const std::string &host, const std::string &name, const std::string &schemata) const;
+	// removes the resctrl group 'name' on 'host'
+	void remove_group(const std::string &host, const std::string &name) const;
+	// overwrites the schemata of an existing group
+	void write_schemata(const std::string &host, const std::string &name, const std::string &schemata) const;
+
+	// generates a schemata applying mba and l3_mask to all domains available on host
+	// mba == 0 or an empty l3_mask leave the respective resource untouched
+	std::string generate_schemata(const std::string &host, const unsigned int mba, const std::string &l3_mask) const;
+
+	// true if the group 'name' exists on 'host'
+	bool group_exists(const std::string &host, const std::string &name) const;
+	// sum of the MBM 'event' counter (mbm_total_bytes or mbm_local_bytes) over all L3 domains of a group
+	unsigned long long mbm_bytes(const std::string &host, const std::string &name, const std::string &event) const;
+
+	// path of group 'name' on 'host'; an empty name returns the root group
+	std::string group_path(const std::string &host, const std::string &name) const;
+
+  private:
+	// returns the domain ids of 'resource' (e.g. "MB" or "L3") as listed in the root schemata
+	std::vector<std::string> domain_ids(const std::string &host, const std::string &resource) const;
+
+  private:
+	std::string root;
+};
+
+#endif /* end of include guard: poncos_resctrl */
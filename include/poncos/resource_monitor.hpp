@@ -0,0 +1,96 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_resource_monitor
+#define poncos_resource_monitor
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+// resources shared by the jobs of a node: memory bandwidth, NIC throughput and local I/O throughput
+struct resource_vectorT {
+	double membw = 0;
+	double net = 0;
+	double io = 0;
+
+	resource_vectorT &operator+=(const resource_vectorT &other);
+	resource_vectorT &operator-=(const resource_vectorT &other);
+};
+resource_vectorT operator+(resource_vectorT lhs, const resource_vectorT &rhs);
+resource_vectorT operator*(resource_vectorT lhs, const double factor);
+std::ostream &operator<<(std::ostream &os, const resource_vectorT &resources);
+
+// true if any resource of usage is above its limit, resources with a limit of 0 are not constrained
+bool exceeds(const resource_vectorT &usage, const resource_vectorT &limit);
+// highest fraction of capacity used by any constrained resource (dominant share)
+double dominant_share(const resource_vectorT &usage, const resource_vectorT &capacity);
+
+// Samples the NIC throughput of hosts (all interfaces but loopback of /proc/net/dev) and the local I/O
+// throughput of cgroups (rbytes and wbytes of io.stat) and keeps an exponentially weighted moving average
+// in GB/s. The memory footprint of cgroups is read on demand. Both roots may contain "%h" (see
+// expand_host_path()).
+class resource_monitorT {
+  public:
+	using clockT = std::chrono::steady_clock;
+
+	// alpha is the weight of a new sample in the moving average
+	resource_monitorT(std::string cgroup_root, std::string proc_root, std::chrono::milliseconds interval,
+					  double alpha = 0.2);
+	~resource_monitorT();
+
+	// starts/stops the background sampling thread
+	void start();
+	void stop();
+
+	// starts sampling the cgroup and the NIC of host; cgroups are dropped automatically once they are removed
+	void watch(const std::string &host, const std::string &group);
+	// NIC throughput of host in GB/s, zero if the host is not watched
+	double net(const std::string &host);
+	// local I/O throughput of the cgroup in GB/s, zero if the group is not watched
+	double io(const std::string &host, const std::string &group);
+	// peak memory usage of the cgroup in MiB (memory.peak, memory.current on older kernels), zero if unknown
+	size_t memory(const std::string &host, const std::string &group) const;
+
+  private:
+	using keyT = std::pair<std::string, std::string>;
+	struct counterT {
+		unsigned long long bytes = 0;
+		clockT::time_point time;
+		double rate = 0;
+		bool initialized = false;
+	};
+
+	// adds a new sample to all watched hosts and groups; expects mtx to be locked
+	void sample_all();
+	// returns false if the counter cannot be read (anymore)
+	bool sample_net(const std::string &host, counterT &counter) const;
+	bool sample_io(const keyT &key, counterT &counter) const;
+	void update(counterT &counter, const unsigned long long bytes) const;
+
+  private:
+	std::string cgroup_root;
+	std::string proc_root;
+	std::chrono::milliseconds interval;
+	double alpha;
+
+	std::map<std::string, counterT> hosts;
+	std::map<keyT, counterT> groups;
+	std::mutex mtx;
+
+	std::thread sampler;
+	bool running;
+};
+
+#endif /* end of include guard: poncos_resource_monitor */
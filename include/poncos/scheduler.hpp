@@ -2,23 +2,145 @@
 #define poncos_scheduler
 
 #include "poncos/controller.hpp"
+#include "poncos/decision_log.hpp"
+#include "poncos/interference_model.hpp"
 #include "poncos/job.hpp"
+#include "poncos/mbm_monitor.hpp"
+#include "poncos/membw_history.hpp"
+#include "poncos/metrics.hpp"
+#include "poncos/progress_monitor.hpp"
+#include "poncos/psi_monitor.hpp"
+#include "poncos/resource_monitor.hpp"
+#include "poncos/threshold_tuner.hpp"
 
 #include <chrono>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <fast-lib/mqtt_communicator.hpp>
 
 struct schedulerT {
+	// default of the highest combined membw utilization of a node
+	static constexpr double DEFAULT_MEMBW_TH = 0.9;
+
 	schedulerT(const system_configT &system_config);
 	virtual ~schedulerT();
-	virtual void schedule(const job_queueT &, fast::MQTT_communicator &, controllerT &, std::chrono::seconds) = 0;
+	virtual void schedule(job_queueT &, fast::MQTT_communicator &, controllerT &, std::chrono::seconds) = 0;
+	// waits for the next job of the queue, the controller is unlocked while waiting for submissions. Jobs that can
+	// never be started (see reject_reason()) are dropped with a warning.
+	bool next_job(job_queueT &job_queue, controllerT &controller, size_t &id, jobT &job) const;
 	virtual void command_done(const size_t config, controllerT &controller) = 0;
-	std::vector<double> run_distgen(fast::MQTT_communicator &comm, const controllerT &controller, const size_t job_id);
+	// reason why job can never be started on the machines of controller, empty if it fits
+	virtual std::string reject_reason(const jobT &job, const controllerT &controller) const;
+	// answered is false for the nodes whose agent timed out, they count as saturated
+	std::vector<double> run_distgen(fast::MQTT_communicator &comm, controllerT &controller, const size_t job_id,
+									std::vector<bool> &answered);
+	std::vector<double> run_mbm(const controllerT &controller, const size_t job_id);
+
+	// measures the membw of job_id with the selected source, the result is given per config element of the job
+	// in the format of distgen (i.e. 1 - membw utilization)
+	std::vector<double> measure_membw(fast::MQTT_communicator &comm, controllerT &controller, const size_t job_id);
+
+	// memory bandwidth capacity of machine in GB/s, 1 if the machines are not calibrated, i.e. the
+	// bandwidth is normalized to the peak bandwidth of the node in this case
+	double membw_capacity_of(const controllerT &controller, const size_t machine) const;
+
+	// use passive MBM measurements instead of distgen
+	void use_mbm(std::shared_ptr<mbm_monitorT> monitor) { mbm_monitor = std::move(monitor); }
+
+	// use pressure stall information as an additional contention signal
+	void use_psi(std::shared_ptr<psi_monitorT> monitor) { psi_monitor = std::move(monitor); }
+	// starts sampling the pressure of all domains of job_id
+	void watch_pressure(const controllerT &controller, const size_t job_id);
+	// maximum pressure of all jobs running on machine (zero if PSI is not used)
+	pressureT pressure_of_node(const controllerT &controller, const size_t machine) const;
+
+	// use the NIC and local I/O throughput as additional resources of the nodes
+	void use_resources(std::shared_ptr<resource_monitorT> monitor) { resource_monitor = std::move(monitor); }
+	// starts sampling the I/O of all domains of job_id and the NICs of their machines
+	void watch_resources(const controllerT &controller, const size_t job_id);
+	// NIC throughput of the whole machine and I/O throughput of job_id on it (membw is not set)
+	resource_vectorT sample_resources(const controllerT &controller, const size_t job_id, const size_t machine) const;
+	// raises the memory reserved by job_id to its measured footprint (memory.peak of its cgroups)
+	void observe_memory(controllerT &controller, const size_t job_id) const;
+	// capacity of all resources of machine, the NIC and I/O are not constrained if the capacity is unknown
+	resource_vectorT capacity_of(const controllerT &controller, const size_t machine) const;
+
+	// highest combined membw utilization (fraction of the capacity) of a node we accept
+	void set_membw_threshold(const double threshold) { membw_th = threshold; }
+	double membw_threshold() const;
+	// adjust the threshold based on the runtimes of the jobs
+	void use_threshold_tuner(std::shared_ptr<threshold_tunerT> tuner) { threshold_tuner = std::move(tuner); }
+
+	// learn the interference of application pairs and use it for co-location decisions
+	void use_interference_model(std::shared_ptr<interference_modelT> model) { interference_model = std::move(model); }
+
+	enum class pairingT { unknown, acceptable, refused };
+	// predicted slowdown of the more affected job if a and b share nodes, 0 if unknown
+	double predict_slowdown(const jobT &a, const jobT &b) const;
+	pairingT predict_pairing(const jobT &a, const jobT &b) const;
+
+	// use the progress reported by the applications to detect harmful co-location
+	void use_progress(std::shared_ptr<progress_monitorT> monitor) { progress_monitor = std::move(monitor); }
+
+	// publishes the decision latencies, measurement durations and per-node utilization
+	void use_metrics(std::shared_ptr<metricsT> _metrics) { metrics = std::move(_metrics); }
+	// observes the time passed since start in histogram, does nothing without metrics
+	void observe_latency(const histogramT histogram, const std::chrono::steady_clock::time_point &start) const;
+
+	// stores every membw measurement per node, slot and job in history
+	void use_history(std::shared_ptr<membw_historyT> _history) { history = std::move(_history); }
+	// 95th percentile of the membw utilization of a slot measured for jobs of the application class of job, 0 if
+	// there is no history
+	double predict_utilization(const jobT &job) const;
+
+	// records the inputs and outcome of every placement and co-scheduling decision, see poncos_replay
+	void use_decision_log(std::shared_ptr<decision_logT> log) { decision_log = std::move(log); }
+	// throughput of the jobs sharing nodes with job_id
+	std::unordered_map<size_t, double> corunner_progress(const controllerT &controller, const size_t job_id) const;
+	// machines of job_id on which a co-runner lost more than MAX_PROGRESS_LOSS of its throughput (as given
+	// by before) since job_id was started
+	std::vector<size_t> progress_loss(const controllerT &controller, const size_t job_id,
+									  const std::unordered_map<size_t, double> &before,
+									  const std::chrono::steady_clock::time_point &started) const;
+
+	// runtime observations for the threshold tuner and the interference model
+	// starts the observation of job_id
+	void observe_job(const size_t job_id);
+	// the job ran at a combined membw utilization of its nodes of at least utilization
+	void observe_utilization(const size_t job_id, const double utilization);
+	// the job shared a node with partner
+	void observe_partner(const size_t job_id, const jobT &partner);
+	// frozen jobs do not reflect the slowdown caused by co-location and are not recorded
+	void discard_observation(const size_t job_id);
+	// passes the runtime of the completed job to the tuner and the interference model
+	void record_runtime(const controllerT &controller, const size_t job_id);
 
   protected:
 	const system_configT &system_config;
+	std::shared_ptr<mbm_monitorT> mbm_monitor;
+	std::shared_ptr<psi_monitorT> psi_monitor;
+	std::shared_ptr<resource_monitorT> resource_monitor;
+	std::shared_ptr<threshold_tunerT> threshold_tuner;
+	std::shared_ptr<interference_modelT> interference_model;
+	std::shared_ptr<progress_monitorT> progress_monitor;
+	std::shared_ptr<metricsT> metrics;
+	std::shared_ptr<membw_historyT> history;
+	std::shared_ptr<decision_logT> decision_log;
+
+  private:
+	struct observationT {
+		std::chrono::steady_clock::time_point start;
+		double utilization = 0;
+		// application classes of the jobs sharing nodes with the job
+		std::vector<std::string> partners;
+		bool valid = true;
+	};
+
+	double membw_th;
+	std::unordered_map<size_t, observationT> observations;
 };
 
 #endif /* end of include guard: poncos_scheduler */
@@ -1,29 +1,89 @@
 #ifndef scheduler_multi_hpp
 #define scheduler_multi_hpp
 
+#include "poncos/controller_offline.hpp"
 #include "poncos/scheduler.hpp"
+#include "poncos/slot_table.hpp"
 
-#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 struct multi_app_sched : public schedulerT {
 	multi_app_sched(const system_configT &system_config);
 
-	virtual void schedule(const job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
+	virtual void schedule(job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
 						  std::chrono::seconds wait_time);
 	virtual void command_done(const size_t id, controllerT &controller);
 
-	std::vector<size_t> check_membw(const controllerT::execute_config &config) const;
-	void update_membw_util(const controllerT::execute_config &old_config,
-						   const controllerT::execute_config &new_config);
-	std::vector<size_t> find_swap_candidates(const std::vector<size_t> &marked_machines) const;
+	// outcome of the search for a new placement of a job running on overloaded machines
+	enum class overloadT { none, swap, unresolved };
+	static const char *name_of(const overloadT result);
+	struct overload_decisionT {
+		overloadT result = overloadT::none;
+		// machines of the job exceeding a threshold or hosting a slowed co-runner
+		std::vector<size_t> marked_machines;
+		std::vector<size_t> swap_candidates;
+		// configuration of the job after the swap, empty unless result is swap
+		controllerT::execute_config new_config;
+	};
+	// checks the machines of config (the configuration job_id was started with) and looks for swap partners if
+	// the controller supports it, nothing is applied
+	overload_decisionT decide_overload(controllerT &controller, const size_t job_id,
+									   const controllerT::execute_config &config,
+									   const std::vector<size_t> &slowed_machines) const;
+	// one free slot per machine for a job using whole slots, the machines least affected by interference first.
+	// Empty if the free slots of the admitting machines do not provide enough CPUs.
+	controllerT::execute_config select_slots(const jobT &job, const controllerT &controller) const;
+
+	// inputs of a decision on job: controller state, utilization, capacity, threshold and the interference model
+	// entries of job and the running jobs
+	YAML::Node decision_inputs(const controllerT &controller, const jobT &job) const;
+	// appends record with the current time and the latency of the decision, does nothing without log
+	void log_decision(YAML::Node &record, const std::chrono::steady_clock::duration latency) const;
+	// restores the inputs of a recorded decision, controller has to be an offline controller. The recorded
+	// interference model entries replace the model, if any.
+	void restore_inputs(offline_controllerT &controller, const YAML::Node &record);
+
+	// machines of config on which any resource exceeds the threshold
+	std::vector<size_t> check_resources(const controllerT &controller, const controllerT::execute_config &config) const;
+	void update_util(const controllerT::execute_config &old_config, const controllerT::execute_config &new_config);
+	std::vector<size_t> find_swap_candidates(const controllerT &controller,
+											 const std::vector<size_t> &marked_machines) const;
 	controllerT::execute_config generate_new_config(const controllerT::execute_config &old_config,
 													const std::vector<size_t> &marked_machines,
 													const std::vector<size_t> &swap_candidates) const;
-	std::vector<size_t> sort_machines_by_membw_util(const std::vector<size_t> &machine_idxs, const bool reverse) const;
+	void rebalance_slots(controllerT &controller, const controllerT::execute_config &config);
+	bool throttle_membw(controllerT &controller, const std::vector<size_t> &marked_machines);
+	std::vector<size_t> sort_machines_by_pressure(const controllerT &controller) const;
+	std::vector<size_t> sort_machines_by_interference(const controllerT &controller, const jobT &job) const;
+	std::vector<size_t> jobs_on_node(const controllerT &controller, const size_t machine) const;
+	// sorts by the dominant share of the resources used on the machines
+	std::vector<size_t> sort_machines_by_load(const std::vector<size_t> &machine_idxs, const bool reverse) const;
+	// reports the membw utilization and co-runners of every running job to the tuner and the interference model
+	void observe_nodes(const controllerT &controller);
+	// sizes util and capacity to the machines of the controller, machines may be added at runtime
+	void track_machines(const controllerT &controller);
+	// reports the average dominant share of the nodes as load of the controller's capacity summary
+	void report_load(controllerT &controller) const;
+	// publishes the resources used on machine, does nothing without metrics
+	void publish_util(const size_t machine) const;
+	// best fitting slot and CPU indices for a job smaller than a slot, no CPUs if nothing fits
+	std::pair<controllerT::execute_config_elemT, std::vector<size_t>> pack_job(const jobT &job,
+																			   const controllerT &controller) const;
 
-	double membw_util_of_node(const size_t &idx) const;
-	std::vector<std::vector<double>> membw_util;
-	std::vector<std::thread> thread_pool;
+	resource_vectorT util_of_node(const size_t &idx) const;
+	// highest usage of the node we accept, the membw threshold applied to the capacity of every resource
+	resource_vectorT threshold_of_node(const size_t &idx) const;
+	// resources used per machine and slot; membw in GB/s (normalized to the peak if the machines are not
+	// calibrated), NIC and I/O throughput in GB/s
+	slot_tableT<resource_vectorT> util;
+	// capacity per machine in the unit of util
+	std::vector<resource_vectorT> capacity;
+	// resources used by sub-slot jobs, removed from the shared slot once they complete
+	std::unordered_map<size_t, resource_vectorT> id_to_share;
+	// jobs throttled by throttle_membw(), their slot settings are restored once a co-runner completes
+	std::unordered_set<size_t> throttled_jobs;
 };
 
 #endif /* end of include guard: scheduler_multi_hpp */
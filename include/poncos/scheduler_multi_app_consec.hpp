@@ -6,7 +6,7 @@
 struct multi_app_sched_consec : public schedulerT {
 	multi_app_sched_consec(const system_configT &system_config);
 
-	virtual void schedule(const job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
+	virtual void schedule(job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
 						  std::chrono::seconds wait_time);
 	virtual void command_done(const size_t id, controllerT &controller);
 };
@@ -5,9 +5,14 @@
 
 struct two_app_sched : public schedulerT {
 	two_app_sched(const system_configT &system_config);
-	virtual void schedule(const job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
+	virtual void schedule(job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
 						  std::chrono::seconds wait_time);
-	virtual void command_done(const size_t config, controllerT &controller);
+	virtual void command_done(const size_t id, controllerT &controller);
+	// jobs have to use one slot of every machine
+	virtual std::string reject_reason(const jobT &job, const controllerT &controller) const;
+	// reason why the scheduler cannot use the slots of the machines, empty if every slot provides the same number of
+	// CPUs summed over all machines
+	static std::string layout_problem(const controllerT &controller);
 
 	// marker if a slot is in use
 	std::vector<bool> co_config_in_use;
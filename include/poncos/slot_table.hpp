@@ -0,0 +1,80 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_slot_table
+#define poncos_slot_table
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// A value per machine and slot stored in a single array (machine-major), i.e. scans over all slots touch
+// contiguous memory instead of one allocation per machine. table[m][s] is the value of slot s of machine m,
+// rows are appended for machines added at runtime.
+template <typename T> class slot_tableT {
+  public:
+	template <typename V> class rowT {
+	  public:
+		rowT(V *data, size_t size) : data(data), count(size) {}
+
+		V &operator[](const size_t slot) const {
+			assert(slot < count);
+			return data[slot];
+		}
+		V *begin() const { return data; }
+		V *end() const { return data + count; }
+		size_t size() const { return count; }
+
+	  private:
+		V *data;
+		size_t count;
+	};
+
+	slot_tableT() = default;
+	slot_tableT(const size_t machines, const size_t slots, const T &value = T())
+		: slot_count(slots), values(machines * slots, value) {}
+
+	rowT<T> operator[](const size_t machine) {
+		assert(machine < size());
+		return rowT<T>(values.data() + machine * slot_count, slot_count);
+	}
+	rowT<const T> operator[](const size_t machine) const {
+		assert(machine < size());
+		return rowT<const T>(values.data() + machine * slot_count, slot_count);
+	}
+
+	// number of machines
+	size_t size() const { return slot_count == 0 ? 0 : values.size() / slot_count; }
+	bool empty() const { return values.empty(); }
+	size_t slots() const { return slot_count; }
+
+	// appends a machine with all slots set to value
+	void append(const size_t slots, const T &value = T()) {
+		assert(empty() || slots == slot_count);
+		slot_count = slots;
+		values.insert(values.end(), slots, value);
+	}
+	// grows or shrinks to machines, new slots are set to value
+	void resize(const size_t machines, const size_t slots, const T &value = T()) {
+		assert(empty() || slots == slot_count);
+		slot_count = slots;
+		values.resize(machines * slots, value);
+	}
+	void clear() { values.clear(); }
+
+	// all values, machine-major
+	const std::vector<T> &flat() const { return values; }
+
+  private:
+	size_t slot_count = 0;
+	std::vector<T> values;
+};
+
+#endif /* end of include guard: poncos_slot_table */
@@ -0,0 +1,85 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_submission_server
+#define poncos_submission_server
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <fast-lib/mqtt_communicator.hpp>
+#include <fast-lib/serializable.hpp>
+
+#include "poncos/controller.hpp"
+#include "poncos/job.hpp"
+
+// topic: fast/poncos/submit (fast/poncos/racks/<rack>/submit for racks)
+struct submission_requestT : public fast::Serializable {
+	YAML::Node emit() const override;
+	void load(const YAML::Node &node) override;
+
+	// submit, status, close, add-machine or remove-machine
+	std::string task;
+	// job to be submitted (submit only)
+	jobT job;
+	// id of the job returned by submit (status only)
+	size_t id = 0;
+	// line of the machine file (add-machine) or host (remove-machine)
+	std::string machine;
+	// echoed in the reply to match requests and replies
+	std::string tag;
+	std::string reply_topic = "fast/poncos/submit/reply";
+};
+
+struct submission_replyT : public fast::Serializable {
+	YAML::Node emit() const override;
+	void load(const YAML::Node &node) override;
+
+	std::string tag;
+	size_t id = 0;
+	// pending, running or done; closed if the queue does not accept jobs; rejected if the job can never be
+	// started; queued for machine changes, refused if they are not enabled; unknown for invalid ids or requests
+	std::string status;
+	// why the job was rejected or the machine change refused
+	std::string reason;
+};
+
+// Accepts jobs at runtime via MQTT and adds them to the job queue. Every request is answered on its
+// reply topic with the id and status of the job. A close request closes the queue, i.e. poncos exits
+// once all jobs were completed. Hosts are added or removed if the server manages the machines of a controller.
+class submission_serverT {
+  public:
+	submission_serverT(std::shared_ptr<fast::MQTT_communicator> comm, job_queueT &job_queue,
+					   std::string topic = "fast/poncos/submit");
+
+	// starts/stops listening for requests
+	void start();
+	void stop();
+	// accepts add-machine and remove-machine requests for controller, they are refused otherwise
+	void manage_machines(controllerT &controller);
+	// rejects submitted jobs for which check returns a reason
+	void check_jobs(std::function<std::string(const jobT &)> check);
+
+  private:
+	void receive(const std::string &message);
+
+  private:
+	std::shared_ptr<fast::MQTT_communicator> comm;
+	job_queueT &job_queue;
+	std::string topic;
+	controllerT *controller = nullptr;
+	std::function<std::string(const jobT &)> job_check;
+};
+
+YAML_CONVERT_IMPL(submission_requestT)
+YAML_CONVERT_IMPL(submission_replyT)
+
+#endif /* end of include guard: poncos_submission_server */
@@ -10,8 +10,14 @@ struct slotT : public fast::Serializable {
 	YAML::Node emit() const override;
 	void load(const YAML::Node &node) override;
 
+	// true if any resctrl setting is specified for this slot
+	bool has_resctrl() const { return mba != 0 || !l3_mask.empty(); }
+
 	std::vector<unsigned int> cpus;
 	std::vector<unsigned int> mems;
+	// optional resctrl settings: MBA in percent (0 == not set) and CAT L3 way mask in hex (empty == not set)
+	unsigned int mba = 0;
+	std::string l3_mask;
 };
 std::ostream &operator<<(std::ostream &os, const slotT &slot);
 
@@ -23,9 +29,14 @@ struct system_configT : public fast::Serializable {
 	YAML::Node emit() const override;
 	void load(const YAML::Node &node) override;
 	size_t slot_size(void) const { return slots[0].cpus.size(); }
+	bool has_resctrl(void) const;
 	const slotT &operator[](const size_t idx) const { return slots[idx]; };
+	// CPUs of the physical core of cpu, i.e. cpu and its SMT siblings
+	std::vector<unsigned int> core_of(const unsigned int cpu) const;
 
 	std::vector<slotT> slots;
+	// optional SMT sibling groups of the CPUs (key "cores"), a CPU without group is a core of its own
+	std::vector<std::vector<unsigned int>> cores;
 };
 
 YAML_CONVERT_IMPL(slotT)
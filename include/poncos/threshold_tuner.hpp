@@ -0,0 +1,58 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_threshold_tuner
+#define poncos_threshold_tuner
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Adjusts the membw threshold of the schedulers based on the observed slowdown of the jobs.
+// The slowdown of a run is its runtime compared to the fastest run of the same command. A line
+// (slowdown = a + b * utilization) is fitted over the most recent runs, where the utilization is the
+// highest combined membw utilization (fraction of the capacity) of the nodes while the job ran. The
+// threshold moves toward the utilization at which the fitted slowdown equals 1 / target efficiency,
+// at most MAX_STEP per run and never beyond [min_threshold, max_threshold].
+class threshold_tunerT {
+  public:
+	threshold_tunerT(double threshold, double target_efficiency, double min_threshold = 0.6,
+					 double max_threshold = 1.0);
+
+	// adds the run of command and adjusts the threshold
+	void record(const std::string &command, double utilization, std::chrono::duration<double> runtime);
+	double threshold();
+
+  private:
+	struct runT {
+		std::string command;
+		double utilization;
+		double runtime;
+	};
+
+	// expects mtx to be locked
+	void adjust();
+
+  private:
+	double current_threshold;
+	double target_efficiency;
+	double min_threshold;
+	double max_threshold;
+
+	// most recent runs used for the fit
+	std::deque<runT> runs;
+	// fastest run per command
+	std::unordered_map<std::string, double> best_runtime;
+	std::mutex mtx;
+};
+
+#endif /* end of include guard: poncos_threshold_tuner */
@@ -0,0 +1,61 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_topology
+#define poncos_topology
+
+#include <string>
+#include <vector>
+
+#include "poncos/system_config.hpp"
+
+// how the CPUs of a node are split into slots
+enum class slot_strategyT {
+	// one slot per socket
+	per_socket,
+	// one slot per NUMA node
+	per_numa,
+	// every slot gets an equal share of the cores of each L3 cache, i.e. slots span all sockets
+	interleaved
+};
+slot_strategyT slot_strategy_from_string(const std::string &name);
+
+struct cpu_infoT {
+	unsigned int id;
+	unsigned int core;
+	unsigned int package;
+	unsigned int node;
+	// id of the L3 cache, identical to package if no L3 information is available
+	unsigned int l3;
+};
+
+// NUMA/SMT/cache topology of the node as described by /sys/devices/system/{cpu,node}
+struct topologyT {
+	topologyT(const std::string &sysfs_root = "/sys/devices/system");
+
+	// generates a slot layout, slots is only used for interleaved
+	system_configT generate(const slot_strategyT strategy, const size_t slots = 2) const;
+	// returns a warning for every conflict between config and the topology
+	std::vector<std::string> validate(const system_configT &config) const;
+
+	// online CPUs ordered by id
+	std::vector<cpu_infoT> cpus;
+	// online CPUs grouped by physical core, i.e. SMT siblings are in the same group
+	std::vector<std::vector<unsigned int>> cores;
+
+  private:
+	const cpu_infoT &cpu(const unsigned int id) const;
+	// NUMA nodes of all CPUs in cpus without duplicates
+	std::vector<unsigned int> nodes_of(const std::vector<unsigned int> &cpu_ids) const;
+	// groups cores by key, e.g. by package
+	template <typename F> std::vector<std::vector<unsigned int>> group_cores(F key) const;
+};
+
+#endif /* end of include guard: poncos_topology */
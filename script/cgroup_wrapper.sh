@@ -1,9 +1,16 @@
 #!/bin/bash
 
-CGROUP="/sys/fs/cgroup/$1"
+CGROUP="${CGROUP_ROOT:-/sys/fs/cgroup}/$1"
 
 echo "$HOSTNAME: writing $$ to $CGROUP/tasks"
 echo $$ > $CGROUP/tasks
 
+# join the resctrl group if poncos created one for this domain
+RESCTRL="/sys/fs/resctrl/$1"
+if [ -d "$RESCTRL" ]; then
+	echo "$HOSTNAME: writing $$ to $RESCTRL/tasks"
+	echo $$ > $RESCTRL/tasks
+fi
+
 echo "$HOSTNAME: starting ${@:2}"
 ${@:2}
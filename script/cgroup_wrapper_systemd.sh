@@ -9,5 +9,12 @@ echo $$ > $CGROUP/tasks
 echo "$HOSTNAME: writing $$ to $FREEZER/tasks"
 echo $$ > $FREEZER/tasks
 
+# join the resctrl group if poncos created one for this domain
+RESCTRL="/sys/fs/resctrl/$1"
+if [ -d "$RESCTRL" ]; then
+	echo "$HOSTNAME: writing $$ to $RESCTRL/tasks"
+	echo $$ > $RESCTRL/tasks
+fi
+
 echo "$HOSTNAME: starting ${@:2}"
 ${@:2}
@@ -1,38 +1,118 @@
 #include "poncos/controller.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <map>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 
+#include <dirent.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
 #include "poncos/poncos.hpp"
 
 // inititalize fast-lib log
 FASTLIB_LOG_INIT(controller_log, "controller")
 FASTLIB_LOG_SET_LEVEL_GLOBAL(controller_log, info);
 
-controllerT::controllerT(std::shared_ptr<fast::MQTT_communicator> _comm, const std::string &machine_filename,
-						 const system_configT &system_config)
-	: machines(_machines), available_slots(_available_slots), machine_usage(_machine_usage),
-	  id_to_config(_id_to_config), id_to_job(_id_to_job), system_config(system_config), cmd_counter(0),
-	  work_counter_lock(worker_counter_mutex), comm(std::move(_comm)), timestamps(true, "timestamps"),
-	  _done_called(false) {
+// the journal is compacted into a snapshot once it holds this many records
+constexpr size_t JOURNAL_COMPACT_RECORDS = 1024;
+// jobs adopted after a restart are no children of poncos, their process is polled instead
+constexpr std::chrono::seconds ADOPT_POLL_INTERVAL(1);
+// machines added or removed at runtime are applied at least this often while waiting for resources
+constexpr std::chrono::milliseconds MACHINE_CHANGE_POLL_INTERVAL(1000);
 
-	// fill the machine file
-	FASTLIB_LOG(controller_log, info) << "Reading machine file " << machine_filename << " ...";
-	read_file(machine_filename, _machines);
+extern char **environ;
 
-	FASTLIB_LOG(controller_log, info) << "Machine file:";
-	FASTLIB_LOG(controller_log, info) << "==============";
-	for (const std::string &c : _machines) {
-		FASTLIB_LOG(controller_log, info) << c;
+drain_policyT drain_policy_from_string(const std::string &policy) {
+	if (policy == "keep") return drain_policyT::keep;
+	assert(policy == "kill");
+	return drain_policyT::kill;
+}
+
+// starts command via /bin/sh in a new process group, i.e. mpiexec and its ranks can be signaled at once
+static pid_t spawn_command(const std::string &command) {
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attr, 0);
 
-		std::string topic = "fast/migfra/" + c + "/task";
-		comm->add_subscription(topic);
+	const char *argv[] = {"sh", "-c", command.c_str(), nullptr};
+	pid_t pid;
+	const auto temp = posix_spawn(&pid, "/bin/sh", nullptr, &attr, const_cast<char *const *>(argv), environ);
+	posix_spawnattr_destroy(&attr);
+	assert(temp == 0);
 
-		topic = "fast/migfra/" + c + "/result";
-		comm->add_subscription(topic);
+	return pid;
+}
+
+// host of a line of the machine file
+static std::string host_of(const std::string &line) {
+	std::stringstream line_stream(line);
+	std::string host;
+	line_stream >> host;
+	return host;
+}
+
+// start time of the process in clock ticks after boot (field 22 of /proc/<pid>/stat), false if there is no such
+// process
+static bool process_start_time(const pid_t pid, unsigned long long &ret) {
+	std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+	std::string stat;
+	if (!std::getline(file, stat)) return false;
+
+	// the command name may contain spaces, the fields following it start with the state (field 3)
+	const auto pos = stat.rfind(')');
+	if (pos == std::string::npos) return false;
+	std::stringstream fields(stat.substr(pos + 1));
+	std::string field;
+	for (size_t i = 3; i < 22; ++i) {
+		fields >> field;
 	}
-	FASTLIB_LOG(controller_log, info) << "==============";
+	return static_cast<bool>(fields >> ret);
+}
+
+// pid of the /bin/sh started by spawn_command whose command line contains marker, 0 if there is none
+static pid_t find_command(const std::string &marker) {
+	DIR *proc = opendir("/proc");
+	if (proc == nullptr) return 0;
+
+	pid_t ret = 0;
+	while (const dirent *entry = readdir(proc)) {
+		if (!std::isdigit(entry->d_name[0])) continue;
+
+		std::ifstream file(std::string("/proc/") + entry->d_name + "/cmdline");
+		const std::string cmdline((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (cmdline.compare(0, 6, std::string("sh\0-c\0", 6)) != 0) continue;
+		if (cmdline.find(marker) == std::string::npos) continue;
+
+		ret = static_cast<pid_t>(std::stol(entry->d_name));
+		break;
+	}
+	closedir(proc);
+	return ret;
+}
+
+controllerT::controllerT(std::shared_ptr<fast::MQTT_communicator> _comm, const std::string &machine_filename,
+						 const system_configT &system_config, node_config_sourceT node_configs)
+	: machines(_machines), available_slots(_available_slots), machine_usage(_machine_usage), core_usage(_core_usage),
+	  id_to_config(_jobs, &job_entryT::config), id_to_job(_jobs, &job_entryT::job), system_config(system_config), node_config(_node_config),
+	  membw_capacity(_membw_capacity), net_capacity(_net_capacity), io_capacity(_io_capacity),
+	  mem_capacity(_mem_capacity), node_slots(_node_slots), next_id(cmd_counter), drained(_drained),
+	  removed(_removed),
+	  cmd_counter(0),
+	  work_counter_lock(worker_counter_mutex), comm(std::move(_comm)),
+	  _agent_deadline(0), _agent_retries(0), _drain_policy(drain_policyT::keep), _recovered(false),
+	  _done_called(false), _node_config_source(std::move(node_configs)) {
 
 	FASTLIB_LOG(controller_log, info) << "System config:";
 	FASTLIB_LOG(controller_log, info) << "==============";
@@ -41,88 +121,217 @@ controllerT::controllerT(std::shared_ptr<fast::MQTT_communicator> _comm, const s
 	}
 	FASTLIB_LOG(controller_log, info) << "==============";
 
-	_machine_usage.assign(_machines.size(), std::vector<size_t>{{std::numeric_limits<size_t>::max(),
-																 std::numeric_limits<size_t>::max()}});
+	// offline controllers restore their machines from a snapshot
+	if (machine_filename != "") {
+		FASTLIB_LOG(controller_log, info) << "Reading machine file " << machine_filename << " ...";
+		read_machine_file(machine_filename);
+	}
+	update_summary();
+}
+
+// every line of the machine file lists a host followed by optional key=value pairs:
+//   config=<file>  slot layout of the host (system config in YAML format), defaults to the node config source or
+//                  the global system config
+//   membw=<GB/s>   calibrated memory bandwidth capacity of the host
+//   net=<GB/s>     NIC throughput capacity of the host
+//   io=<GB/s>      local I/O throughput capacity of the host
+//   mem=<MiB>      memory available to jobs on the host
+void controllerT::read_machine_file(const std::string &filename) {
+	std::vector<std::string> lines;
+	read_file(filename, lines);
+
+	FASTLIB_LOG(controller_log, info) << "Machine file:";
+	FASTLIB_LOG(controller_log, info) << "==============";
+	for (const auto &line : lines) {
+		if (line.empty()) continue;
+		append_machine(line);
+	}
+	FASTLIB_LOG(controller_log, info) << "==============";
+
+	// bandwidths of hosts with and without capacity cannot be compared
+	const auto calibrated =
+		std::count_if(_membw_capacity.begin(), _membw_capacity.end(), [](double c) { return c > 0; });
+	assert(calibrated == 0 || static_cast<size_t>(calibrated) == _membw_capacity.size());
+}
+
+size_t controllerT::append_machine(const std::string &line) {
+	std::stringstream line_stream(line);
+	std::string host;
+	line_stream >> host;
+	assert(std::find(_machines.begin(), _machines.end(), host) == _machines.end());
+
+	system_configT config = _node_config_source != nullptr ? _node_config_source(host) : system_config;
+	double capacity = 0;
+	double net = 0;
+	double io = 0;
+	size_t mem = 0;
+	std::string option;
+	while (line_stream >> option) {
+		const size_t pos = option.find('=');
+		assert(pos != std::string::npos);
+		const std::string key = option.substr(0, pos);
+		const std::string value = option.substr(pos + 1);
+
+		if (key == "config") {
+			// configs used by multiple hosts are only loaded once
+			auto iter = _configs.find(value);
+			if (iter == _configs.end()) iter = _configs.emplace(value, system_configT(value)).first;
+			config = iter->second;
+		} else if (key == "membw") {
+			capacity = std::stod(value);
+			assert(capacity > 0);
+		} else if (key == "net") {
+			net = std::stod(value);
+			assert(net > 0);
+		} else if (key == "io") {
+			io = std::stod(value);
+			assert(io > 0);
+		} else if (key == "mem") {
+			mem = std::stoul(value);
+			assert(mem > 0);
+		} else {
+			FASTLIB_LOG(controller_log, warn) << "Ignoring unknown option '" << key << "' of " << host;
+		}
+	}
+	// the slots are paired across hosts, only their size may differ
+	assert(config.slots.size() == system_config.slots.size());
+
+	FASTLIB_LOG(controller_log, info) << host << " (" << config.slot_size() << " CPUs per slot, "
+									  << (capacity > 0 ? std::to_string(capacity) + " GB/s"
+													   : std::string("uncalibrated"))
+									  << ")";
+
+	_machines.push_back(host);
+	_machine_lines.push_back(line);
+	_node_config.push_back(config);
+	_membw_capacity.push_back(capacity);
+	_net_capacity.push_back(net);
+	_io_capacity.push_back(io);
+	_mem_capacity.push_back(mem);
+
+	_machine_usage.append(system_config.slots.size(), std::numeric_limits<size_t>::max());
+	_node_slots.push_back(config.slots);
+	std::vector<std::vector<size_t>> slot_cores;
+	for (const auto &slot : config.slots) {
+		slot_cores.emplace_back(slot.cpus.size(), std::numeric_limits<size_t>::max());
+	}
+	_core_usage.push_back(slot_cores);
 
+	_drained.push_back(false);
+	_removed.push_back(false);
+	_released.push_back(false);
+	_sent_tasks.emplace_back();
 	_available_slots = _machines.size();
+	if (metrics != nullptr) metrics->name_node(_machines.size() - 1, host);
+
+	subscribe_agents(_machines.size() - 1);
+	return _machines.size() - 1;
+}
+
+void controllerT::reset_machines() {
+	_machines.clear();
+	_machine_lines.clear();
+	_node_config.clear();
+	_membw_capacity.clear();
+	_net_capacity.clear();
+	_io_capacity.clear();
+	_mem_capacity.clear();
+	_machine_usage.clear();
+	_node_slots.clear();
+	_core_usage.clear();
+	_drained.clear();
+	_removed.clear();
+	_released.clear();
+	_sent_tasks.clear();
+	_available_slots = 0;
+}
+
+void controllerT::subscribe_agents(const size_t machine) {
+	if (comm == nullptr) return;
+	const std::string &host = machines[machine];
+	comm->add_subscription("fast/migfra/" + host + "/task");
+	comm->add_subscription("fast/migfra/" + host + "/result");
+	comm->add_subscription("fast/agent/" + host + "/mmbwmon/response");
+}
+
+void controllerT::unsubscribe_agents(const size_t machine) {
+	if (comm == nullptr) return;
+	const std::string &host = machines[machine];
+	comm->remove_subscription("fast/migfra/" + host + "/task");
+	comm->remove_subscription("fast/migfra/" + host + "/result");
+	comm->remove_subscription("fast/agent/" + host + "/mmbwmon/response");
 }
 
 controllerT::~controllerT() {
 	assert(_done_called);
-	for (auto &t : thread_pool) {
-		if (t.joinable()) t.join();
+	for (const auto id : _jobs.ids()) {
+		if (_jobs[id].thread.joinable()) _jobs[id].thread.join();
 	}
-	thread_pool.resize(0);
-
-	FASTLIB_LOG(controller_log, info) << "Controller timestamps:";
-	FASTLIB_LOG(controller_log, info) << "==========================";
-	FASTLIB_LOG(controller_log, info) << "\n" << timestamps.emit();
 }
 
 void controllerT::done() {
 	// wait until all workers are finished
 	if (!work_counter_lock.owns_lock()) work_counter_lock.lock();
 	worker_counter_cv.wait(work_counter_lock, [&] {
-		for (auto i : machine_usage) {
-			for (size_t s = 0; s < system_config.slots.size(); ++s) {
-				if (i[s] != std::numeric_limits<size_t>::max()) return false;
-			}
-		}
-
-		return true;
+		const auto &usage = machine_usage.flat();
+		return std::all_of(usage.begin(), usage.end(),
+						   [](size_t id) { return id == std::numeric_limits<size_t>::max(); });
 	});
 
 	_done_called = true;
 }
 
 void controllerT::freeze(const size_t id) {
-	assert(id < id_to_config.size());
+	assert(_jobs.contains(id));
 
-	timestamps.tick("freeze-job-#" + std::to_string(id));
+	record_event(event_typeT::job_frozen, id);
 
 	const execute_config &config = id_to_config[id];
-	suspend_resume_config<fast::msg::migfra::Suspend>(config);
+	suspend_resume_config<fast::msg::migfra::Suspend>(config, id);
 }
 
 void controllerT::thaw(const size_t id) {
-	assert(id < id_to_config.size());
+	// the job may have completed while it was frozen
+	if (!_jobs.contains(id)) return;
 
 	const execute_config &config = id_to_config[id];
-	suspend_resume_config<fast::msg::migfra::Resume>(config);
+	suspend_resume_config<fast::msg::migfra::Resume>(config, id);
 
-	timestamps.tock("freeze-job-#" + std::to_string(id));
+	record_event(event_typeT::job_thawed, id);
 }
 
 void controllerT::freeze_opposing(const size_t id) {
 	const execute_config opposing_config = generate_opposing_config(id);
 
-	suspend_resume_config<fast::msg::migfra::Suspend>(opposing_config);
+	suspend_resume_config<fast::msg::migfra::Suspend>(opposing_config, std::numeric_limits<size_t>::max());
 }
 
 void controllerT::thaw_opposing(const size_t id) {
 	const execute_config &opposing_config = generate_opposing_config(id);
 
-	suspend_resume_config<fast::msg::migfra::Resume>(opposing_config);
+	suspend_resume_config<fast::msg::migfra::Resume>(opposing_config, std::numeric_limits<size_t>::max());
 }
 
-void controllerT::wait_for_ressource(const size_t requested, const size_t slots_per_host) {
-	if (!work_counter_lock.owns_lock()) work_counter_lock.lock();
-
-	worker_counter_cv.wait(work_counter_lock, [&] {
+void controllerT::wait_for_ressource(const size_t requested, const size_t slots_per_host, const size_t memory) {
+	wait_until([&] {
 		// TODO maybe we should not do this lazy but keep it updated all the time
 		size_t counter = 0;
 
-		for (auto i : machine_usage) {
+		for (size_t m = 0; m < machine_usage.size(); ++m) {
+			if (!admits(m, memory)) continue;
+
 			size_t allocated_slots = 0;
+			size_t allocated_cpus = 0;
 			for (size_t s = 0; s < system_config.slots.size(); ++s) {
-				if (i[s] == std::numeric_limits<size_t>::max()) {
+				if (machine_usage[m][s] == std::numeric_limits<size_t>::max()) {
 					++allocated_slots;
+					allocated_cpus += node_config[m][s].cpus.size();
 
 					if (allocated_slots == slots_per_host) break;
 				}
 			}
 			if (allocated_slots == slots_per_host) {
-				counter += system_config.slot_size() * slots_per_host;
+				counter += allocated_cpus;
 			}
 		}
 
@@ -130,23 +339,78 @@ void controllerT::wait_for_ressource(const size_t requested, const size_t slots_
 	});
 }
 
+void controllerT::wait_for_cores(const size_t requested, const size_t memory) {
+	wait_until([&] {
+		for (size_t m = 0; m < machines.size(); ++m) {
+			if (!admits(m, memory)) continue;
+			for (size_t s = 0; s < system_config.slots.size(); ++s) {
+				if (free_cores({m, s}).size() >= requested) return true;
+			}
+		}
+		return false;
+	});
+}
+
 void controllerT::wait_for_change() {
 	if (!work_counter_lock.owns_lock()) work_counter_lock.lock();
 
 	worker_counter_cv.wait(work_counter_lock);
+	apply_machine_changes();
+	probe_drained();
+}
+
+void controllerT::wait_until(const std::function<bool()> &predicate) {
+	if (!work_counter_lock.owns_lock()) work_counter_lock.lock();
+
+	// changes of the machines are queued by other threads without the lock, i.e. they are polled
+	while (true) {
+		apply_machine_changes();
+		probe_drained();
+		if (predicate()) return;
+		worker_counter_cv.wait_for(work_counter_lock, MACHINE_CHANGE_POLL_INTERVAL);
+	}
+}
+
+void controllerT::reject() {
+	if (!work_counter_lock.owns_lock()) work_counter_lock.lock();
+
+	YAML::Node record;
+	record["type"] = "rejected";
+	record["id"] = cmd_counter;
+	journal_record(record);
+	++cmd_counter;
 }
 
 void controllerT::wait_for_completion_of(const size_t id) {
-	assert(id < id_to_tpool.size());
+	if (!work_counter_lock.owns_lock()) work_counter_lock.lock();
+
+	worker_counter_cv.wait(work_counter_lock, [&] { return !running(id); });
 	work_counter_lock.unlock();
+}
+
+void controllerT::unlock() {
+	if (work_counter_lock.owns_lock()) work_counter_lock.unlock();
+}
 
-	thread_pool[id_to_tpool[id]].join();
+void controllerT::set_job_env(const std::string &name, const std::string &value) {
+	for (auto &env : _job_env) {
+		if (env.first != name) continue;
+		env.second = value;
+		return;
+	}
+	_job_env.emplace_back(name, value);
 }
 
-void controllerT::unlock() { work_counter_lock.unlock(); }
+std::string controllerT::job_env_args(const size_t id) const {
+	std::string ret = " -genv PONCOS_JOB " + cmd_name_from_id(id);
+	for (const auto &env : _job_env) {
+		ret += " -genv " + env.first + " " + env.second;
+	}
+	return ret;
+}
 
 controllerT::execute_config controllerT::generate_opposing_config(const size_t id) const {
-	assert(id < id_to_config.size());
+	assert(_jobs.contains(id));
 	assert(system_config.slots.size() == 2);
 
 	execute_config opposing_config;
@@ -162,7 +426,7 @@ controllerT::execute_config controllerT::generate_opposing_config(const size_t i
 }
 
 void controllerT::update_config(const size_t id, const execute_config &new_config) {
-	execute_config &old_config = _id_to_config[id];
+	execute_config &old_config = _jobs[id].config;
 	assert(new_config.size() == old_config.size());
 
 	// update id_to_config for all affected jobs and machine_usage.
@@ -182,7 +446,7 @@ void controllerT::update_config(const size_t id, const execute_config &new_confi
 		}
 
 		// yes? get the oposing config
-		execute_config &op_config = _id_to_config[op_job_id];
+		execute_config &op_config = _jobs[op_job_id].config;
 
 		// find entry that matches our current entry in the new config
 		bool success = false;
@@ -199,95 +463,964 @@ void controllerT::update_config(const size_t id, const execute_config &new_confi
 
 	// "old" config should now be updated to the new config
 	assert(old_config == new_config);
+
+	YAML::Node record;
+	record["type"] = "update";
+	record["id"] = id;
+	record["config"] = new_config;
+	journal_record(record);
+}
+
+void controllerT::resize_slots(const size_t machine, const std::vector<slotT> &new_layout) {
+	assert(resize_supported());
+	assert(machine < machines.size());
+	assert(new_layout.size() == system_config.slots.size());
+
+	record_event(event_typeT::resize_started, std::numeric_limits<size_t>::max(), machine);
+	_node_slots[machine] = new_layout;
+
+	YAML::Node record;
+	record["type"] = "slots";
+	record["machine"] = machine;
+	record["slots"] = new_layout;
+	journal_record(record);
+
+	// a job may use multiple slots of the machine, only repin it once
+	std::vector<size_t> repinned;
+	for (size_t s = 0; s < system_config.slots.size(); ++s) {
+		// the CPU indices of sub-slot jobs refer to the original layout
+		assert(machine_usage[machine][s] != shared_slot);
+
+		for (const auto id : domains_on({machine, s})) {
+			if (std::find(repinned.begin(), repinned.end(), id) != repinned.end()) continue;
+
+			repin_domain(machine, id);
+			repinned.push_back(id);
+		}
+	}
+	record_event(event_typeT::resize_finished, std::numeric_limits<size_t>::max(), machine);
 }
 
-size_t controllerT::execute(const jobT &job, const execute_config &config, std::function<void(size_t)> callback) {
+void controllerT::reset_slots(const size_t machine, const size_t skip_id) {
+	bool resized = false;
+	for (size_t s = 0; s < system_config.slots.size(); ++s) {
+		if (node_slots[machine][s].cpus != node_config[machine][s].cpus) resized = true;
+	}
+	if (!resized) return;
+
+	FASTLIB_LOG(controller_log, info) << "Resetting slots of " << machines[machine];
+	_node_slots[machine] = node_config[machine].slots;
+
+	YAML::Node record;
+	record["type"] = "slots";
+	record["machine"] = machine;
+	record["slots"] = node_slots[machine];
+	journal_record(record);
+
+	std::vector<size_t> repinned{skip_id};
+	for (size_t s = 0; s < system_config.slots.size(); ++s) {
+		for (const auto id : domains_on({machine, s})) {
+			if (std::find(repinned.begin(), repinned.end(), id) != repinned.end()) continue;
+
+			repin_domain(machine, id);
+			repinned.push_back(id);
+		}
+	}
+}
+
+size_t controllerT::execute(const jobT &job, const execute_config &config, std::function<void(size_t)> callback,
+							const size_t queue_id) {
 	assert(work_counter_lock.owns_lock());
 	assert(!config.empty());
 
-	id_to_tpool.push_back(thread_pool.size());
-	_id_to_config.push_back(config);
-	_id_to_job.push_back(job);
+	reclaim_jobs();
+	_jobs.insert(cmd_counter).config = config;
 	for (const auto &i : config) {
 		assert(machine_usage[i.first][i.second] == std::numeric_limits<size_t>::max());
 		_machine_usage[i.first][i.second] = cmd_counter;
 	}
 
-	// create domain before job start
-	create_domain(cmd_counter);
+	return start(job, std::move(callback), queue_id);
+}
 
-	const std::string command = generate_command(job, cmd_counter, config);
-	thread_pool.emplace_back(&controllerT::execute_command_internal, this, command, cmd_counter, callback);
+size_t controllerT::execute(const jobT &job, const execute_config_elemT &slot, const std::vector<size_t> &cores,
+							std::function<void(size_t)> callback, const size_t queue_id) {
+	assert(work_counter_lock.owns_lock());
+	assert(subslot_supported());
+	assert(!cores.empty());
+	assert(job.req_cpus() <= cores.size());
+
+	reclaim_jobs();
+	job_entryT &entry = _jobs.insert(cmd_counter);
+	entry.config = {slot};
+	entry.cores = cores;
+
+	assert(machine_usage[slot.first][slot.second] == std::numeric_limits<size_t>::max() ||
+		   machine_usage[slot.first][slot.second] == shared_slot);
+	_machine_usage[slot.first][slot.second] = shared_slot;
+	for (const auto core : cores) {
+		assert(core_usage[slot.first][slot.second][core] == std::numeric_limits<size_t>::max());
+		_core_usage[slot.first][slot.second][core] = cmd_counter;
+	}
 
-	return cmd_counter++;
+	return start(job, std::move(callback), queue_id);
 }
 
-void controllerT::execute_command_internal(std::string command, size_t counter,
-										   const std::function<void(size_t)> &callback) {
-	const std::string cmd_name = cmd_name_from_id(counter);
+size_t controllerT::start(const jobT &job, std::function<void(size_t)> callback, const size_t queue_id) {
+	_jobs[cmd_counter].job = job;
+	_jobs[cmd_counter].memory = job.memory;
+	_jobs[cmd_counter].running = true;
+
+	// the intent is journaled before anything is started, i.e. a crash in between leaves no unknown domain or process
+	YAML::Node record;
+	record["type"] = "start";
+	record["id"] = cmd_counter;
+	record["job"] = job;
+	record["config"] = id_to_config[cmd_counter];
+	record["cores"] = _jobs[cmd_counter].cores;
+	record["pid"] = 0;
+	record["start-time"] = 0;
+	journal_record(record);
+
+	// create domain before job start
+	create_domain(cmd_counter);
 
+	std::string command = generate_command(job, cmd_counter, id_to_config[cmd_counter]);
 	// command += "| tee ";
 	command += "> ";
-	command += cmd_name + ".log";
+	command += cmd_name_from_id(cmd_counter) + ".log";
 	command += " 2>&1 ";
 
+	// an agent may have missed its deadline while the domain was created, the job cannot run there. Its id is
+	// used by the next job.
+	const auto &config = id_to_config[cmd_counter];
+	const auto drained_machine = [this](const execute_config_elemT &i) { return _drained[i.first]; };
+	if (std::any_of(config.begin(), config.end(), drained_machine)) {
+		FASTLIB_LOG(controller_log, warn) << "Not starting job-#" << cmd_counter
+										  << ", a domain could not be created on a drained machine";
+		delete_domain(cmd_counter);
+		release_job(cmd_counter);
+		_jobs.erase(cmd_counter);
+
+		YAML::Node failed;
+		failed["type"] = "failed";
+		failed["id"] = cmd_counter;
+		journal_record(failed);
+		update_summary();
+		return not_started;
+	}
+
+	record_event(event_typeT::job_started, cmd_counter, event_traceT::none, queue_id);
+	if (metrics != nullptr) metrics->add(counterT::jobs_started);
 	FASTLIB_LOG(controller_log, info) << "Executing command: " << command;
+	const pid_t pid = spawn_command(command);
+	unsigned long long start_time = 0;
+	process_start_time(pid, start_time);
+	_jobs[cmd_counter].process = {pid, start_time};
+
+	YAML::Node spawned;
+	spawned["type"] = "spawned";
+	spawned["id"] = cmd_counter;
+	spawned["pid"] = pid;
+	spawned["start-time"] = start_time;
+	journal_record(spawned);
+
+	_jobs[cmd_counter].thread =
+		std::thread(&controllerT::execute_command_internal, this, command, pid, cmd_counter, callback);
+	const size_t id = cmd_counter++;
+
+	update_summary();
+
+	// the scheduler holds the lock, i.e. no job completes while the snapshot is taken
+	if (journal != nullptr && journal->size() >= JOURNAL_COMPACT_RECORDS) journal->compact();
+
+	return id;
+}
+
+void controllerT::reclaim_jobs() {
+	for (const auto id : _jobs.ids()) {
+		job_entryT &entry = _jobs[id];
+		if (entry.running) continue;
+
+		// the thread has already released the lock, it only notifies the scheduler
+		if (entry.thread.joinable()) entry.thread.join();
+		_jobs.erase(id);
+	}
+}
 
-	timestamps.tick("job-#" + std::to_string(counter));
-	auto temp = system(command.c_str());
-	timestamps.tock("job-#" + std::to_string(counter));
-	assert(temp != -1);
+void controllerT::execute_command_internal(std::string command, pid_t pid, size_t counter,
+										   const std::function<void(size_t)> &callback) {
+	int status;
+	const auto temp = waitpid(pid, &status, 0);
+	record_event(event_typeT::job_finished, counter);
+	assert(temp == pid);
 
 	// we are done, get the lock
 	{
 		std::lock_guard<std::mutex> lock(worker_counter_mutex);
+		FASTLIB_LOG(controller_log, info) << ">> \t '" << command << "' completed";
+		finish(counter, callback);
+	}
+	worker_counter_cv.notify_all();
+}
 
-		// cleanup
-		delete_domain(counter);
+void controllerT::adopt_command_internal(size_t counter, pid_t pid, unsigned long long start_time,
+										 const std::function<void(size_t)> &callback) {
+	// the pid may have been reused by another process if the start time differs
+	unsigned long long current;
+	while (process_start_time(pid, current) && (start_time == 0 || current == start_time)) {
+		std::this_thread::sleep_for(ADOPT_POLL_INTERVAL);
+	}
+	record_event(event_typeT::job_finished, counter);
 
-		controllerT::execute_config cur_config = id_to_config[counter];
-		FASTLIB_LOG(controller_log, info) << ">> \t '" << command << "' completed";
+	{
+		std::lock_guard<std::mutex> lock(worker_counter_mutex);
+		FASTLIB_LOG(controller_log, info) << ">> \t adopted job-#" << counter << " completed";
+		finish(counter, callback);
+	}
+	worker_counter_cv.notify_all();
+}
+
+void controllerT::finish(const size_t id, const std::function<void(size_t)> &callback) {
+	// cleanup
+	delete_domain(id);
+
+	const controllerT::execute_config cur_config = id_to_config[id];
+
+	// give the remaining jobs their original slots back
+	for (const auto &i : cur_config) {
+		reset_slots(i.first, id);
+	}
+	release_job(id);
+
+	YAML::Node record;
+	record["type"] = "done";
+	record["id"] = id;
+	journal_record(record);
+	if (metrics != nullptr) metrics->add(counterT::jobs_finished);
+
+	// the domains of a removed machine are torn down with its last job
+	for (const auto &i : cur_config) {
+		if (_removed[i.first] && !_released[i.first] && idle(i.first)) release_machine(i.first);
+	}
+	update_summary();
+
+	callback(id);
+}
 
-		for (const auto &i : cur_config) {
-			assert(machine_usage[i.first][i.second] != std::numeric_limits<size_t>::max());
+void controllerT::release_job(const size_t id) {
+	for (const auto &i : id_to_config[id]) {
+		assert(machine_usage[i.first][i.second] != std::numeric_limits<size_t>::max());
+		if (machine_usage[i.first][i.second] != shared_slot) {
 			_machine_usage[i.first][i.second] = std::numeric_limits<size_t>::max();
+			continue;
 		}
 
-		callback(counter);
+		// release our CPUs, the slot is free once the last sub-slot job completed
+		auto &cores = _core_usage[i.first][i.second];
+		for (const auto core : _jobs[id].cores) {
+			assert(cores[core] == id);
+			cores[core] = std::numeric_limits<size_t>::max();
+		}
+		if (std::all_of(cores.begin(), cores.end(),
+						[](size_t owner) { return owner == std::numeric_limits<size_t>::max(); })) {
+			_machine_usage[i.first][i.second] = std::numeric_limits<size_t>::max();
+		}
 	}
-	worker_counter_cv.notify_all();
+	_jobs[id].running = false;
+	_jobs[id].frozen = false;
+}
+
+void controllerT::restore_job(const size_t id, const jobT &job, const execute_config &config,
+							  const std::vector<size_t> &cores) {
+	// completed jobs are not restored, i.e. ids may be skipped
+	assert(id >= cmd_counter);
+
+	job_entryT &entry = _jobs.insert(id);
+	entry.job = job;
+	entry.config = config;
+	entry.cores = cores;
+	entry.memory = job.memory;
+	entry.process = {0, 0};
+	entry.running = true;
+
+	for (const auto &i : config) {
+		if (cores.empty()) {
+			_machine_usage[i.first][i.second] = id;
+			continue;
+		}
+		_machine_usage[i.first][i.second] = shared_slot;
+		for (const auto core : cores) {
+			_core_usage[i.first][i.second][core] = id;
+		}
+	}
+
+	cmd_counter = id + 1;
+}
+
+void controllerT::use_journal(std::shared_ptr<journalT> _journal) {
+	journal = std::move(_journal);
+	journal->add_source("controller", [this] { return emit_snapshot(); });
+}
+
+void controllerT::journal_record(YAML::Node record) const {
+	if (journal == nullptr) return;
+	record["source"] = "controller";
+	journal->append(record);
+}
+
+YAML::Node controllerT::emit_snapshot() const {
+	YAML::Node node;
+	node["counter"] = cmd_counter;
+	node["node-slots"] = _node_slots;
+
+	// completed jobs only keep their ids
+	node["jobs"] = YAML::Node(YAML::NodeType::Sequence);
+	for (const auto id : _jobs.ids()) {
+		const job_entryT &entry = _jobs[id];
+		if (!entry.running) continue;
+
+		YAML::Node job;
+		job["id"] = id;
+		job["job"] = entry.job;
+		job["config"] = entry.config;
+		job["cores"] = entry.cores;
+		job["memory"] = entry.memory;
+		job["pid"] = entry.process.first;
+		job["start-time"] = entry.process.second;
+		job["frozen"] = entry.frozen;
+		node["jobs"].push_back(job);
+	}
+
+	// machines may be added or removed at runtime, i.e. the machine file is not sufficient
+	node["machines"] = _machine_lines;
+	node["drained"] = YAML::Node(YAML::NodeType::Sequence);
+	node["removed"] = YAML::Node(YAML::NodeType::Sequence);
+	node["released"] = YAML::Node(YAML::NodeType::Sequence);
+	for (size_t m = 0; m < machines.size(); ++m) {
+		if (_drained[m]) node["drained"].push_back(m);
+		if (_removed[m]) node["removed"].push_back(m);
+		if (_released[m]) node["released"].push_back(m);
+	}
+
+	node["state"] = emit_state();
+	return node;
+}
+
+void controllerT::load_snapshot(const YAML::Node &node) {
+	if (node["machines"]) {
+		const auto lines = node["machines"].as<std::vector<std::string>>();
+		// the ids of the snapshot refer to its machines, the machine file may have changed in between
+		if (lines != _machine_lines) {
+			FASTLIB_LOG(controller_log, info) << "Restoring the machines of the journal";
+			reset_machines();
+			for (const auto &line : lines) {
+				append_machine(line);
+			}
+		}
+	}
+
+	const size_t counter = node["counter"].as<size_t>();
+	_node_slots = node["node-slots"].as<std::vector<std::vector<slotT>>>();
+	assert(_node_slots.size() == machines.size());
+
+	for (const auto &job : node["jobs"]) {
+		const size_t id = job["id"].as<size_t>();
+		restore_job(id, job["job"].as<jobT>(), job["config"].as<execute_config>(),
+					job["cores"].as<std::vector<size_t>>());
+		_jobs[id].memory = job["memory"].as<size_t>();
+		_jobs[id].process = {job["pid"].as<pid_t>(), job["start-time"].as<unsigned long long>()};
+		_jobs[id].frozen = job["frozen"].as<bool>();
+	}
+	cmd_counter = counter;
+
+	for (const auto &machine : node["drained"]) {
+		_drained[machine.as<size_t>()] = true;
+	}
+	for (const auto &machine : node["removed"]) {
+		_removed[machine.as<size_t>()] = true;
+	}
+	for (const auto &machine : node["released"]) {
+		_released[machine.as<size_t>()] = true;
+	}
+
+	load_state(node["state"]);
+}
+
+void controllerT::restore(const YAML::Node &snapshot) {
+	assert(comm == nullptr);
+
+	// the slots of the jobs are dropped with the machines
+	for (const auto id : _jobs.ids()) {
+		assert(!_jobs[id].thread.joinable());
+		_jobs.erase(id);
+	}
+	cmd_counter = 0;
+
+	reset_machines();
+	load_snapshot(snapshot);
+	update_summary();
+}
+
+void controllerT::replay_record(const YAML::Node &record) {
+	const std::string type = record["type"].as<std::string>();
+
+	if (type == "start") {
+		const size_t id = record["id"].as<size_t>();
+		restore_job(id, record["job"].as<jobT>(), record["config"].as<execute_config>(),
+					record["cores"].as<std::vector<size_t>>());
+		_jobs[id].process = {record["pid"].as<pid_t>(), record["start-time"].as<unsigned long long>()};
+	} else if (type == "spawned") {
+		_jobs[record["id"].as<size_t>()].process = {record["pid"].as<pid_t>(),
+													record["start-time"].as<unsigned long long>()};
+	} else if (type == "done") {
+		release_job(record["id"].as<size_t>());
+	} else if (type == "failed") {
+		const size_t id = record["id"].as<size_t>();
+		release_job(id);
+		_jobs.erase(id);
+		cmd_counter = id;
+	} else if (type == "rejected") {
+		cmd_counter = record["id"].as<size_t>() + 1;
+	} else if (type == "update") {
+		controllerT::update_config(record["id"].as<size_t>(), record["config"].as<execute_config>());
+	} else if (type == "slots") {
+		_node_slots[record["machine"].as<size_t>()] = record["slots"].as<std::vector<slotT>>();
+	} else if (type == "freeze" || type == "thaw") {
+		_jobs[record["id"].as<size_t>()].frozen = type == "freeze";
+	} else if (type == "drain" || type == "undrain") {
+		_drained[record["machine"].as<size_t>()] = type == "drain";
+	} else if (type == "memory") {
+		_jobs[record["id"].as<size_t>()].memory = record["memory"].as<size_t>();
+	} else if (type == "add-machine") {
+		size_t machine;
+		add_machine_locked(record["line"].as<std::string>(), machine);
+	} else if (type == "remove-machine") {
+		_removed[record["machine"].as<size_t>()] = true;
+	} else if (type == "release-machine") {
+		_released[record["machine"].as<size_t>()] = true;
+	} else {
+		replay(record);
+	}
+}
+
+bool controllerT::recover(std::function<void(size_t)> callback) {
+	assert(journal != nullptr);
+	assert(cmd_counter == 0);
+	if (!journal->recovered()) return false;
+
+	// nothing is recorded while the journal is replayed
+	auto recovering = std::move(journal);
+	const YAML::Node &snapshot = recovering->snapshot();
+	if (snapshot["controller"]) load_snapshot(snapshot["controller"]);
+	for (const auto &record : recovering->records()) {
+		if (record["source"].as<std::string>() == "controller") replay_record(record);
+	}
+	journal = std::move(recovering);
+	_recovered = true;
+	// jobs completed after the snapshot was taken
+	reclaim_jobs();
+	update_summary();
+
+	FASTLIB_LOG(controller_log, info) << "Recovered " << cmd_counter << " jobs from the journal";
+	for (const auto id : _jobs.ids()) {
+		job_entryT &entry = _jobs[id];
+		// poncos stopped between journaling the start and the pid of a job, it may have been spawned nonetheless
+		if (entry.process.first == 0) {
+			entry.process.first = find_command("> " + cmd_name_from_id(id) + ".log 2>&1 ");
+			process_start_time(entry.process.first, entry.process.second);
+			if (entry.process.first == 0) {
+				FASTLIB_LOG(controller_log, warn) << "job-#" << id << " was not spawned before the restart, it is considered finished";
+			}
+		}
+		FASTLIB_LOG(controller_log, info) << "Adopting job-#" << id << " (pid " << entry.process.first << ")";
+		entry.thread = std::thread(&controllerT::adopt_command_internal, this, id, entry.process.first,
+								   entry.process.second, callback);
+
+		// nobody would thaw the job otherwise
+		if (entry.frozen) suspend_resume_config<fast::msg::migfra::Resume>(entry.config, id);
+	}
+
+	return true;
+}
+
+void controllerT::use_trace(std::shared_ptr<event_traceT> _trace) { trace = std::move(_trace); }
+
+void controllerT::use_metrics(std::shared_ptr<metricsT> _metrics) {
+	metrics = std::move(_metrics);
+	for (size_t m = 0; m < machines.size(); ++m) {
+		metrics->name_node(m, machines[m]);
+	}
+	update_summary();
+}
+
+void controllerT::record_event(const event_typeT type, const size_t id, const size_t machine,
+							   const size_t peer) const {
+	if (trace != nullptr) trace->record(type, id, machine, peer);
+}
+
+bool controllerT::running(const size_t id) const { return _jobs.contains(id) && _jobs[id].running; }
+
+void controllerT::set_agent_deadline(const std::chrono::milliseconds deadline, const size_t retries,
+									 const drain_policyT policy) {
+	_agent_deadline = deadline;
+	_agent_retries = retries;
+	_drain_policy = policy;
+}
+
+bool controllerT::await_agent(const size_t machine, const std::string &topic, std::string &reply,
+							  const std::function<void()> &resend) {
+	if (_drained[machine]) return false;
+	if (_agent_deadline.count() == 0) {
+		reply = comm->get_message(topic);
+		return true;
+	}
+
+	const size_t attempts = resend == nullptr ? 1 : _agent_retries + 1;
+	for (size_t attempt = 1;; ++attempt) {
+		try {
+			reply = comm->get_message(topic, _agent_deadline);
+			return true;
+		} catch (const std::runtime_error &) {
+			// timeout
+		}
+		if (attempt == attempts) break;
+
+		FASTLIB_LOG(controller_log, warn) << "No reply on " << topic << " within " << _agent_deadline.count()
+										  << " ms, retrying";
+		resend();
+	}
+
+	FASTLIB_LOG(controller_log, warn) << "Agent of " << machines[machine] << " missed the deadline on " << topic;
+	drain(machine);
+	return false;
+}
+
+void controllerT::drain(const size_t machine) {
+	assert(machine < machines.size());
+	if (_drained[machine]) return;
+
+	FASTLIB_LOG(controller_log, warn) << "Draining " << machines[machine];
+	_drained[machine] = true;
+
+	YAML::Node record;
+	record["type"] = "drain";
+	record["machine"] = machine;
+	journal_record(record);
+	update_summary();
+
+	if (_drain_policy != drain_policyT::kill) return;
+	for (const auto id : _jobs.ids()) {
+		if (!_jobs[id].running) continue;
+		for (const auto &i : id_to_config[id]) {
+			if (i.first != machine) continue;
+			kill_job(id);
+			break;
+		}
+	}
+}
+
+void controllerT::undrain(const size_t machine) {
+	assert(machine < machines.size());
+	if (!_drained[machine]) return;
+
+	FASTLIB_LOG(controller_log, info) << "Undraining " << machines[machine] << ", its agent replied again";
+	_drained[machine] = false;
+
+	YAML::Node record;
+	record["type"] = "undrain";
+	record["machine"] = machine;
+	journal_record(record);
+	update_summary();
+}
+
+void controllerT::probe_drained() {
+	if (comm == nullptr) return;
+
+	for (size_t m = 0; m < machines.size(); ++m) {
+		if (!_drained[m] || _removed[m]) continue;
+
+		// the late reply to the request that missed the deadline is dropped
+		for (const auto &topic :
+			 {"fast/migfra/" + machines[m] + "/result", "fast/agent/" + machines[m] + "/mmbwmon/response"}) {
+			try {
+				comm->get_message(topic, std::chrono::duration<double>(0));
+			} catch (const std::runtime_error &) {
+				// no reply yet
+				continue;
+			}
+			undrain(m);
+			break;
+		}
+	}
+}
+
+void controllerT::add_machine(const std::string &line) {
+	std::lock_guard<std::mutex> lock(machine_changes_mutex);
+	_machine_changes.emplace_back("add", std::vector<std::string>{line});
+}
+
+void controllerT::remove_machine(const std::string &host) {
+	std::lock_guard<std::mutex> lock(machine_changes_mutex);
+	_machine_changes.emplace_back("remove", std::vector<std::string>{host});
+}
+
+void controllerT::sync_machines(const std::vector<std::string> &lines) {
+	std::lock_guard<std::mutex> lock(machine_changes_mutex);
+	_machine_changes.emplace_back("sync", lines);
+}
+
+void controllerT::apply_machine_changes() {
+	std::vector<std::pair<std::string, std::vector<std::string>>> changes;
+	{
+		std::lock_guard<std::mutex> lock(machine_changes_mutex);
+		changes.swap(_machine_changes);
+	}
+	if (changes.empty()) return;
+
+	for (const auto &change : changes) {
+		if (change.first == "add") {
+			add_machine_now(change.second.front());
+		} else if (change.first == "remove") {
+			remove_machine_now(change.second.front());
+		} else {
+			// the hosts listed are added, all others removed
+			std::vector<std::string> hosts;
+			for (const auto &line : change.second) {
+				if (line.empty()) continue;
+				hosts.push_back(host_of(line));
+				add_machine_now(line);
+			}
+			for (size_t m = 0; m < machines.size(); ++m) {
+				if (std::find(hosts.begin(), hosts.end(), machines[m]) == hosts.end()) remove_machine_now(machines[m]);
+			}
+		}
+	}
+	update_summary();
+}
+
+void controllerT::add_machine_now(const std::string &line) {
+	const std::string host = host_of(line);
+	const auto iter = std::find(machines.begin(), machines.end(), host);
+	if (iter == machines.end() && !machines.empty() &&
+		(line.find("membw=") != std::string::npos) != (membw_capacity.front() > 0)) {
+		FASTLIB_LOG(controller_log, warn) << "Not adding " << host << ": membw must be given for all hosts or none";
+		return;
+	}
+
+	// a new host or a host whose domains were torn down
+	const bool start = iter == machines.end() || _released[static_cast<size_t>(iter - machines.begin())];
+	size_t machine;
+	if (!add_machine_locked(line, machine)) return;
+	FASTLIB_LOG(controller_log, info) << "Adding " << host;
+
+	YAML::Node record;
+	record["type"] = "add-machine";
+	record["line"] = line;
+	journal_record(record);
+
+	if (start) machine_added(machine);
+}
+
+bool controllerT::add_machine_locked(const std::string &line, size_t &machine) {
+	const std::string host = host_of(line);
+	const auto iter = std::find(machines.begin(), machines.end(), host);
+	if (iter == machines.end()) {
+		machine = append_machine(line);
+		return true;
+	}
+
+	machine = static_cast<size_t>(iter - machines.begin());
+	if (!_removed[machine]) return false;
+
+	// the host keeps the slots and capacities it was added with
+	_removed[machine] = false;
+	if (_released[machine]) {
+		_released[machine] = false;
+		subscribe_agents(machine);
+	}
+	return true;
+}
+
+void controllerT::remove_machine_now(const std::string &host) {
+	const auto iter = std::find(machines.begin(), machines.end(), host);
+	if (iter == machines.end()) {
+		FASTLIB_LOG(controller_log, warn) << "Cannot remove unknown host " << host;
+		return;
+	}
+	const auto machine = static_cast<size_t>(iter - machines.begin());
+	if (_removed[machine]) return;
+
+	FASTLIB_LOG(controller_log, info) << "Removing " << host << ", its jobs run to completion";
+	_removed[machine] = true;
+
+	YAML::Node record;
+	record["type"] = "remove-machine";
+	record["machine"] = machine;
+	journal_record(record);
+
+	if (idle(machine)) release_machine(machine);
+}
+
+void controllerT::release_machine(const size_t machine) {
+	FASTLIB_LOG(controller_log, info) << "Releasing " << machines[machine];
+	machine_removed(machine);
+	unsubscribe_agents(machine);
+	_released[machine] = true;
+
+	YAML::Node record;
+	record["type"] = "release-machine";
+	record["machine"] = machine;
+	journal_record(record);
+}
+
+bool controllerT::idle(const size_t machine) const {
+	return std::all_of(machine_usage[machine].begin(), machine_usage[machine].end(),
+					   [](size_t id) { return id == std::numeric_limits<size_t>::max(); });
+}
+
+capacity_summaryT controllerT::summary() const {
+	std::lock_guard<std::mutex> lock(summary_mutex);
+	return _summary;
+}
+
+void controllerT::set_load(const double load) {
+	if (metrics != nullptr) metrics->set(gaugeT::load, load);
+	std::lock_guard<std::mutex> lock(summary_mutex);
+	_summary.load = load;
+}
+
+void controllerT::update_summary() {
+	capacity_summaryT summary;
+	for (size_t m = 0; m < machines.size(); ++m) {
+		if (metrics != nullptr) {
+			const auto row = machine_usage[m];
+			const auto used = std::count_if(row.begin(), row.end(),
+											[](size_t id) { return id != std::numeric_limits<size_t>::max(); });
+			metrics->set(node_gaugeT::slots_used, m, static_cast<double>(used));
+		}
+		if (_removed[m]) continue;
+		++summary.machines;
+
+		for (const auto &slot : node_config[m].slots) {
+			summary.max_job_cpus += slot.cpus.size();
+		}
+		summary.max_job_memory = std::max(summary.max_job_memory, _mem_capacity[m] == 0
+																	  ? std::numeric_limits<size_t>::max()
+																	  : _mem_capacity[m]);
+		if (_drained[m]) {
+			++summary.drained;
+			continue;
+		}
+
+		for (size_t s = 0; s < node_slots[m].size(); ++s) {
+			summary.total_cpus += node_slots[m][s].cpus.size();
+			summary.free_cpus += free_cores({m, s}).size();
+		}
+		const size_t used = used_memory(m);
+		const size_t free_memory = _mem_capacity[m] == 0 ? std::numeric_limits<size_t>::max()
+														 : _mem_capacity[m] - std::min(used, _mem_capacity[m]);
+		summary.free_memory = std::max(summary.free_memory, free_memory);
+	}
+	for (const auto id : _jobs.ids()) {
+		if (_jobs[id].running) ++summary.running;
+	}
+	summary.started = cmd_counter;
+	// a job uses one slot per machine
+	summary.max_job_cpus /= system_config.slots.size();
+
+	if (metrics != nullptr) {
+		metrics->set(gaugeT::machines, static_cast<double>(summary.machines));
+		metrics->set(gaugeT::drained, static_cast<double>(summary.drained));
+		metrics->set(gaugeT::cpus_total, static_cast<double>(summary.total_cpus));
+		metrics->set(gaugeT::cpus_free, static_cast<double>(summary.free_cpus));
+		metrics->set(gaugeT::jobs_running, static_cast<double>(summary.running));
+	}
+
+	std::lock_guard<std::mutex> lock(summary_mutex);
+	summary.load = _summary.load;
+	_summary = summary;
+}
+
+void controllerT::kill_job(const size_t id) {
+	const pid_t pid = _jobs[id].process.first;
+	if (pid <= 0) return;
+
+	FASTLIB_LOG(controller_log, warn) << "Killing job-#" << id << " running on a drained machine";
+	// the job runs in its own process group, i.e. mpiexec and its ranks are terminated as well
+	kill(-pid, SIGTERM);
+}
+
+void controllerT::send_tasks(const size_t machine, const fast::msg::migfra::Task_container &tasks) {
+	if (_drained[machine]) return;
+
+	// drop results that arrived after a deadline was missed, requests to an agent are sequential
+	if (_agent_deadline.count() > 0) {
+		const std::string result_topic = "fast/migfra/" + machines[machine] + "/result";
+		try {
+			while (true) {
+				comm->get_message(result_topic, std::chrono::duration<double>(0));
+			}
+		} catch (const std::runtime_error &) {
+			// no further results queued
+		}
+	}
+
+	_sent_tasks[machine] = tasks.to_string();
+	comm->send_message(_sent_tasks[machine], "fast/migfra/" + machines[machine] + "/task");
+}
+
+bool controllerT::receive_results(const size_t machine, fast::msg::migfra::Result_container &response,
+								  const bool idempotent) {
+	const std::string topic = "fast/migfra/" + machines[machine] + "/result";
+	std::function<void()> resend;
+	if (idempotent) {
+		resend = [this, machine] {
+			comm->send_message(_sent_tasks[machine], "fast/migfra/" + machines[machine] + "/task");
+		};
+	}
+
+	std::string reply;
+	if (!await_agent(machine, topic, reply, resend)) return false;
+	response.from_string(reply);
+	return true;
 }
 
 std::string controllerT::cmd_name_from_id(size_t id) const { return std::string("poncos_") + std::to_string(id); }
 
-template <typename T> void controllerT::suspend_resume_config(const execute_config &config) {
-	// request OP
-	for (auto config_elem : config) {
-		// anything running or is it empty?
-		if (machine_usage[config_elem.first][config_elem.second] == std::numeric_limits<size_t>::max()) continue;
+std::vector<size_t> controllerT::domains_on(const execute_config_elemT &config_elem) const {
+	const size_t usage = machine_usage[config_elem.first][config_elem.second];
+	if (usage == std::numeric_limits<size_t>::max()) return {};
+	if (usage != shared_slot) return {usage};
+
+	std::vector<size_t> ret;
+	for (const auto id : core_usage[config_elem.first][config_elem.second]) {
+		if (id == std::numeric_limits<size_t>::max()) continue;
+		if (std::find(ret.begin(), ret.end(), id) == ret.end()) ret.push_back(id);
+	}
+	return ret;
+}
 
-		std::string topic = "fast/migfra/" + machines[config_elem.first] + "/task";
+std::vector<unsigned int> controllerT::cpus_of(const size_t id, const execute_config_elemT &config_elem) const {
+	const std::vector<size_t> &cores = _jobs[id].cores;
+	const std::vector<unsigned int> &slot_cpus = node_slots[config_elem.first][config_elem.second].cpus;
+	if (cores.empty()) return slot_cpus;
 
-		auto task = std::make_shared<T>(domain_name_from_config_elem(config_elem), true);
+	std::vector<unsigned int> ret;
+	ret.reserve(cores.size());
+	for (const auto core : cores) {
+		ret.push_back(slot_cpus[core]);
+	}
+	return ret;
+}
 
-		fast::msg::migfra::Task_container m;
-		m.tasks.push_back(task);
+std::vector<size_t> controllerT::free_cores(const execute_config_elemT &config_elem) const {
+	const size_t usage = machine_usage[config_elem.first][config_elem.second];
+	const auto &cores = core_usage[config_elem.first][config_elem.second];
+
+	std::vector<size_t> ret;
+	if (usage != std::numeric_limits<size_t>::max() && usage != shared_slot) return ret;
+	for (size_t c = 0; c < cores.size(); ++c) {
+		if (usage == std::numeric_limits<size_t>::max() || cores[c] == std::numeric_limits<size_t>::max()) {
+			ret.push_back(c);
+		}
+	}
+	return ret;
+}
 
-		comm->send_message(m.to_string(), topic);
+size_t controllerT::used_memory(const size_t machine) const {
+	std::vector<size_t> ids;
+	for (size_t s = 0; s < machine_usage[machine].size(); ++s) {
+		for (const auto id : domains_on({machine, s})) {
+			if (std::find(ids.begin(), ids.end(), id) == ids.end()) ids.push_back(id);
+		}
 	}
 
-	// wait for results
-	fast::msg::migfra::Result_container response;
+	size_t used = 0;
+	for (const auto id : ids) {
+		used += _jobs[id].memory;
+	}
+	return used;
+}
+
+bool controllerT::admits(const size_t machine, const size_t memory) const {
+	return !_drained[machine] && !_removed[machine] && memory_fits(machine, memory);
+}
+
+bool controllerT::memory_fits(const size_t machine, const size_t memory) const {
+	if (_mem_capacity[machine] == 0) return true;
+	return used_memory(machine) + memory <= _mem_capacity[machine];
+}
+
+void controllerT::set_memory_footprint(const size_t id, const size_t memory) {
+	if (memory <= _jobs[id].memory) return;
+	_jobs[id].memory = memory;
+
+	YAML::Node record;
+	record["type"] = "memory";
+	record["id"] = id;
+	record["memory"] = memory;
+	journal_record(record);
+}
+
+size_t controllerT::memory_of(const size_t id) const {
+	return _jobs[id].memory;
+}
+
+template <typename T> void controllerT::suspend_resume_config(const execute_config &config, const size_t id) {
+	// domains affected, a shared slot may host several of them
+	std::vector<std::pair<execute_config_elemT, size_t>> targets;
 	for (auto config_elem : config) {
-		// anything running or is it empty?
-		if (machine_usage[config_elem.first][config_elem.second] == std::numeric_limits<size_t>::max()) continue;
+		for (const auto domain_id : domains_on(config_elem)) {
+			if (id != std::numeric_limits<size_t>::max() && domain_id != id) continue;
+			targets.emplace_back(config_elem, domain_id);
+		}
+	}
+
+	// request OP, one task container per machine
+	std::map<size_t, fast::msg::migfra::Task_container> containers;
+	for (const auto &target : targets) {
+		auto task = std::make_shared<T>(domain_name_from_config_elem(target.first, target.second), true);
+		containers[target.first.first].tasks.push_back(task);
+	}
+	for (const auto &container : containers) {
+		send_tasks(container.first, container.second);
+	}
 
-		std::string topic = "fast/migfra/" + machines[config_elem.first] + "/result";
-		response.from_string(comm->get_message(topic));
+	// wait for results, suspending and resuming is idempotent
+	fast::msg::migfra::Result_container response;
+	for (const auto &container : containers) {
+		if (!receive_results(container.first, response, true)) continue;
 
-		if (response.results.front().status != "success") {
-			assert(response.results.front().details !=
+		for (const auto &result : response.results) {
+			if (result.status == "success") continue;
+			assert(result.details !=
 				   "Error suspending domain: Requested operation is not valid: domain is not running");
 		}
 	}
+
+	// jobs frozen during a crash are thawed by recover()
+	constexpr bool frozen = std::is_same<T, fast::msg::migfra::Suspend>::value;
+	std::vector<size_t> recorded;
+	for (const auto &target : targets) {
+		const size_t domain_id = target.second;
+		if (std::find(recorded.begin(), recorded.end(), domain_id) != recorded.end()) continue;
+		recorded.push_back(domain_id);
+
+		job_entryT &entry = _jobs[domain_id];
+		if (metrics != nullptr && frozen && !entry.frozen) {
+			metrics->add(counterT::freezes);
+			entry.frozen_since = std::chrono::steady_clock::now();
+		} else if (metrics != nullptr && !frozen && entry.frozen &&
+				   entry.frozen_since != std::chrono::steady_clock::time_point()) {
+			// jobs frozen before a restart have no freeze time
+			metrics->observe(histogramT::frozen,
+							 std::chrono::duration<double>(std::chrono::steady_clock::now() - entry.frozen_since).count());
+		}
+		entry.frozen = frozen;
+		YAML::Node record;
+		record["type"] = frozen ? "freeze" : "thaw";
+		record["id"] = domain_id;
+		journal_record(record);
+	}
 }
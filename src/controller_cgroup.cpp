@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iostream>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <thread>
 
@@ -14,9 +15,18 @@
 #include <fast-lib/message/agent/mmbwmon/restart.hpp>
 #include <fast-lib/message/agent/mmbwmon/stop.hpp>
 
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(cgroup_controller_log, "cgroup-controller")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(cgroup_controller_log, info);
+
 cgroup_controller::cgroup_controller(const std::shared_ptr<fast::MQTT_communicator> &_comm,
-									 const std::string &machine_filename, const system_configT &system_config)
-	: controllerT(_comm, machine_filename, system_config) {}
+									 const std::string &machine_filename, const system_configT &system_config,
+									 const std::string &resctrl_path, node_config_sourceT node_configs)
+	: controllerT(_comm, machine_filename, system_config, std::move(node_configs)),
+	  use_resctrl(system_config.has_resctrl() || !resctrl_path.empty()),
+	  resctrl_root(resctrl_path.empty() ? "/sys/fs/resctrl" : resctrl_path), resctrl(resctrl_root) {
+	if (use_resctrl) FASTLIB_LOG(cgroup_controller_log, info) << "resctrl enabled at " << resctrl_root;
+}
 
 void cgroup_controller::init() {}
 void cgroup_controller::dismantle() {}
@@ -36,12 +46,12 @@ void cgroup_controller::create_domain(const size_t id) {
 
 		// determine info to create cgroup
 		std::vector<std::vector<unsigned int>> memnode_map;
-		std::vector<unsigned int> mem_nodes(system_config[slot].mems.begin(), system_config[slot].mems.end());
+		const slotT &slot_conf = node_slots[config_elem.first][slot];
+		std::vector<unsigned int> mem_nodes(slot_conf.mems.begin(), slot_conf.mems.end());
 		memnode_map.emplace_back(mem_nodes);
 
 		std::vector<std::vector<unsigned int>> cpu_map;
-		std::vector<unsigned int> cpu_list(system_config[slot].cpus.begin(), system_config[slot].cpus.end());
-		cpu_map.emplace_back(cpu_list);
+		cpu_map.emplace_back(cpus_of(id, config_elem));
 
 		auto iter = task_container_map.find(config_elem.first);
 		if (iter != task_container_map.end()) {
@@ -55,6 +65,8 @@ void cgroup_controller::create_domain(const size_t id) {
 			task->vm_name = cgroup_name;
 			task->vcpu_map = cpu_map;
 			task->memnode_map = memnode_map;
+			// limits the memory of the cgroup on the node
+			if (memory_of(id) > 0) task->memory = memory_of(id);
 
 			fast::msg::migfra::Task_container m;
 			m.tasks.push_back(task);
@@ -63,27 +75,30 @@ void cgroup_controller::create_domain(const size_t id) {
 		}
 	}
 	for (const auto &tc : task_container_map) {
-		const std::string topic = "fast/migfra/" + machines[tc.first] + "/task";
-		comm->send_message(tc.second.to_string(), topic);
+		send_tasks(tc.first, tc.second);
 	}
 
-	// wait for responses
+	// wait for responses, a cgroup cannot be created twice
 	fast::msg::migfra::Result_container response;
 	for (const auto &tc : task_container_map) {
 		// wait for VMs to be started
-		const std::string topic = "fast/migfra/" + machines[tc.first] + "/result";
-		response.from_string(comm->get_message(topic));
+		if (!receive_results(tc.first, response, false)) continue;
 
 		// check success for each result
 		for (auto result : response.results) {
 			assert(result.status == "success");
 		}
 	}
+
+	// the launcher joins the resctrl group, i.e. it must exist before the job is started
+	if (use_resctrl) create_resctrl_groups(id);
 }
 
 void cgroup_controller::delete_domain(const size_t id) {
 	const execute_config &config = id_to_config[id];
 
+	if (use_resctrl) delete_resctrl_groups(id);
+
 	// determine info to create cgroup
 	const std::string cgroup_name = cmd_name_from_id(id);
 
@@ -103,29 +118,161 @@ void cgroup_controller::delete_domain(const size_t id) {
 
 	// send stop tasks
 	for (const auto &tc : task_container_map) {
-		const std::string topic = "fast/migfra/" + machines[tc.first] + "/task";
-		comm->send_message(tc.second.to_string(), topic);
+		send_tasks(tc.first, tc.second);
 	}
 
-	// wait for responses
+	// wait for responses, stopping is idempotent
 	fast::msg::migfra::Result_container response;
 	for (const auto &tc : task_container_map) {
 		// wait for VMs to be started
-		const std::string topic = "fast/migfra/" + machines[tc.first] + "/result";
-		response.from_string(comm->get_message(topic));
+		if (!receive_results(tc.first, response, true)) continue;
 
 		// check success for each result
 		for (auto result : response.results) {
 			assert(result.status == "success");
 		}
 	}
+	id_to_mba.erase(id);
+}
+
+// the vcpu map lists the CPUs of every launcher process in local rank order, the agent sets the cpuset to their union
+// and rebinds the processes, i.e. the split of the launcher follows the resized slots
+void cgroup_controller::repin_domain(const size_t machine, const size_t id) {
+	const std::vector<std::vector<unsigned int>> cpus = launcher_cpus(id, machine);
+
+	FASTLIB_LOG(cgroup_controller_log, info) << "Repinning job-#" << id << " on " << machines[machine] << " to "
+											 << cpus;
+
+	auto task = std::make_shared<fast::msg::migfra::Repin>(cmd_name_from_id(id), cpus, true);
+	fast::msg::migfra::Task_container m;
+	m.tasks.push_back(task);
+	send_tasks(machine, m);
+
+	fast::msg::migfra::Result_container response;
+	if (!receive_results(machine, response, true)) return;
+	for (auto result : response.results) {
+		assert(result.status == "success");
+	}
+}
+
+// the resctrl group of a domain on a host combines the settings of all slots used on that host:
+// the least restrictive MBA value and the union of the L3 way masks. The MBA set by set_mba() overrides the slot
+// settings. Settings that do not restrict the resource are left out when the group is created.
+std::string cgroup_controller::resctrl_schemata(const size_t id, const size_t machine, const bool create) const {
+	unsigned int mba = 0;
+	unsigned long l3_mask = 0;
+	bool l3_unrestricted = false;
+	for (const auto &config_elem : id_to_config[id]) {
+		if (config_elem.first != machine) continue;
+		const slotT &slot = node_config[config_elem.first][config_elem.second];
+		mba = std::max(mba, slot.mba == 0 ? 100 : slot.mba);
+		if (slot.l3_mask.empty()) {
+			l3_unrestricted = true;
+		} else {
+			l3_mask |= std::stoul(slot.l3_mask, nullptr, 16);
+		}
+	}
+	const auto iter = id_to_mba.find(id);
+	if (iter != id_to_mba.end()) mba = iter->second;
+
+	std::string l3;
+	if (create && !l3_unrestricted) {
+		std::stringstream mask_stream;
+		mask_stream << std::hex << l3_mask;
+		l3 = mask_stream.str();
+	}
+	return resctrl.generate_schemata(machines[machine], create && mba == 100 ? 0 : mba, l3);
+}
+
+// machines of id with a reachable resctrl tree, drained machines are skipped like their agents
+std::vector<size_t> cgroup_controller::resctrl_machines(const size_t id) const {
+	std::vector<size_t> ret;
+	for (const auto &config_elem : id_to_config[id]) {
+		if (drained[config_elem.first]) continue;
+		if (std::find(ret.begin(), ret.end(), config_elem.first) != ret.end()) continue;
+		ret.push_back(config_elem.first);
+	}
+	return ret;
+}
+
+void cgroup_controller::create_resctrl_groups(const size_t id) {
+	for (const auto machine : resctrl_machines(id)) {
+		resctrl.create_group(machines[machine], cmd_name_from_id(id), resctrl_schemata(id, machine, true));
+	}
+}
+
+void cgroup_controller::delete_resctrl_groups(const size_t id) {
+	for (const auto machine : resctrl_machines(id)) {
+		resctrl.remove_group(machines[machine], cmd_name_from_id(id));
+	}
+}
+
+void cgroup_controller::set_mba(const size_t id, const unsigned int mba) {
+	assert(use_resctrl);
+	assert(mba <= 100);
+
+	if (mba == 0) {
+		FASTLIB_LOG(cgroup_controller_log, info) << "restoring the MBA of job-#" << id << " to its slot settings";
+		id_to_mba.erase(id);
+	} else {
+		FASTLIB_LOG(cgroup_controller_log, info) << "setting MBA of job-#" << id << " to " << mba << "%";
+		id_to_mba[id] = mba;
+	}
+
+	for (const auto machine : resctrl_machines(id)) {
+		resctrl.write_schemata(machines[machine], cmd_name_from_id(id), resctrl_schemata(id, machine, false));
+	}
+
+	YAML::Node record;
+	record["type"] = "mba";
+	record["id"] = id;
+	record["mba"] = mba;
+	journal_record(record);
+}
+
+YAML::Node cgroup_controller::emit_state() const {
+	YAML::Node node;
+	for (const auto &mba : id_to_mba) {
+		if (running(mba.first)) node["mba"][std::to_string(mba.first)] = mba.second;
+	}
+	return node;
+}
+
+void cgroup_controller::load_state(const YAML::Node &node) {
+	for (const auto &mba : node["mba"]) {
+		id_to_mba[mba.first.as<size_t>()] = mba.second.as<unsigned int>();
+	}
+}
+
+void cgroup_controller::replay(const YAML::Node &record) {
+	if (record["type"].as<std::string>() != "mba") return;
+	const unsigned int mba = record["mba"].as<unsigned int>();
+	if (mba == 0) {
+		id_to_mba.erase(record["id"].as<size_t>());
+	} else {
+		id_to_mba[record["id"].as<size_t>()] = mba;
+	}
+}
+
+unsigned int cgroup_controller::get_mba(const size_t id) const {
+	const auto iter = id_to_mba.find(id);
+	if (iter != id_to_mba.end()) return iter->second;
+
+	// no dynamic value set, use the static slot settings as applied by create_domain()
+	unsigned int mba = 0;
+	for (const auto &config_elem : id_to_config[id]) {
+		const unsigned int slot_mba = node_config[config_elem.first][config_elem.second].mba;
+		mba = std::max(mba, slot_mba == 0 ? 100 : slot_mba);
+	}
+	return mba;
 }
 
 // TODO should delete the mpi host files!
 cgroup_controller::~cgroup_controller() = default;
 
-std::string cgroup_controller::domain_name_from_config_elem(const execute_config_elemT &config_elem) const {
-	return cmd_name_from_id(machine_usage[config_elem.first][config_elem.second]);
+std::string cgroup_controller::domain_name_from_config_elem(const execute_config_elemT & /*config_elem*/,
+															const size_t id) const {
+	return cmd_name_from_id(id);
 }
 
 void cgroup_controller::update_config(const size_t /*id*/, const execute_config & /*new_config*/) { assert(false); }
@@ -137,69 +284,185 @@ controllerT::execute_config cgroup_controller::sort_config_by_hostname(const exe
 	return sorted_config;
 }
 
-std::string cgroup_controller::generate_command(const jobT &job, size_t counter, const execute_config &config) const {
+// the launcher joins the cgroup, binds the processes to the CPUs/memory nodes of the slots and executes the job
+std::string cgroup_controller::generate_launcher(const size_t id, const size_t machine,
+												 const std::vector<size_t> &slots, const size_t procs) const {
+	std::vector<unsigned int> cpus;
+	std::vector<unsigned int> mems;
+	for (const auto slot : slots) {
+		const slotT &slot_conf = node_slots[machine][slot];
+		cpus.insert(cpus.end(), slot_conf.cpus.begin(), slot_conf.cpus.end());
+		for (const auto mem : slot_conf.mems) {
+			if (std::find(mems.begin(), mems.end(), mem) == mems.end()) mems.push_back(mem);
+		}
+	}
 
-	// TODO refactor, eg seperate file creation (shouln't that be part of controllerT)
+	return generate_launcher(id, cpus, mems, procs);
+}
 
-	// index 0 == slot 0; index 1 == slot 1; index slots == all slots on the same system are used
-	const size_t slots = system_config.slots.size();
-	std::vector<std::vector<std::string>> host_lists(slots+1);
-	std::vector<size_t> hosts_per_slot(slots + 1, 0);
-	std::vector<std::string> commands(slots + 1);
-	execute_config sorted_config = sort_config_by_hostname(config);
+std::string cgroup_controller::generate_launcher(const size_t id, const std::vector<unsigned int> &cpus,
+												 const std::vector<unsigned int> &mems, const size_t procs) const {
+	std::stringstream launcher;
+	launcher << " ./poncos_launch " << cmd_name_from_id(id);
+	launcher << " --cpus ";
+	for (size_t i = 0; i < cpus.size(); ++i) {
+		launcher << (i == 0 ? "" : ",") << cpus[i];
+	}
+	launcher << " --mems ";
+	for (size_t i = 0; i < mems.size(); ++i) {
+		launcher << (i == 0 ? "" : ",") << mems[i];
+	}
+	launcher << " --procs " << procs;
+	if (use_resctrl) launcher << " --resctrl-root " << resctrl_root;
+	launcher << " -- ";
 
-	for (size_t i = 0; i < config.size(); ++i) {
-		// both slots of a system used?
-		if (i + 1 < config.size() && config[i].first == config[i + 1].first) {
-			host_lists[slots].emplace_back(machines[config[i].first]);
-			host_lists[slots].emplace_back(machines[config[i].first]);
-			hosts_per_slot[slots] += 2;
+	return launcher.str();
+}
+
+// a sub-slot job runs on a part of a single slot, so all its processes are started on one host
+std::string cgroup_controller::generate_subslot_command(const jobT &job, size_t counter,
+														const execute_config_elemT &slot) const {
+	const std::vector<unsigned int> cpus = cpus_of(counter, slot);
+	assert(job.req_cpus() <= cpus.size());
+
+	std::string hosts_filename = cmd_name_from_id(counter) + ".hosts";
+	std::ofstream hosts_file(hosts_filename);
+	assert(hosts_file.is_open());
+	hosts_file << machines[slot.first] << ":" << job.nprocs << std::endl;
+	hosts_file.close();
+
+	std::string ret = "mpiexec ";
+	ret += "-f " + hosts_filename + " -genv OMP_NUM_THREADS " + std::to_string(job.threads_per_proc);
+	ret += job_env_args(counter);
+	ret += " -np " + std::to_string(job.nprocs) + " ";
+	ret += generate_launcher(counter, cpus, node_slots[slot.first][slot.second].mems, job.nprocs);
+	ret += job.command;
+	return ret;
+}
+
+std::vector<size_t> cgroup_controller::distribute_ranks(const jobT &job, const execute_config &config,
+														std::vector<std::pair<size_t, std::vector<size_t>>> &hosts) const {
+	// slots and number of processes fitting on every host
+	std::vector<size_t> host_capacity;
+	size_t total_cpus = 0;
+	const execute_config sorted_config = sort_config_by_hostname(config);
+
+	for (size_t i = 0; i < sorted_config.size(); ++i) {
+		const size_t machine = sorted_config[i].first;
+		std::vector<size_t> slots{sorted_config[i].second};
 
+		// both slots of a system used?
+		if (i + 1 < sorted_config.size() && sorted_config[i + 1].first == machine) {
+			slots.push_back(sorted_config[i + 1].second);
+			std::sort(slots.begin(), slots.end());
 			++i;
-			continue;
 		}
-		host_lists[config[i].second].emplace_back(machines[config[i].first]);
-		++hosts_per_slot[config[i].second];
+
+		size_t cpus = 0;
+		for (const auto slot : slots) {
+			cpus += node_config[machine][slot].cpus.size();
+		}
+		total_cpus += cpus;
+
+		hosts.emplace_back(machine, slots);
+		host_capacity.push_back(cpus / job.threads_per_proc);
+	}
+	assert(job.req_cpus() <= total_cpus);
+	assert(std::accumulate(host_capacity.begin(), host_capacity.end(), size_t{0}) >= job.nprocs);
+	(void)total_cpus;
+
+	// the job.nprocs ranks are distributed round-robin over the hosts with processes left
+	std::vector<size_t> host_procs(hosts.size(), 0);
+	for (size_t rank = 0, h = 0; rank < job.nprocs; h = (h + 1) % hosts.size()) {
+		if (host_procs[h] == host_capacity[h]) continue;
+		++host_procs[h];
+		++rank;
 	}
-	assert(job.req_cpus() <= std::accumulate(std::begin(hosts_per_slot), std::end(hosts_per_slot), size_t(0)) *
-								 system_config.slot_size());
+	return host_procs;
+}
+
+std::vector<std::vector<unsigned int>> cgroup_controller::launcher_cpus(const size_t id, const size_t machine) const {
+	const jobT &job = id_to_job[id];
+	const execute_config &config = id_to_config[id];
 
-	for (size_t slot = 0; slot < slots; ++slot) {
-		if (hosts_per_slot[slot] == 0) continue;
+	// the slots of id on machine and the processes the launcher was started with, see generate_command()
+	std::vector<size_t> slots;
+	size_t procs = job.nprocs;
+	if (machine_usage[config[0].first][config[0].second] == shared_slot) {
+		slots.push_back(config[0].second);
+	} else {
+		std::vector<std::pair<size_t, std::vector<size_t>>> hosts;
+		const std::vector<size_t> host_procs = distribute_ranks(job, config, hosts);
+		for (size_t h = 0; h < hosts.size(); ++h) {
+			if (hosts[h].first != machine) continue;
+			slots = hosts[h].second;
+			procs = host_procs[h];
+		}
+	}
 
-		std::string &command = commands[slot];
-		command = " ./cgroup_wrapper.sh ";
-		command += cmd_name_from_id(counter) + " ";
+	std::vector<unsigned int> cpus;
+	for (const auto slot : slots) {
+		const std::vector<unsigned int> slot_cpus = cpus_of(id, {machine, slot});
+		cpus.insert(cpus.end(), slot_cpus.begin(), slot_cpus.end());
+	}
+	assert(!cpus.empty());
+
+	// the same split as done by the launcher based on the local rank
+	if (procs <= 1 || cpus.size() % procs != 0) return {cpus};
+	std::vector<std::vector<unsigned int>> ret;
+	const size_t share = cpus.size() / procs;
+	for (size_t p = 0; p < procs; ++p) {
+		ret.emplace_back(cpus.begin() + static_cast<long>(p * share), cpus.begin() + static_cast<long>((p + 1) * share));
+	}
+	return ret;
+}
 
-		command += job.command;
+std::string cgroup_controller::generate_command(const jobT &job, size_t counter, const execute_config &config) const {
+	if (machine_usage[config[0].first][config[0].second] == shared_slot) {
+		assert(config.size() == 1);
+		return generate_subslot_command(job, counter, config[0]);
 	}
 
-	// some dedicated nodes, requires special cgroup config
-	if (hosts_per_slot[slots] != 0) {
-		std::string &command = commands[slots];
-		command = " ./cgroup_wrapper.sh ";
-		command += cmd_name_from_id(counter) + " ";
+	// TODO refactor, eg seperate file creation (shouln't that be part of controllerT)
 
-		command += job.command;
+	std::vector<std::pair<size_t, std::vector<size_t>>> hosts;
+	const std::vector<size_t> host_procs = distribute_ranks(job, config, hosts);
+
+	// hosts using the same CPUs and number of processes share a launcher, every launcher is started
+	// with its own section of the mpiexec command line
+	std::vector<std::string> launchers;
+	std::vector<size_t> process_per_host;
+	std::vector<std::vector<std::string>> host_lists;
+	for (size_t h = 0; h < hosts.size(); ++h) {
+		const size_t machine = hosts[h].first;
+		const size_t procs = host_procs[h];
+		// not needed to start job.nprocs ranks
+		if (procs == 0) continue;
+
+		const std::string launcher = generate_launcher(counter, machine, hosts[h].second, procs);
+
+		const auto iter = std::find(launchers.begin(), launchers.end(), launcher);
+		if (iter != launchers.end()) {
+			host_lists[static_cast<size_t>(iter - launchers.begin())].emplace_back(machines[machine]);
+			continue;
+		}
+		launchers.push_back(launcher);
+		process_per_host.push_back(procs);
+		host_lists.push_back({machines[machine]});
 	}
 
 	// create hostfile
 	// filename: cmd_name_from_id(counter).hosts
-	// content: one line per allocated slot in accordance with the following scheme
-	//          <hostname>:job.nprocs/hosts_per_slot
+	// content: one line per allocated host in the order of the sections of the command line
+	//          <hostname>:<processes of the host>
 	std::string hosts_filename = cmd_name_from_id(counter) + ".hosts";
 	std::ofstream hosts_file(hosts_filename);
 	assert(hosts_file.is_open());
 
-	size_t process_per_slot = system_config.slot_size() / job.threads_per_proc;
-	assert(system_config.slot_size() % job.threads_per_proc == 0);
-
-	for (size_t i = 0; i <= slots; ++i) {
-		if (hosts_per_slot[i] == 0) continue;
-
+	for (size_t i = 0; i < launchers.size(); ++i) {
 		for (const auto &host : host_lists[i]) {
 			hosts_file << host + ":";
-			hosts_file << process_per_slot;
+			hosts_file << process_per_host[i];
 			hosts_file << std::endl;
 		}
 	}
@@ -207,16 +470,13 @@ std::string cgroup_controller::generate_command(const jobT &job, size_t counter,
 
 	std::string ret = "mpiexec ";
 	ret += "-f " + hosts_filename + " -genv OMP_NUM_THREADS " + std::to_string(job.threads_per_proc);
+	ret += job_env_args(counter);
 
-	// a colon must be added between slots
-	bool add_colon = false;
-	for (size_t slot = 0; slot < slots + 1; ++slot) {
-		if (hosts_per_slot[slot] == 0) continue;
-
-		if (add_colon) ret += " : ";
+	// a colon must be added between sections
+	for (size_t i = 0; i < launchers.size(); ++i) {
+		if (i != 0) ret += " : ";
 
-		ret += " -np " + std::to_string(process_per_slot * hosts_per_slot[slot]) + " " + commands[slot];
-		add_colon = true;
+		ret += " -np " + std::to_string(process_per_host[i] * host_lists[i].size()) + " " + launchers[i] + job.command;
 	}
 	return ret;
 }
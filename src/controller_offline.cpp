@@ -0,0 +1,91 @@
+#include "poncos/controller_offline.hpp"
+
+#include <cassert>
+
+YAML::Node controller_capabilitiesT::emit() const {
+	YAML::Node node;
+	node["update"] = update;
+	node["mba"] = mba;
+	node["resize"] = resize;
+	node["subslot"] = subslot;
+	return node;
+}
+
+void controller_capabilitiesT::load(const YAML::Node &node) {
+	fast::load(update, node["update"], false);
+	fast::load(mba, node["mba"], false);
+	fast::load(resize, node["resize"], false);
+	fast::load(subslot, node["subslot"], false);
+}
+
+controller_capabilitiesT capabilities_of(controllerT &controller) {
+	controller_capabilitiesT capabilities;
+	capabilities.update = controller.update_supported();
+	capabilities.mba = controller.mba_supported();
+	capabilities.resize = controller.resize_supported();
+	capabilities.subslot = controller.subslot_supported();
+	return capabilities;
+}
+
+offline_controllerT::offline_controllerT(const system_configT &system_config,
+										 const controller_capabilitiesT &capabilities)
+	: controllerT(nullptr, "", system_config), capabilities(capabilities) {}
+
+offline_controllerT::~offline_controllerT() {
+	// none of the restored jobs completes, they are dropped with the machines
+	YAML::Node empty;
+	empty["counter"] = 0;
+	empty["node-slots"] = YAML::Node(YAML::NodeType::Sequence);
+	for (const auto key : {"jobs", "machines", "drained", "removed", "released"}) {
+		empty[key] = YAML::Node(YAML::NodeType::Sequence);
+	}
+	restore(empty);
+	done();
+}
+
+void offline_controllerT::update_config(const size_t id, const execute_config &new_config) {
+	assert(capabilities.update);
+	controllerT::update_config(id, new_config);
+}
+
+void offline_controllerT::set_mba(const size_t id, const unsigned int mba) {
+	assert(capabilities.mba);
+	assert(mba <= 100);
+	if (mba == 0) {
+		id_to_mba.erase(id);
+	} else {
+		id_to_mba[id] = mba;
+	}
+}
+
+unsigned int offline_controllerT::get_mba(const size_t id) const {
+	const auto iter = id_to_mba.find(id);
+	return iter != id_to_mba.end() ? iter->second : 100;
+}
+
+std::string offline_controllerT::generate_command(const jobT &job, size_t /*counter*/,
+												  const execute_config & /*config*/) const {
+	return job.command;
+}
+
+std::string offline_controllerT::domain_name_from_config_elem(const execute_config_elemT & /*config_elem*/,
+															   const size_t id) const {
+	return cmd_name_from_id(id);
+}
+
+YAML::Node offline_controllerT::emit_state() const {
+	YAML::Node node;
+	for (const auto &mba : id_to_mba) {
+		if (running(mba.first)) node["mba"][std::to_string(mba.first)] = mba.second;
+	}
+	return node;
+}
+
+void offline_controllerT::load_state(const YAML::Node &node) {
+	id_to_mba.clear();
+	// snapshots of controllers without MBA have no allocations
+	if (!node || !node["mba"]) return;
+	for (const auto &mba : node["mba"]) {
+		id_to_mba[mba.first.as<size_t>()] = mba.second.as<unsigned int>();
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <fstream>
 #include <iostream>
@@ -19,20 +20,19 @@ FASTLIB_LOG_INIT(vm_controller_log, "vm-controller")
 FASTLIB_LOG_SET_LEVEL_GLOBAL(vm_controller_log, info);
 
 vm_controller::vm_controller(const std::shared_ptr<fast::MQTT_communicator> &_comm, const std::string &machine_filename,
-							 const system_configT &system_config, std::string _slot_path)
-	: controllerT(_comm, machine_filename, system_config), slot_path(std::move(_slot_path)) {
-	// subscribe to the various topics
-	for (const std::string &mach : machines) {
-		std::string topic = "fast/migfra/" + mach + "/result";
-		comm->add_subscription(topic);
-	}
-}
+							 const system_configT &system_config, std::string _slot_path,
+							 node_config_sourceT node_configs)
+	: controllerT(_comm, machine_filename, system_config, std::move(node_configs)), slot_path(std::move(_slot_path)) {}
 
 vm_controller::~vm_controller() = default;
 
 void vm_controller::init() {
+	// the VMs of the jobs adopted after a restart keep running
+	if (recovered()) return;
+
 	stop_all_VMs();
 	start_all_VMs();
+	record_vm_locations();
 }
 
 void vm_controller::dismantle() { stop_all_VMs(); }
@@ -40,15 +40,18 @@ void vm_controller::dismantle() { stop_all_VMs(); }
 void vm_controller::create_domain(const size_t /* id */) {}
 void vm_controller::delete_domain(const size_t /* id */) {}
 
-std::string vm_controller::domain_name_from_config_elem(const execute_config_elemT &config_elem) const {
+std::string vm_controller::domain_name_from_config_elem(const execute_config_elemT &config_elem,
+														 const size_t /*id*/) const {
 	return vm_locations[config_elem.first][config_elem.second];
 }
 
 void vm_controller::update_config(const size_t id, const execute_config &new_config) {
-	timestamps.tick("update-config-job-#" + std::to_string(id));
 	const execute_config &old_config = id_to_config[id];
 	assert(old_config.size() == new_config.size());
 
+	// the swaps run concurrently, each one takes from sending its request until its result arrived
+	const auto migration_start = std::chrono::steady_clock::now();
+
 	// request the swap of slots pair-wise
 	for (size_t idx = 0; idx < new_config.size(); ++idx) {
 		const size_t src_host_idx = old_config[idx].first;
@@ -100,11 +103,12 @@ void vm_controller::update_config(const size_t id, const execute_config &new_con
 		FASTLIB_LOG(vm_controller_log, debug) << "sending message \n topic: " << topic << "\n message:\n"
 											  << m.to_string();
 
-		timestamps.tick("swap-" + src_host + "-" + dest_host + "-job-#" + std::to_string(id));
-		comm->send_message(m.to_string(), topic);
+		record_event(event_typeT::migration_started, id, src_host_idx, dest_host_idx);
+		send_tasks(src_host_idx, m);
 	}
 
-	// wait for results
+	// wait for results, swaps that missed the deadline are not applied
+	execute_config applied_config = old_config;
 	fast::msg::migfra::Result_container response;
 	for (size_t idx = 0; idx < new_config.size(); ++idx) {
 		const size_t src_host_idx = old_config[idx].first;
@@ -120,22 +124,56 @@ void vm_controller::update_config(const size_t id, const execute_config &new_con
 			continue;
 		}
 
-		// wait for VMs to be migrated
-		std::string topic = "fast/migfra/" + machines[src_host_idx] + "/result";
-		response.from_string(comm->get_message(topic));
-		timestamps.tock("swap-" + src_host + "-" + dest_host + "-job-#" + std::to_string(id));
+		// wait for VMs to be migrated, a migration must not be repeated
+		const bool received = receive_results(src_host_idx, response, false);
+		record_event(event_typeT::migration_finished, id, src_host_idx, dest_host_idx);
+		if (metrics != nullptr) {
+			metrics->add(counterT::migrations);
+			metrics->observe(histogramT::migration,
+							 std::chrono::duration<double>(std::chrono::steady_clock::now() - migration_start).count());
+		}
+		if (!received) {
+			FASTLIB_LOG(vm_controller_log, warn) << "Swap of job-#" << id << " from " << src_host << " to " << dest_host
+												 << " failed, keeping the VMs in place";
+			continue;
+		}
 		assert(response.results.front().status == "success");
 
 		// update slot allocations
 		std::swap(vm_locations[src_host_idx][src_slot], vm_locations[dest_host_idx][dest_slot]);
+		applied_config[idx] = new_config[idx];
 	}
+	record_vm_locations();
 
 	// update id_to_config for all affected jobs and machine_usage.
-	controllerT::update_config(id, new_config);
+	controllerT::update_config(id, applied_config);
+}
+
+void vm_controller::set_mba(const size_t /*id*/, const unsigned int /*mba*/) { assert(false); }
+
+YAML::Node vm_controller::emit_state() const {
+	YAML::Node node;
+	node["vm-locations"] = vm_locations;
+	return node;
+}
 
-	timestamps.tock("update-config-job-#" + std::to_string(id));
+void vm_controller::load_state(const YAML::Node &node) {
+	vm_locations = node["vm-locations"].as<std::vector<std::vector<std::string>>>();
 }
 
+void vm_controller::replay(const YAML::Node &record) {
+	if (record["type"].as<std::string>() != "vm-locations") return;
+	vm_locations = record["vm-locations"].as<std::vector<std::vector<std::string>>>();
+}
+
+void vm_controller::record_vm_locations() const {
+	YAML::Node record;
+	record["type"] = "vm-locations";
+	record["vm-locations"] = vm_locations;
+	journal_record(record);
+}
+void vm_controller::repin_domain(const size_t /*machine*/, const size_t /*id*/) { assert(false); }
+
 std::vector<std::vector<unsigned int>> vm_controller::generate_vcpu_map(size_t slot_id) const {
 	std::vector<std::vector<unsigned int>> vcpu_map;
 	vcpu_map.reserve(system_config.slot_size());
@@ -148,7 +186,7 @@ std::vector<std::vector<unsigned int>> vm_controller::generate_vcpu_map(size_t s
 	return vcpu_map;
 }
 
-std::string vm_controller::generate_command(const jobT &job, size_t /*counter*/, const execute_config &config) const {
+std::string vm_controller::generate_command(const jobT &job, size_t counter, const execute_config &config) const {
 	std::string host_list;
 	for (const auto &config_elem : config) {
 		host_list += vm_locations[config_elem.first][config_elem.second] + ",";
@@ -157,7 +195,7 @@ std::string vm_controller::generate_command(const jobT &job, size_t /*counter*/,
 	host_list.pop_back();
 
 	return "mpiexec -np " + std::to_string(job.nprocs) + " -genv OMP_NUM_THREADS " +
-		   std::to_string(job.threads_per_proc) + " -hosts " + host_list + " " + job.command;
+		   std::to_string(job.threads_per_proc) + job_env_args(counter) + " -hosts " + host_list + " " + job.command;
 }
 
 // generates start task for a single VM
@@ -199,38 +237,17 @@ std::shared_ptr<fast::msg::migfra::Start> vm_controller::generate_start_task(siz
 }
 
 void vm_controller::start_all_VMs() {
-	for (const auto &mach : machines) {
-		std::string topic = "fast/migfra/" + mach + "/task";
-
-		// create task container and add tasks per slot
-		const size_t slots = system_config.slots.size();
-		fast::msg::migfra::Task_container m;
-		std::vector<std::string> cur_slot_allocation(slots);
-		for (size_t slot = 0; slot < slots; ++slot) {
-			// get free vm
-			vm_pool_elemT free_vm = glob_vm_pool.front();
-			glob_vm_pool.pop_front();
-
-			// generate task
-			auto task = generate_start_task(slot, free_vm);
-
-			// update vm_locations
-			cur_slot_allocation[slot] = free_vm.name;
-			m.tasks.push_back(task);
-		}
-
-		// send start request
-		comm->send_message(m.to_string(), topic);
-
-		// add slot allocation to vm_locations
-		vm_locations.push_back(cur_slot_allocation);
+	vm_locations.resize(machines.size());
+	for (size_t mach = 0; mach < machines.size(); ++mach) {
+		if (removed[mach]) continue;
+		send_start_tasks(mach);
 	}
 
 	fast::msg::migfra::Result_container response;
-	for (const auto &mach : machines) {
+	for (size_t mach = 0; mach < machines.size(); ++mach) {
+		if (removed[mach]) continue;
 		// wait for VMs to be started
-		std::string topic = "fast/migfra/" + mach + "/result";
-		response.from_string(comm->get_message(topic));
+		if (!receive_results(mach, response, false)) continue;
 
 		// check success for each result
 		for (auto result : response.results) {
@@ -241,32 +258,99 @@ void vm_controller::start_all_VMs() {
 
 void vm_controller::stop_all_VMs() {
 	// request stop of all VMs per host
-	size_t mach_id = 0;
-	for (const auto &mach : machines) {
-		// generate stop tasks
-		fast::msg::migfra::Task_container m;
-		auto task = std::make_shared<fast::msg::migfra::Stop>();
-		task->regex = ".*";
-		task->force = true;
-		task->concurrent_execution = true;
+	for (size_t mach = 0; mach < machines.size(); ++mach) {
+		if (removed[mach]) continue;
+		send_stop_tasks(mach);
+	}
+
+	// wait for completion, stopping is idempotent
+	fast::msg::migfra::Result_container response;
+	for (size_t mach = 0; mach < machines.size(); ++mach) {
+		if (removed[mach]) continue;
+		if (!receive_results(mach, response, true)) continue;
+		for (auto result : response.results) {
+			assert(result.status == "success");
+		}
+	}
+}
+
+void vm_controller::send_start_tasks(const size_t mach) {
+	// create task container and add tasks per slot
+	const size_t slots = system_config.slots.size();
+	fast::msg::migfra::Task_container m;
+	std::vector<std::string> cur_slot_allocation(slots);
+	for (size_t slot = 0; slot < slots; ++slot) {
+		// get free vm
+		assert(!glob_vm_pool.empty());
+		vm_pool_elemT free_vm = glob_vm_pool.front();
+		glob_vm_pool.pop_front();
+		vm_pool_elems[free_vm.name] = free_vm;
+
+		// generate task
+		auto task = generate_start_task(slot, free_vm);
+
+		// update vm_locations
+		cur_slot_allocation[slot] = free_vm.name;
 		m.tasks.push_back(task);
+	}
 
-		// send stop request
-		std::string topic = "fast/migfra/" + mach + "/task";
-		FASTLIB_LOG(vm_controller_log, debug) << "sending message \n topic: " << topic << "\n message:\n"
-											  << m.to_string();
-		comm->send_message(m.to_string(), topic);
+	// send start request
+	send_tasks(mach, m);
 
-		mach_id++;
+	// add slot allocation to vm_locations
+	vm_locations[mach] = cur_slot_allocation;
+}
+
+void vm_controller::send_stop_tasks(const size_t mach) {
+	// generate stop tasks
+	fast::msg::migfra::Task_container m;
+	auto task = std::make_shared<fast::msg::migfra::Stop>();
+	task->regex = ".*";
+	task->force = true;
+	task->concurrent_execution = true;
+	m.tasks.push_back(task);
+
+	// send stop request
+	FASTLIB_LOG(vm_controller_log, debug) << "sending message \n topic: fast/migfra/" << machines[mach]
+										  << "/task\n message:\n" << m.to_string();
+	send_tasks(mach, m);
+}
+
+void vm_controller::machine_added(const size_t machine) {
+	vm_locations.resize(machines.size(), std::vector<std::string>(system_config.slots.size()));
+	if (glob_vm_pool.size() < system_config.slots.size()) {
+		FASTLIB_LOG(vm_controller_log, warn) << "Not enough VMs left in the pool for " << machines[machine];
+		drain(machine);
+		return;
 	}
 
-	// wait for completion
+	// VMs left from a previous run are stopped first
 	fast::msg::migfra::Result_container response;
-	for (const auto &mach : machines) {
-		std::string topic = "fast/migfra/" + mach + "/result";
-		response.from_string(comm->get_message(topic));
+	send_stop_tasks(machine);
+	if (!receive_results(machine, response, true)) return;
+
+	send_start_tasks(machine);
+	if (receive_results(machine, response, false)) {
 		for (auto result : response.results) {
 			assert(result.status == "success");
 		}
 	}
+	record_vm_locations();
+}
+
+void vm_controller::machine_removed(const size_t machine) {
+	fast::msg::migfra::Result_container response;
+	send_stop_tasks(machine);
+	receive_results(machine, response, true);
+
+	// the VMs can be started on other hosts, VMs started before a restart are unknown and not reused
+	for (auto &vm : vm_locations[machine]) {
+		const auto iter = vm_pool_elems.find(vm);
+		if (iter != vm_pool_elems.end()) {
+			glob_vm_pool.push_back(iter->second);
+			vm_pool_elems.erase(iter);
+		}
+		vm.clear();
+	}
+	record_vm_locations();
 }
@@ -0,0 +1,34 @@
+#include "poncos/decision_log.hpp"
+
+#include <cassert>
+
+decision_logT::decision_logT(const std::string &path) : file(path, std::ios::app) { assert(file.good()); }
+
+void decision_logT::append(const YAML::Node &record) {
+	YAML::Emitter out;
+	out.SetMapFormat(YAML::Flow);
+	out.SetSeqFormat(YAML::Flow);
+	out << record;
+	assert(out.good());
+
+	std::lock_guard<std::mutex> lock(mtx);
+	file << out.c_str() << std::endl;
+}
+
+std::vector<YAML::Node> decision_logT::read(const std::string &path) {
+	std::ifstream file(path);
+	assert(file.good());
+
+	std::vector<YAML::Node> ret;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty()) continue;
+		try {
+			ret.push_back(YAML::Load(line));
+		} catch (const YAML::Exception &) {
+			// only the last line may be torn
+			assert(file.peek() == std::char_traits<char>::eof());
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,247 @@
+#include "poncos/event_trace.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iomanip>
+#include <map>
+
+static constexpr char TRACE_MAGIC[8] = {'P', 'O', 'N', 'C', 'O', 'S', 'T', '1'};
+static constexpr uint64_t NO_JOB = std::numeric_limits<uint64_t>::max();
+
+const char *to_string(const event_typeT type) {
+	switch (type) {
+	case event_typeT::job_submitted:
+		return "submitted";
+	case event_typeT::job_started:
+		return "started";
+	case event_typeT::job_finished:
+		return "finished";
+	case event_typeT::job_frozen:
+		return "frozen";
+	case event_typeT::job_thawed:
+		return "thawed";
+	case event_typeT::migration_started:
+		return "migration-started";
+	case event_typeT::migration_finished:
+		return "migration-finished";
+	case event_typeT::measurement_started:
+		return "measurement-started";
+	case event_typeT::measurement_finished:
+		return "measurement-finished";
+	case event_typeT::resize_started:
+		return "resize-started";
+	case event_typeT::resize_finished:
+		return "resize-finished";
+	}
+	return "unknown";
+}
+
+event_traceT::event_traceT(const std::string &path, size_t capacity, std::chrono::milliseconds interval)
+	: origin(clockT::now()), interval(interval) {
+	size_t size = 1;
+	while (size < capacity) size <<= 1;
+	ring.reset(new cellT[size]);
+	mask = size - 1;
+
+	file = std::fopen(path.c_str(), "wb");
+	assert(file != nullptr);
+	std::fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, file);
+}
+
+event_traceT::~event_traceT() {
+	stop();
+	std::lock_guard<std::mutex> lock(mtx);
+	flush_locked();
+	std::fclose(file);
+}
+
+void event_traceT::start() {
+	std::lock_guard<std::mutex> lock(mtx);
+	assert(!running);
+	running = true;
+	flusher = std::thread([this] {
+		std::unique_lock<std::mutex> lock(mtx);
+		while (running) {
+			cv.wait_for(lock, this->interval);
+			flush_locked();
+		}
+	});
+}
+
+void event_traceT::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (!running) return;
+		running = false;
+	}
+	cv.notify_all();
+	flusher.join();
+
+	std::lock_guard<std::mutex> lock(mtx);
+	flush_locked();
+}
+
+void event_traceT::record(const event_typeT type, const size_t id, const size_t machine, const size_t peer) {
+	const uint64_t time =
+		static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clockT::now() - origin).count());
+	const uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+	cellT &cell = ring[index & mask];
+
+	// seqlock: the flusher discards the event if seq changed while it was read
+	cell.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	cell.time.store(time, std::memory_order_relaxed);
+	cell.id.store(id == std::numeric_limits<size_t>::max() ? NO_JOB : id, std::memory_order_relaxed);
+	cell.machine.store(static_cast<uint32_t>(machine), std::memory_order_relaxed);
+	cell.peer.store(static_cast<uint32_t>(peer), std::memory_order_relaxed);
+	cell.type.store(static_cast<uint32_t>(type), std::memory_order_relaxed);
+	cell.seq.store(index + 1, std::memory_order_release);
+}
+
+uint64_t event_traceT::dropped() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return dropped_events;
+}
+
+void event_traceT::flush_locked() {
+	const uint64_t end = head.load(std::memory_order_acquire);
+	const uint64_t capacity = mask + 1;
+	if (end - tail > capacity) {
+		dropped_events += end - capacity - tail;
+		tail = end - capacity;
+	}
+
+	buffer.clear();
+	while (tail < end) {
+		cellT &cell = ring[tail & mask];
+		const uint64_t seq = cell.seq.load(std::memory_order_acquire);
+		// still written, the event is read with the next flush
+		if (seq < tail + 1) break;
+
+		eventT event;
+		event.time = cell.time.load(std::memory_order_relaxed);
+		event.id = cell.id.load(std::memory_order_relaxed);
+		event.machine = cell.machine.load(std::memory_order_relaxed);
+		event.peer = cell.peer.load(std::memory_order_relaxed);
+		event.type = static_cast<event_typeT>(cell.type.load(std::memory_order_relaxed));
+		event.reserved = 0;
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// overwritten by a writer that wrapped around
+		if (seq != tail + 1 || cell.seq.load(std::memory_order_relaxed) != seq) {
+			++dropped_events;
+			++tail;
+			continue;
+		}
+		buffer.push_back(event);
+		++tail;
+	}
+
+	if (buffer.empty()) return;
+	std::fwrite(buffer.data(), sizeof(eventT), buffer.size(), file);
+	std::fflush(file);
+}
+
+std::vector<eventT> event_traceT::read(const std::string &path) {
+	std::vector<eventT> ret;
+	FILE *in = std::fopen(path.c_str(), "rb");
+	assert(in != nullptr);
+
+	char magic[sizeof(TRACE_MAGIC)];
+	const bool valid =
+		std::fread(magic, sizeof(magic), 1, in) == 1 && std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+	assert(valid);
+	(void)valid;
+
+	eventT event;
+	while (std::fread(&event, sizeof(event), 1, in) == 1) {
+		ret.push_back(event);
+	}
+	std::fclose(in);
+	return ret;
+}
+
+// one Chrome trace event, pid 0 holds a track per job, pid 1 a track per machine
+static void write_event(std::ostream &os, const std::string &name, const char phase, const eventT &event,
+						const bool per_machine, const std::string &args) {
+	os << ",\n{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\",\"ts\":" << event.time / 1000.0
+	   << ",\"pid\":" << (per_machine ? 1 : 0) << ",\"tid\":" << (per_machine ? event.machine : event.id);
+	if (phase == 'i') os << ",\"s\":\"t\"";
+	if (!args.empty()) os << ",\"args\":{" << args << "}";
+	os << "}";
+}
+
+void event_traceT::export_chrome(const std::vector<eventT> &events, std::ostream &os) {
+	// timestamps in us with ns resolution
+	const auto flags = os.flags();
+	const auto precision = os.precision();
+	os << std::fixed << std::setprecision(3);
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"jobs\"}},\n";
+	os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"machines\"}}";
+
+	// submissions are recorded with the id of the job queue, they are drawn on the track of the started job
+	std::map<uint64_t, uint64_t> started_as;
+	for (const auto &event : events) {
+		if (event.type == event_typeT::job_started && event.peer != none) started_as[event.peer] = event.id;
+	}
+	bool not_started = false;
+
+	for (const auto &event : events) {
+		const std::string job = "job-#" + std::to_string(event.id);
+		switch (event.type) {
+		case event_typeT::job_submitted: {
+			eventT submitted = event;
+			const auto started = started_as.find(event.id);
+			if (started != started_as.end()) {
+				submitted.id = started->second;
+			} else {
+				submitted.id = none;
+				if (!not_started) {
+					os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << none
+					   << ",\"args\":{\"name\":\"not started\"}}";
+					not_started = true;
+				}
+			}
+			write_event(os, "submitted", 'i', submitted, false, "\"queue-id\":" + std::to_string(event.id));
+			break;
+		}
+		case event_typeT::job_started:
+			write_event(os, job, 'B', event, false, "");
+			break;
+		case event_typeT::job_finished:
+			write_event(os, job, 'E', event, false, "");
+			break;
+		case event_typeT::job_frozen:
+			write_event(os, "frozen", 'B', event, false, "");
+			break;
+		case event_typeT::job_thawed:
+			write_event(os, "frozen", 'E', event, false, "");
+			break;
+		case event_typeT::migration_started:
+			write_event(os, "migration", 'B', event, false,
+						"\"from\":" + std::to_string(event.machine) + ",\"to\":" + std::to_string(event.peer));
+			break;
+		case event_typeT::migration_finished:
+			write_event(os, "migration", 'E', event, false, "");
+			break;
+		case event_typeT::measurement_started:
+			write_event(os, "measurement", 'B', event, false, "");
+			break;
+		case event_typeT::measurement_finished:
+			write_event(os, "measurement", 'E', event, false, "");
+			break;
+		case event_typeT::resize_started:
+			write_event(os, "resize", 'B', event, true, "");
+			break;
+		case event_typeT::resize_finished:
+			write_event(os, "resize", 'E', event, true, "");
+			break;
+		}
+	}
+	os << "\n]}\n";
+
+	os.flags(flags);
+	os.precision(precision);
+}
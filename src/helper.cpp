@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 
+#include <unistd.h>
+
 // trim from start
 static inline std::string &ltrim(std::string &s) {
 	s.erase(s.begin(), std::find_if(s.begin(), s.end(), std::not1(std::ptr_fun<int, int>(std::isspace))));
@@ -43,3 +45,38 @@ std::string read_file_to_string(const std::string &filename) {
 
 	return string_stream.str();
 }
+
+std::string expand_host_path(const std::string &path, const std::string &host) {
+	std::string expanded = path;
+
+	const auto pos = expanded.find("%h");
+	if (pos != std::string::npos) expanded.replace(pos, 2, host);
+
+	return expanded;
+}
+
+bool is_local_host(const std::string &host) {
+	if (host == "localhost" || host == "127.0.0.1") return true;
+
+	char name[256] = {};
+	if (gethostname(name, sizeof(name) - 1) != 0) return false;
+	// the machine file may use the short name of the host
+	const std::string local(name);
+	return host == local || host == local.substr(0, local.find('.'));
+}
+
+std::string check_host_path(const std::string &path, const std::vector<std::string> &machines,
+							const std::string &marker, const bool elastic) {
+	if (path.find("%h") == std::string::npos) {
+		if (elastic || machines.size() > 1) return path + " must contain %h to tell the hosts apart";
+		if (machines.size() == 1 && !is_local_host(machines[0])) {
+			return path + " must contain %h, " + machines[0] + " is not the local host";
+		}
+	}
+
+	for (const auto &host : machines) {
+		const std::string expanded = expand_host_path(path, host) + "/" + marker;
+		if (access(expanded.c_str(), F_OK) != 0) return expanded + " does not exist";
+	}
+	return "";
+}
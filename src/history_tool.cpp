@@ -0,0 +1,99 @@
+/**
+ * Bandwidth history export
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Exports the membw history written with --history as CSV, either the samples or the aggregates per interval,
+ * or summarizes the utilization per application class and host. Usage:
+ *
+ *   poncos_history <history>
+ *   poncos_history --aggregates <history>
+ *   poncos_history --summary <history>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "poncos/membw_history.hpp"
+
+[[noreturn]] static void print_help(const char *argv) {
+	std::cerr << "usage: " << argv << " <history>\n";
+	std::cerr << "       " << argv << " --aggregates <history>\n";
+	std::cerr << "       " << argv << " --summary <history>\n";
+	exit(1);
+}
+
+struct utilization_summaryT {
+	std::vector<double> utilization;
+	std::set<uint64_t> jobs;
+};
+
+static void print_summary(const std::string &title, std::map<std::string, utilization_summaryT> &groups) {
+	std::cout << std::left << std::setw(24) << title << std::setw(10) << "samples" << std::setw(8) << "jobs"
+			  << std::setw(10) << "mean" << std::setw(10) << "p95"
+			  << "max\n";
+	for (auto &group : groups) {
+		auto &utilization = group.second.utilization;
+		std::sort(utilization.begin(), utilization.end());
+
+		double sum = 0;
+		for (const auto u : utilization) sum += u;
+		const auto rank = static_cast<size_t>(std::ceil(0.95 * static_cast<double>(utilization.size())));
+
+		std::cout << std::setw(24) << group.first << std::setw(10) << utilization.size() << std::setw(8)
+				  << group.second.jobs.size() << std::setw(10) << sum / utilization.size() << std::setw(10)
+				  << utilization[rank == 0 ? 0 : rank - 1] << utilization.back() << "\n";
+	}
+}
+
+static void summarize(const std::vector<membw_sampleT> &samples) {
+	std::map<std::string, utilization_summaryT> applications;
+	std::map<std::string, utilization_summaryT> hosts;
+	for (const auto &sample : samples) {
+		const std::string application(sample.application, strnlen(sample.application, sizeof(sample.application)));
+		const std::string host(sample.host, strnlen(sample.host, sizeof(sample.host)));
+		applications[application].utilization.push_back(sample.utilization);
+		applications[application].jobs.insert(sample.job);
+		hosts[host].utilization.push_back(sample.utilization);
+		hosts[host].jobs.insert(sample.job);
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	print_summary("application", applications);
+	std::cout << "\n";
+	print_summary("host", hosts);
+}
+
+int main(int argc, char const *argv[]) {
+	if (argc < 2 || argc > 3) print_help(argv[0]);
+
+	std::vector<membw_sampleT> samples;
+	std::vector<membw_aggregateT> aggregates;
+	const std::string arg(argv[1]);
+	if (argc == 2) {
+		membw_historyT::read(arg, samples, aggregates);
+		membw_historyT::export_samples(samples, std::cout);
+		return 0;
+	}
+
+	membw_historyT::read(argv[2], samples, aggregates);
+	if (arg == "--aggregates") {
+		membw_historyT::export_aggregates(aggregates, std::cout);
+	} else if (arg == "--summary") {
+		summarize(samples);
+	} else {
+		print_help(argv[0]);
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+#include "poncos/interference_model.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(interference_model_log, "interference-model")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(interference_model_log, info);
+
+YAML::Node interference_entryT::emit() const {
+	YAML::Node node;
+	node["application"] = application;
+	if (!partner.empty()) node["partner"] = partner;
+	node["runs"] = runs;
+	node["runtime"] = runtime;
+	return node;
+}
+
+void interference_entryT::load(const YAML::Node &node) {
+	fast::load(application, node["application"]);
+	fast::load(partner, node["partner"], std::string());
+	fast::load(runs, node["runs"]);
+	fast::load(runtime, node["runtime"]);
+}
+
+interference_modelT::interference_modelT(const std::string &filename) {
+	std::ifstream file(filename);
+	if (!file.good()) return;
+
+	FASTLIB_LOG(interference_model_log, info) << "Reading interference model " << filename << " ...";
+	fast::Serializable::from_string(read_file_to_string(filename));
+}
+
+std::string interference_modelT::class_of(const jobT &job) {
+	std::stringstream command(job.command);
+	std::string token;
+	while (command >> token) {
+		// skip environment variables set in front of the executable
+		if (token.find('=') != std::string::npos) continue;
+
+		return token.substr(token.find_last_of('/') + 1);
+	}
+	return job.command;
+}
+
+void interference_modelT::record(const std::string &application, const std::string &partner, double runtime) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	interference_entryT &entry = entries[{application, partner}];
+	entry.application = application;
+	entry.partner = partner;
+	++entry.runs;
+	entry.runtime += (runtime - entry.runtime) / entry.runs;
+
+	FASTLIB_LOG(interference_model_log, debug) << application << " with " << (partner.empty() ? "-" : partner)
+											   << ": " << entry.runtime << " s (" << entry.runs << " runs)";
+}
+
+double interference_modelT::slowdown(const std::string &application, const std::string &partner) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const auto alone = entries.find({application, ""});
+	const auto shared = entries.find({application, partner});
+	if (alone == entries.end() || shared == entries.end()) return 0;
+
+	return shared->second.runtime / alone->second.runtime;
+}
+
+void interference_modelT::save(const std::string &filename) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	std::ofstream file(filename);
+	assert(file.good());
+	file << to_string();
+}
+
+YAML::Node interference_modelT::emit_classes(const std::set<std::string> &classes) const {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	std::vector<interference_entryT> list;
+	for (const auto &entry : entries) {
+		if (classes.count(entry.first.first) == 0) continue;
+		if (!entry.first.second.empty() && classes.count(entry.first.second) == 0) continue;
+		list.push_back(entry.second);
+	}
+
+	YAML::Node node;
+	node["interference-list"] = list;
+	return node;
+}
+
+YAML::Node interference_modelT::emit() const {
+	std::vector<interference_entryT> list;
+	for (const auto &entry : entries) {
+		list.push_back(entry.second);
+	}
+
+	YAML::Node node;
+	node["interference-list"] = list;
+	return node;
+}
+
+void interference_modelT::load(const YAML::Node &node) {
+	std::vector<interference_entryT> list;
+	fast::load(list, node["interference-list"]);
+
+	for (const auto &entry : list) {
+		entries[{entry.application, entry.partner}] = entry;
+	}
+}
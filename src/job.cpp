@@ -1,6 +1,7 @@
 #include "poncos/job.hpp"
 #include "poncos/poncos.hpp"
 
+#include <cassert>
 #include <fstream>
 
 jobT::jobT(size_t nprocs, size_t threads_per_proc, std::string command, bool uses_sr_protocol)
@@ -13,6 +14,7 @@ YAML::Node jobT::emit() const {
 	node["threads-per-proc"] = threads_per_proc;
 	node["cmd"] = command;
 	node["uses-sr-protocol"] = uses_sr_protocol;
+	if (memory > 0) node["memory"] = memory;
 	return node;
 }
 
@@ -21,28 +23,288 @@ void jobT::load(const YAML::Node &node) {
 	fast::load(threads_per_proc, node["threads-per-proc"]);
 	fast::load(command, node["cmd"]);
 	fast::load(uses_sr_protocol, node["uses-sr-protocol"]);
+	fast::load(memory, node["memory"], 0);
 }
 
-job_queueT::job_queueT(std::vector<jobT> jobs) : jobs(std::move(jobs)) {}
+job_queueT::job_queueT(std::vector<jobT> jobs)
+	: pending(jobs.begin(), jobs.end()), statuses(pending.size(), job_statusT::pending) {}
 
 job_queueT::job_queueT(const std::string &queue_filename) {
 	fast::Serializable::from_string(read_file_to_string(queue_filename));
 }
 
+job_queueT::~job_queueT() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		feeding = false;
+	}
+	cv.notify_all();
+	if (feeder.joinable()) feeder.join();
+}
+
 YAML::Node job_queueT::emit() const {
 	YAML::Node node;
-	node["job-list"] = jobs;
+	// the jobs started before are not needed to resume the queue
+	node["first-id"] = next_job;
+	node["job-list"] = YAML::Node(YAML::NodeType::Sequence);
+	for (const auto &job : pending) {
+		node["job-list"].push_back(job);
+	}
+	if (fed_jobs > 0) node["fed"] = fed_jobs;
 
 	return node;
 }
 
-void job_queueT::load(const YAML::Node &node) { fast::load(jobs, node["job-list"]); }
+void job_queueT::load(const YAML::Node &node) {
+	std::vector<jobT> jobs;
+	fast::load(jobs, node["job-list"]);
+	fast::load(next_job, node["first-id"], 0);
+	fast::load(fed_jobs, node["fed"], 0);
+
+	pending.assign(jobs.begin(), jobs.end());
+	statuses.assign(pending.size(), job_statusT::pending);
+	status_base = next_job;
+}
+
+bool job_queueT::submit(const jobT &job, size_t &id) { return submit_job(job, id, false); }
+
+bool job_queueT::submit_job(const jobT &job, size_t &id, const bool from_source) {
+	bool accepted = false;
+	const auto change = [&] {
+		std::lock_guard<std::mutex> lock(mtx);
+		YAML::Node record;
+		if (is_closed) return record;
+
+		id = next_job + pending.size();
+		pending.push_back(job);
+		statuses.push_back(job_statusT::pending);
+		if (from_source) ++fed_jobs;
+		accepted = true;
+		if (metrics != nullptr) metrics->set(gaugeT::queue_pending, static_cast<double>(pending.size()));
+
+		record["source"] = "queue";
+		record["type"] = "submit";
+		record["id"] = id;
+		record["job"] = job;
+		if (from_source) record["fed"] = fed_jobs;
+		return record;
+	};
+
+	// the submission must not get lost between a snapshot and its record
+	if (journal != nullptr) {
+		journal->apply(change);
+	} else {
+		change();
+	}
+
+	if (!accepted) return false;
+	if (trace != nullptr) trace->record(event_typeT::job_submitted, id);
+	if (metrics != nullptr) metrics->add(counterT::jobs_submitted);
+	cv.notify_all();
+	return true;
+}
+
+void job_queueT::feed(std::unique_ptr<job_sourceT> source, const bool close, const double speedup,
+					  const size_t window, const size_t skip) {
+	assert(speedup > 0);
+	assert(window > 0);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	assert(!feeder.joinable());
+	feeding = true;
+	feeder = std::thread(&job_queueT::feed_internal, this, std::move(source), close, speedup, window, skip);
+}
+
+void job_queueT::feed_internal(std::unique_ptr<job_sourceT> source, const bool close, const double speedup,
+							   const size_t window, const size_t skip) {
+	jobT job;
+	std::chrono::milliseconds submit(0);
+
+	// the trace continues at the submit time of the last job submitted before the restart
+	std::chrono::milliseconds offset(0);
+	for (size_t i = 0; i < skip && source->next(job, submit); ++i) {
+		offset = submit;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	while (source->next(job, submit)) {
+		const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+									 std::chrono::duration<double, std::milli>(submit - offset) / speedup);
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			const auto stopped = [this] { return !feeding || is_closed; };
+			cv.wait_until(lock, due, stopped);
+			cv.wait(lock, [&] { return stopped() || pending.size() < window; });
+			if (stopped()) return;
+		}
+
+		size_t id;
+		if (!submit_job(job, id, true)) return;
+	}
+
+	if (close) this->close();
+}
+
+size_t job_queueT::fed() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return fed_jobs;
+}
+
+void job_queueT::close() {
+	std::lock_guard<std::mutex> lock(mtx);
+	is_closed = true;
+	cv.notify_all();
+}
+
+bool job_queueT::closed() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return is_closed;
+}
+
+bool job_queueT::ready() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return !pending.empty();
+}
+
+size_t job_queueT::size() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return next_job + pending.size();
+}
+
+bool job_queueT::next(size_t &id, jobT &job) {
+	std::unique_lock<std::mutex> lock(mtx);
+	cv.wait(lock, [this] { return !pending.empty() || is_closed; });
+	if (pending.empty()) return false;
+
+	id = next_job++;
+	job = std::move(pending.front());
+	pending.pop_front();
+	statuses[id - status_base] = job_statusT::running;
+	if (metrics != nullptr) metrics->set(gaugeT::queue_pending, static_cast<double>(pending.size()));
+
+	// the feeder waits for room in the queue
+	cv.notify_all();
+	return true;
+}
+
+void job_queueT::finished(const size_t id) {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (id < status_base) return;
+	assert(id - status_base < statuses.size());
+	statuses[id - status_base] = job_statusT::done;
+
+	while (!statuses.empty() && statuses.front() == job_statusT::done) {
+		statuses.pop_front();
+		++status_base;
+	}
+}
+
+void job_queueT::requeue(const size_t id, const jobT &job) {
+	std::lock_guard<std::mutex> lock(mtx);
+	assert(id + 1 == next_job);
+	assert(id >= status_base);
+
+	--next_job;
+	pending.push_front(job);
+	statuses[id - status_base] = job_statusT::pending;
+	if (metrics != nullptr) metrics->set(gaugeT::queue_pending, static_cast<double>(pending.size()));
+	cv.notify_all();
+}
+
+bool job_queueT::status(const size_t id, job_statusT &ret) {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (id >= next_job + pending.size()) return false;
+	ret = id < status_base ? job_statusT::done : statuses[id - status_base];
+	return true;
+}
+
+size_t job_queueT::unfinished(std::vector<size_t> &pending_ids, std::vector<size_t> &running_ids) {
+	std::lock_guard<std::mutex> lock(mtx);
+	pending_ids.clear();
+	running_ids.clear();
+	for (size_t i = 0; i < statuses.size(); ++i) {
+		if (statuses[i] == job_statusT::pending) pending_ids.push_back(status_base + i);
+		if (statuses[i] == job_statusT::running) running_ids.push_back(status_base + i);
+	}
+	return next_job + pending.size();
+}
+
+void job_queueT::use_trace(std::shared_ptr<event_traceT> _trace) { trace = std::move(_trace); }
+
+void job_queueT::use_metrics(std::shared_ptr<metricsT> _metrics) {
+	std::lock_guard<std::mutex> lock(mtx);
+	metrics = std::move(_metrics);
+	metrics->set(gaugeT::queue_pending, static_cast<double>(pending.size()));
+}
+
+void job_queueT::use_journal(std::shared_ptr<journalT> _journal) {
+	journal = std::move(_journal);
+	journal->add_source("queue", [this] {
+		std::lock_guard<std::mutex> lock(mtx);
+		return emit();
+	});
+}
+
+void job_queueT::recover(const size_t started, const std::function<bool(size_t)> &running) {
+	assert(journal != nullptr);
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const YAML::Node &snapshot = journal->snapshot();
+	if (snapshot["queue"]) load(snapshot["queue"]);
+	for (const auto &record : journal->records()) {
+		if (record["source"].as<std::string>() != "queue") continue;
+
+		// records are appended in the order of the ids
+		const size_t record_id = record["id"].as<size_t>();
+		if (record_id < next_job + pending.size()) continue;
+		assert(record_id == next_job + pending.size());
+		pending.push_back(record["job"].as<jobT>());
+		if (record["fed"]) fed_jobs = record["fed"].as<size_t>();
+	}
+	const size_t submitted = next_job + pending.size();
+	assert(next_job <= started && started <= submitted);
+
+	// jobs started after the snapshot was taken
+	while (next_job < started) {
+		pending.pop_front();
+		++next_job;
+	}
+
+	// the statuses start at the first job that did not complete
+	statuses.clear();
+	status_base = 0;
+	for (size_t i = 0; i < started; ++i) {
+		const bool run = running(i);
+		if (statuses.empty() && !run) {
+			status_base = i + 1;
+			continue;
+		}
+		statuses.push_back(run ? job_statusT::running : job_statusT::done);
+	}
+	statuses.resize(submitted - status_base, job_statusT::pending);
+}
+
+std::ostream &operator<<(std::ostream &os, const job_statusT &status) {
+	switch (status) {
+	case job_statusT::pending:
+		os << "pending";
+		break;
+	case job_statusT::running:
+		os << "running";
+		break;
+	case job_statusT::done:
+		os << "done";
+		break;
+	}
+	return os;
+}
 
 std::ostream &operator<<(std::ostream &os, const jobT &job) {
 	os << "nprocs: " << job.nprocs << "; ";
 	os << "threads-per-proc: " << job.threads_per_proc << "; ";
 	os << "cmd: " << job.command << "; ";
 	os << "uses-sr-protocol: " << job.uses_sr_protocol;
+	if (job.memory > 0) os << "; memory: " << job.memory << " MiB";
 
 	return os;
 }
@@ -0,0 +1,160 @@
+#include "poncos/job_source.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <vector>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(job_source_log, "job source")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(job_source_log, info);
+
+// fields of a SWF line, see http://www.cs.huji.ac.il/labs/parallel/workload/swf.html
+constexpr size_t SWF_FIELDS = 18;
+constexpr size_t SWF_JOB_NUMBER = 0;
+constexpr size_t SWF_SUBMIT_TIME = 1;
+constexpr size_t SWF_RUN_TIME = 3;
+constexpr size_t SWF_ALLOCATED_PROCS = 4;
+constexpr size_t SWF_REQUESTED_PROCS = 7;
+
+static size_t indentation(const std::string &line) {
+	const auto pos = line.find_first_not_of(' ');
+	return pos == std::string::npos ? line.size() : pos;
+}
+
+// lines without content do not end an entry
+static bool blank(const std::string &line) {
+	const auto pos = line.find_first_not_of(" \t");
+	return pos == std::string::npos || line[pos] == '#';
+}
+
+static bool entry_start(const std::string &line, const size_t indent) {
+	return line.size() > indent && line[indent] == '-' && (line.size() == indent + 1 || line[indent + 1] == ' ');
+}
+
+static void replace_all(std::string &str, const std::string &from, const std::string &to) {
+	for (auto pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos + to.size())) {
+		str.replace(pos, from.size(), to);
+	}
+}
+
+yaml_job_sourceT::yaml_job_sourceT(const std::string &filename)
+	: file(filename), indent(0), done(false), loaded_next(0) {
+	assert(file.good());
+
+	// skip everything before the job-list
+	std::string line;
+	bool found = false;
+	while (std::getline(file, line)) {
+		if (line.compare(0, 9, "job-list:") == 0) {
+			found = blank(line.substr(9));
+			break;
+		}
+	}
+
+	while (found && std::getline(file, line)) {
+		if (blank(line)) continue;
+		indent = indentation(line);
+		lookahead = line;
+		if (entry_start(lookahead, indent)) return;
+		break;
+	}
+
+	// e.g. a job-list in flow style or an empty file, yaml-cpp reports malformed files
+	if (found && file.eof()) {
+		done = true;
+		return;
+	}
+	FASTLIB_LOG(job_source_log, info) << "Cannot stream the job-list of " << filename << ", loading the whole file";
+	loaded = YAML::LoadFile(filename)["job-list"];
+	if (!loaded.IsSequence()) loaded = YAML::Node(YAML::NodeType::Sequence);
+	done = true;
+}
+
+bool yaml_job_sourceT::next(jobT &job, std::chrono::milliseconds &submit) {
+	if (loaded_next < loaded.size()) {
+		const YAML::Node node = loaded[loaded_next++];
+		job = node.as<jobT>();
+		double seconds;
+		fast::load(seconds, node["submit"], 0.0);
+		submit = std::chrono::milliseconds(static_cast<long>(seconds * 1000));
+		return true;
+	}
+	if (done || !entry_start(lookahead, indent)) return false;
+
+	// the "- " is replaced by spaces, i.e. the entry becomes a map of its own
+	std::string entry = lookahead.substr(indent);
+	entry[0] = ' ';
+	entry += '\n';
+
+	std::string line;
+	done = true;
+	while (std::getline(file, line)) {
+		if (!blank(line) && indentation(line) <= indent) {
+			lookahead = line;
+			done = false;
+			break;
+		}
+		entry += line.size() > indent ? line.substr(indent) : std::string();
+		entry += '\n';
+	}
+
+	const YAML::Node node = YAML::Load(entry);
+	job = node.as<jobT>();
+	double seconds;
+	fast::load(seconds, node["submit"], 0.0);
+	submit = std::chrono::milliseconds(static_cast<long>(seconds * 1000));
+	return true;
+}
+
+swf_job_sourceT::swf_job_sourceT(const std::string &filename, std::string command, size_t max_procs)
+	: file(filename), command(std::move(command)), max_procs(max_procs) {
+	assert(file.good());
+}
+
+bool swf_job_sourceT::next(jobT &job, std::chrono::milliseconds &submit) {
+	std::string line;
+	while (std::getline(file, line)) {
+		// header comments
+		if (blank(line) || line[line.find_first_not_of(" \t")] == ';') continue;
+
+		std::stringstream line_stream(line);
+		std::vector<double> fields;
+		double field;
+		while (line_stream >> field) {
+			fields.push_back(field);
+		}
+		if (fields.size() < SWF_FIELDS) {
+			FASTLIB_LOG(job_source_log, warn) << "Skipping malformed SWF line: " << line;
+			continue;
+		}
+
+		// -1 marks missing values, the allocated processors are used if none were requested
+		double procs = fields[SWF_REQUESTED_PROCS];
+		if (procs <= 0) procs = fields[SWF_ALLOCATED_PROCS];
+		const double runtime = fields[SWF_RUN_TIME];
+		if (procs <= 0 || runtime <= 0) {
+			FASTLIB_LOG(job_source_log, warn) << "Skipping SWF job " << static_cast<long>(fields[SWF_JOB_NUMBER])
+											  << " without processors or runtime";
+			continue;
+		}
+		if (procs > static_cast<double>(max_procs)) {
+			FASTLIB_LOG(job_source_log, warn) << "Skipping SWF job " << static_cast<long>(fields[SWF_JOB_NUMBER])
+											  << ": " << procs << " processors requested, at most " << max_procs
+											  << " available";
+			continue;
+		}
+
+		std::string cmd = command;
+		replace_all(cmd, "%r", std::to_string(static_cast<long>(runtime)));
+		replace_all(cmd, "%n", std::to_string(static_cast<long>(fields[SWF_JOB_NUMBER])));
+		replace_all(cmd, "%p", std::to_string(static_cast<long>(procs)));
+
+		job = jobT(static_cast<size_t>(procs), 1, cmd, false);
+		submit = std::chrono::milliseconds(static_cast<long>(std::max(0.0, fields[SWF_SUBMIT_TIME]) * 1000));
+		return true;
+	}
+	return false;
+}
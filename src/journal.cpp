@@ -0,0 +1,255 @@
+#include "poncos/journal.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(journal_log, "journal")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(journal_log, info);
+
+// file layout: magic, generation, records (length, checksum, YAML payload), a record of length 0 marks the end
+static constexpr char JOURNAL_MAGIC[8] = {'P', 'O', 'N', 'C', 'O', 'S', 'J', '1'};
+static constexpr size_t JOURNAL_HEADER_SIZE = sizeof(JOURNAL_MAGIC) + sizeof(uint64_t);
+static constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+// the file is grown in chunks, the mapping is only replaced if a chunk is full
+static constexpr size_t JOURNAL_CHUNK_SIZE = 1 << 20;
+
+// FNV-1a
+static uint32_t checksum(const char *data, const size_t size) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// makes a rename within directory durable
+static void sync_directory(const std::string &path) {
+	const auto pos = path.find_last_of('/');
+	const std::string dir = pos == std::string::npos ? "." : path.substr(0, pos + 1);
+
+	const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd == -1) return;
+	::fsync(fd);
+	::close(fd);
+}
+
+journalT::journalT(std::string path, std::chrono::milliseconds sync_interval)
+	: path(std::move(path)), sync_interval(sync_interval), fd(-1), map(nullptr), map_size(0),
+	  tail(JOURNAL_HEADER_SIZE), generation(0), record_count(0), dirty(false), running(true) {
+	assert(sync_interval.count() > 0);
+
+	open();
+	read();
+
+	syncer = std::thread([this] {
+		std::unique_lock<std::mutex> lock(mtx);
+		while (running) {
+			cv.wait_for(lock, this->sync_interval);
+			sync_locked();
+		}
+	});
+}
+
+journalT::~journalT() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		running = false;
+	}
+	cv.notify_all();
+	syncer.join();
+
+	sync_locked();
+	::munmap(map, map_size);
+	::close(fd);
+}
+
+bool journalT::recovered() const { return !loaded_snapshot.IsNull() || !loaded_records.empty(); }
+
+void journalT::add_source(const std::string &name, std::function<YAML::Node()> emit) {
+	std::lock_guard<std::mutex> lock(mtx);
+	sources.emplace_back(name, std::move(emit));
+}
+
+void journalT::append(const YAML::Node &record) {
+	std::lock_guard<std::mutex> lock(mtx);
+	append_locked(record);
+}
+
+void journalT::apply(const std::function<YAML::Node()> &change) {
+	std::lock_guard<std::mutex> lock(mtx);
+	const YAML::Node record = change();
+	if (!record.IsNull()) append_locked(record);
+}
+
+void journalT::sync() {
+	std::lock_guard<std::mutex> lock(mtx);
+	sync_locked();
+}
+
+size_t journalT::size() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return record_count;
+}
+
+void journalT::compact() {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	YAML::Node node;
+	node["generation"] = generation + 1;
+	for (const auto &source : sources) {
+		node["state"][source.first] = source.second();
+	}
+
+	// the old snapshot stays valid until the new one is completely written
+	const std::string snapshot_path = path + ".snapshot";
+	const std::string tmp_path = snapshot_path + ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::trunc);
+		file << YAML::Dump(node);
+		assert(file.good());
+	}
+	const int tmp_fd = ::open(tmp_path.c_str(), O_RDONLY);
+	assert(tmp_fd != -1);
+	::fsync(tmp_fd);
+	::close(tmp_fd);
+
+	const auto temp = std::rename(tmp_path.c_str(), snapshot_path.c_str());
+	assert(temp == 0);
+	sync_directory(snapshot_path);
+
+	// a crash before the reset is detected by the generation, the old records are then ignored
+	reset(generation + 1);
+	FASTLIB_LOG(journal_log, debug) << "Compacted journal " << path << " (generation " << generation << ")";
+}
+
+void journalT::clear() {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	// without snapshot, the generation of the journal does not match anymore
+	std::remove((path + ".snapshot").c_str());
+	sync_directory(path);
+	reset(generation + 1);
+}
+
+void journalT::open() {
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	assert(fd != -1);
+
+	struct stat st;
+	const auto temp = ::fstat(fd, &st);
+	assert(temp == 0);
+
+	map = nullptr;
+	grow(std::max(static_cast<size_t>(st.st_size), JOURNAL_CHUNK_SIZE));
+}
+
+void journalT::read() {
+	uint64_t snapshot_generation = 0;
+	std::ifstream snapshot_file(path + ".snapshot");
+	if (snapshot_file.good()) {
+		const YAML::Node node = YAML::Load(snapshot_file);
+		fast::load(snapshot_generation, node["generation"]);
+		loaded_snapshot = node["state"];
+	}
+
+	uint64_t journal_generation;
+	std::memcpy(&journal_generation, map + sizeof(JOURNAL_MAGIC), sizeof(journal_generation));
+	if (std::memcmp(map, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || journal_generation != snapshot_generation) {
+		// new journal or its records are already part of the snapshot
+		reset(snapshot_generation);
+		return;
+	}
+	generation = journal_generation;
+
+	tail = JOURNAL_HEADER_SIZE;
+	while (tail + RECORD_HEADER_SIZE <= map_size) {
+		uint32_t length;
+		uint32_t sum;
+		std::memcpy(&length, map + tail, sizeof(length));
+		std::memcpy(&sum, map + tail + sizeof(length), sizeof(sum));
+		if (length == 0) break;
+
+		if (tail + RECORD_HEADER_SIZE + length > map_size || checksum(map + tail + RECORD_HEADER_SIZE, length) != sum) {
+			FASTLIB_LOG(journal_log, warn) << "Dropping torn record at offset " << tail << " of " << path;
+			break;
+		}
+
+		loaded_records.push_back(YAML::Load(std::string(map + tail + RECORD_HEADER_SIZE, length)));
+		tail += RECORD_HEADER_SIZE + length;
+	}
+	record_count = loaded_records.size();
+
+	// a torn record is overwritten by the next append
+	grow(tail + sizeof(uint32_t));
+	std::memset(map + tail, 0, sizeof(uint32_t));
+
+	FASTLIB_LOG(journal_log, info) << "Read " << loaded_records.size() << " records from " << path << " (generation "
+								   << generation << ")";
+}
+
+void journalT::reset(const uint64_t new_generation) {
+	generation = new_generation;
+	std::memcpy(map, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+	std::memcpy(map + sizeof(JOURNAL_MAGIC), &generation, sizeof(generation));
+	std::memset(map + JOURNAL_HEADER_SIZE, 0, sizeof(uint32_t));
+
+	tail = JOURNAL_HEADER_SIZE;
+	record_count = 0;
+	dirty = true;
+	sync_locked();
+}
+
+void journalT::grow(const size_t required) {
+	if (map != nullptr && required <= map_size) return;
+
+	size_t new_size = (required + JOURNAL_CHUNK_SIZE - 1) / JOURNAL_CHUNK_SIZE * JOURNAL_CHUNK_SIZE;
+	if (map != nullptr) {
+		::msync(map, map_size, MS_SYNC);
+		::munmap(map, map_size);
+		new_size = std::max(new_size, 2 * map_size);
+	}
+
+	auto temp = ::ftruncate(fd, static_cast<off_t>(new_size));
+	assert(temp == 0);
+	map = static_cast<char *>(::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+	assert(map != MAP_FAILED);
+	map_size = new_size;
+}
+
+void journalT::append_locked(const YAML::Node &record) {
+	const std::string payload = YAML::Dump(record);
+	grow(tail + RECORD_HEADER_SIZE + payload.size() + sizeof(uint32_t));
+
+	// the length is written last, a partially written record is either invisible or fails the checksum
+	const auto length = static_cast<uint32_t>(payload.size());
+	const uint32_t sum = checksum(payload.data(), payload.size());
+	const uint32_t end = 0;
+	std::memcpy(map + tail + RECORD_HEADER_SIZE, payload.data(), payload.size());
+	std::memcpy(map + tail + RECORD_HEADER_SIZE + payload.size(), &end, sizeof(end));
+	std::memcpy(map + tail + sizeof(length), &sum, sizeof(sum));
+	std::memcpy(map + tail, &length, sizeof(length));
+
+	tail += RECORD_HEADER_SIZE + payload.size();
+	++record_count;
+	dirty = true;
+}
+
+void journalT::sync_locked() {
+	if (!dirty) return;
+
+	const auto temp = ::msync(map, std::min(tail + sizeof(uint32_t), map_size), MS_SYNC);
+	assert(temp == 0);
+	dirty = false;
+}
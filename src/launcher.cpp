@@ -0,0 +1,173 @@
+/**
+ * Slot launcher
+ *
+ * Copyright 2017 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Started by mpiexec for every rank instead of cgroup_wrapper.sh. It adds itself to the cgroups (and
+ * resctrl group) of the domain, binds itself to the CPUs and memory nodes of the slot and finally
+ * replaces itself with the application. Usage:
+ *
+ *   poncos_launch <domain> [--cpus 0,1,...] [--mems 0,...] [--procs N] [--cgroup-dir DIR]... [--resctrl-root DIR]
+ *                 -- <command> [args]
+ *
+ * --procs N splits the CPUs evenly between the N processes of the slot based on the local MPI rank.
+ * --cgroup-dir may be passed multiple times (e.g. cpuset and freezer hierarchy), the default is
+ * /sys/fs/cgroup/<domain>.
+ * --resctrl-root is the resctrl tree poncos created the groups in (%h is replaced by the host name), the resctrl
+ * group <domain> is joined if it exists there or below /sys/fs/resctrl, e.g. if poncos accesses the tree of the node
+ * via a mount. No resctrl group is joined without it.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// see linux/mempolicy.h
+constexpr int MPOL_BIND = 2;
+
+[[noreturn]] static void print_help(const char *argv) {
+	std::cerr << "usage: " << argv
+			  << " <domain> [--cpus LIST] [--mems LIST] [--procs N] [--cgroup-dir DIR]... [--resctrl-root DIR] -- "
+				 "<command> [args]\n";
+	exit(EXIT_FAILURE);
+}
+
+[[noreturn]] static void fail(const std::string &what) {
+	std::cerr << "poncos_launch: " << what << ": " << strerror(errno) << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+static std::vector<unsigned int> parse_list(const std::string &list) {
+	std::vector<unsigned int> ret;
+	std::stringstream stream(list);
+	std::string elem;
+	while (std::getline(stream, elem, ',')) {
+		ret.push_back(static_cast<unsigned int>(std::stoul(elem)));
+	}
+	return ret;
+}
+
+// local rank as set by the common MPI launchers, -1 if unknown
+static long local_rank() {
+	for (const char *var : {"MPI_LOCALRANKID", "OMPI_COMM_WORLD_LOCAL_RANK", "MV2_COMM_WORLD_LOCAL_RANK",
+							"SLURM_LOCALID", "PMI_LOCAL_RANK"}) {
+		const char *value = getenv(var);
+		if (value != nullptr) return std::strtol(value, nullptr, 10);
+	}
+	return -1;
+}
+
+static void join(const std::string &dir) {
+	std::ofstream tasks(dir + "/tasks");
+	if (!tasks.is_open()) fail("cannot open " + dir + "/tasks");
+	tasks << getpid() << std::endl;
+	if (tasks.fail()) fail("cannot write to " + dir + "/tasks");
+}
+
+static void bind_cpus(const std::vector<unsigned int> &cpus) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const auto cpu : cpus) {
+		CPU_SET(cpu, &set);
+	}
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) fail("sched_setaffinity");
+}
+
+static void bind_mems(const std::vector<unsigned int> &mems) {
+	constexpr size_t bits = sizeof(unsigned long) * 8;
+
+	std::vector<unsigned long> mask(1);
+	for (const auto mem : mems) {
+		if (mem / bits >= mask.size()) mask.resize(mem / bits + 1, 0);
+		mask[mem / bits] |= 1UL << (mem % bits);
+	}
+	// maxnode is the number of bits in the mask plus one (see set_mempolicy(2))
+	if (syscall(SYS_set_mempolicy, MPOL_BIND, mask.data(), mask.size() * bits + 1) != 0) fail("set_mempolicy");
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 4) print_help(argv[0]);
+
+	const std::string domain(argv[1]);
+	std::vector<unsigned int> cpus;
+	std::vector<unsigned int> mems;
+	std::vector<std::string> cgroup_dirs;
+	std::string resctrl_root;
+	long procs = 1;
+
+	int i = 2;
+	for (; i < argc; ++i) {
+		const std::string arg(argv[i]);
+
+		if (arg == "--") break;
+		if (i + 1 >= argc) print_help(argv[0]);
+
+		if (arg == "--cpus") {
+			cpus = parse_list(argv[++i]);
+		} else if (arg == "--mems") {
+			mems = parse_list(argv[++i]);
+		} else if (arg == "--procs") {
+			procs = std::strtol(argv[++i], nullptr, 10);
+		} else if (arg == "--cgroup-dir") {
+			cgroup_dirs.emplace_back(argv[++i]);
+		} else if (arg == "--resctrl-root") {
+			resctrl_root = argv[++i];
+		} else {
+			print_help(argv[0]);
+		}
+	}
+	// no command given?
+	if (i + 1 >= argc) print_help(argv[0]);
+
+	if (cgroup_dirs.empty()) cgroup_dirs.push_back("/sys/fs/cgroup/" + domain);
+	for (const auto &dir : cgroup_dirs) {
+		join(dir);
+	}
+
+	// join the resctrl group if poncos created one for this domain
+	if (!resctrl_root.empty()) {
+		const auto pos = resctrl_root.find("%h");
+		if (pos != std::string::npos) {
+			char host[256] = {};
+			if (gethostname(host, sizeof(host) - 1) != 0) fail("gethostname");
+			resctrl_root.replace(pos, 2, host);
+		}
+
+		for (const auto &root : {resctrl_root, std::string("/sys/fs/resctrl")}) {
+			struct stat info;
+			const std::string resctrl_dir = root + "/" + domain;
+			if (stat(resctrl_dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) continue;
+			join(resctrl_dir);
+			break;
+		}
+	}
+
+	// only use our share of the slot if the slot is split between multiple processes
+	const long rank = local_rank();
+	if (procs > 1 && rank >= 0 && cpus.size() % static_cast<size_t>(procs) == 0) {
+		const size_t share = cpus.size() / static_cast<size_t>(procs);
+		const size_t first = (static_cast<size_t>(rank) % static_cast<size_t>(procs)) * share;
+		cpus = std::vector<unsigned int>(cpus.begin() + static_cast<long>(first),
+										 cpus.begin() + static_cast<long>(first + share));
+	}
+
+	if (!cpus.empty()) bind_cpus(cpus);
+	if (!mems.empty()) bind_mems(mems);
+
+	execvp(argv[i + 1], argv + i + 1);
+	fail(std::string("cannot execute ") + argv[i + 1]);
+}
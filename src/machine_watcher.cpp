@@ -0,0 +1,61 @@
+#include "poncos/machine_watcher.hpp"
+
+#include <cassert>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(machine_watcher_log, "machine-watcher")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(machine_watcher_log, info);
+
+machine_watcherT::machine_watcherT(controllerT &controller, std::string filename, std::chrono::milliseconds interval)
+	: controller(controller), filename(std::move(filename)), interval(interval), last_change(0), running(false) {
+	assert(interval.count() > 0);
+}
+
+machine_watcherT::~machine_watcherT() { stop(); }
+
+void machine_watcherT::start() {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (running) return;
+	running = true;
+	// the hosts of the file were read by the controller already
+	last_change = modification_time();
+
+	watcher = std::thread([this] {
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if (!running) break;
+
+				const std::time_t change = modification_time();
+				if (change != 0 && change != last_change) {
+					last_change = change;
+					FASTLIB_LOG(machine_watcher_log, info) << filename << " changed, updating the machines";
+
+					std::vector<std::string> lines;
+					read_file(filename, lines);
+					controller.sync_machines(lines);
+				}
+			}
+			std::this_thread::sleep_for(interval);
+		}
+	});
+}
+
+void machine_watcherT::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		running = false;
+	}
+	if (watcher.joinable()) watcher.join();
+}
+
+std::time_t machine_watcherT::modification_time() const {
+	struct stat st;
+	if (::stat(filename.c_str(), &st) != 0) return 0;
+	return st.st_mtime;
+}
@@ -0,0 +1,126 @@
+#include "poncos/mbm_monitor.hpp"
+
+#include <cassert>
+#include <utility>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(mbm_monitor_log, "mbm-monitor")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(mbm_monitor_log, info);
+
+// number of samples per window
+constexpr int SAMPLES_PER_WINDOW = 10;
+
+mbm_monitorT::mbm_monitorT(resctrlT resctrl, double peak_bw, std::chrono::milliseconds window, std::string event)
+	: resctrl(std::move(resctrl)), peak_bw(peak_bw), window(window), event(std::move(event)), running(false) {
+	assert(peak_bw > 0);
+	assert(window.count() > 0);
+}
+
+mbm_monitorT::~mbm_monitorT() { stop(); }
+
+void mbm_monitorT::start() {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (running) return;
+	running = true;
+
+	sampler = std::thread([this] {
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if (!running) break;
+				sample_all();
+			}
+			std::this_thread::sleep_for(window / SAMPLES_PER_WINDOW);
+		}
+	});
+}
+
+void mbm_monitorT::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		running = false;
+	}
+	if (sampler.joinable()) sampler.join();
+}
+
+void mbm_monitorT::poll() {
+	std::lock_guard<std::mutex> lock(mtx);
+	sample_all();
+}
+
+void mbm_monitorT::watch(const std::string &host, const std::string &group) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	// groups that were already removed are not watched, as the sampler would drop them anyway
+	const keyT key(host, group);
+	if (samples.find(key) != samples.end() || !resctrl.group_exists(host, group)) return;
+	sample(key, samples[key]);
+}
+
+double mbm_monitorT::bandwidth(const std::string &host, const std::string &group) {
+	const keyT key(host, group);
+
+	watch(host, group);
+
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		// the sampler drops groups that were removed in the meantime
+		auto iter = samples.find(key);
+		if (iter == samples.end()) return 0.0;
+		auto &group_samples = iter->second;
+
+		const auto span = group_samples.back().first - group_samples.front().first;
+		if (span >= window) {
+			const sampleT &first = group_samples.front();
+			const sampleT &last = group_samples.back();
+			const std::chrono::duration<double> duration = span;
+
+			// counters may be reset, e.g. if the group was recreated
+			if (last.second < first.second) return 0.0;
+			return static_cast<double>(last.second - first.second) / duration.count();
+		}
+
+		// wait until the samples span a full window
+		lock.unlock();
+		std::this_thread::sleep_for(window - span);
+		lock.lock();
+
+		iter = samples.find(key);
+		if (iter == samples.end()) return 0.0;
+		if (!resctrl.group_exists(host, group)) {
+			samples.erase(iter);
+			return 0.0;
+		}
+		sample(key, iter->second);
+	}
+}
+
+double mbm_monitorT::utilization(const std::string &host, const std::string &group) {
+	return bandwidth(host, group) / peak_bw;
+}
+
+void mbm_monitorT::sample_all() {
+	for (auto iter = samples.begin(); iter != samples.end();) {
+		if (!resctrl.group_exists(iter->first.first, iter->first.second)) {
+			FASTLIB_LOG(mbm_monitor_log, debug) << "dropping removed group " << iter->first.second << " on "
+												<< iter->first.first;
+			iter = samples.erase(iter);
+			continue;
+		}
+
+		sample(iter->first, iter->second);
+		++iter;
+	}
+}
+
+void mbm_monitorT::sample(const keyT &key, std::deque<sampleT> &group_samples) const {
+	const auto now = clockT::now();
+	group_samples.emplace_back(now, resctrl.mbm_bytes(key.first, key.second, event));
+
+	// keep exactly one sample older than the window to always span a full window
+	while (group_samples.size() > 2 && now - group_samples[1].first >= window) {
+		group_samples.pop_front();
+	}
+}
@@ -0,0 +1,318 @@
+#include "poncos/membw_history.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(membw_history_log, "membw-history")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(membw_history_log, info);
+
+// file layout: header, sample ring, aggregate ring
+static constexpr char HISTORY_MAGIC[8] = {'P', 'O', 'N', 'C', 'O', 'S', 'H', '1'};
+
+struct membw_historyT::headerT {
+	char magic[8];
+	uint64_t sample_capacity;
+	uint64_t aggregate_capacity;
+	// number of records written so far, the next one is stored at count % capacity
+	uint64_t sample_count;
+	uint64_t aggregate_count;
+	int64_t interval_ms;
+	uint64_t reserved[2];
+};
+
+static_assert(sizeof(membw_sampleT) == 88, "the layout of the history file changed");
+static_assert(sizeof(membw_aggregateT) == 64, "the layout of the history file changed");
+
+template <size_t N> static void copy_name(char (&dst)[N], const std::string &src) {
+	std::memset(dst, 0, N);
+	std::strncpy(dst, src.c_str(), N - 1);
+}
+
+template <size_t N> static std::string name_of(const char (&src)[N]) { return std::string(src, strnlen(src, N)); }
+
+// names are compared as stored, i.e. truncated
+template <size_t N> static bool name_matches(const char (&name)[N], const std::string &query) {
+	return query.empty() || name_of(name) == query.substr(0, N - 1);
+}
+
+static int64_t to_ms(const std::chrono::system_clock::time_point &time) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+static bool sample_matches(const membw_sampleT &sample, const membw_queryT &query, const int64_t since) {
+	return sample.time >= since && name_matches(sample.host, query.host) &&
+		   (query.slot == membw_queryT::any || sample.slot == query.slot) &&
+		   (query.job == membw_queryT::any || sample.job == query.job) &&
+		   name_matches(sample.application, query.application);
+}
+
+// the records of a ring of capacity that holds count records in total, oldest first
+template <typename T> static void append_ring(const T *ring, const uint64_t capacity, const uint64_t count,
+											   std::vector<T> &ret) {
+	const uint64_t size = std::min(count, capacity);
+	ret.reserve(ret.size() + size);
+	for (uint64_t i = count - size; i < count; ++i) {
+		ret.push_back(ring[i % capacity]);
+	}
+}
+
+membw_historyT::membw_historyT(const std::string &path, size_t sample_capacity, size_t aggregate_capacity,
+							   std::chrono::seconds interval)
+	: path(path), interval_ms(std::chrono::duration_cast<std::chrono::milliseconds>(interval).count()) {
+	static_assert(sizeof(headerT) == 64, "the layout of the history file changed");
+	assert(sample_capacity > 0 && aggregate_capacity > 0 && interval_ms > 0);
+
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	assert(fd != -1);
+
+	map_size = sizeof(headerT) + sample_capacity * sizeof(membw_sampleT) +
+			   aggregate_capacity * sizeof(membw_aggregateT);
+	struct stat st;
+	auto temp = ::fstat(fd, &st);
+	assert(temp == 0);
+	const bool empty = st.st_size == 0;
+	const bool existing = static_cast<size_t>(st.st_size) == map_size;
+	if (!existing) {
+		temp = ::ftruncate(fd, static_cast<off_t>(map_size));
+		assert(temp == 0);
+	}
+	map = static_cast<char *>(::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+	assert(map != MAP_FAILED);
+	(void)temp;
+
+	// the history of a previous run is kept if it has the same layout
+	headerT &h = header();
+	if (!existing || std::memcmp(h.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) != 0 ||
+		h.sample_capacity != sample_capacity || h.aggregate_capacity != aggregate_capacity ||
+		h.interval_ms != interval_ms) {
+		if (!empty) {
+			FASTLIB_LOG(membw_history_log, warn)
+				<< path << " was written with a different capacity or interval, its history is discarded";
+		}
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+		h.sample_capacity = sample_capacity;
+		h.aggregate_capacity = aggregate_capacity;
+		h.interval_ms = interval_ms;
+	}
+}
+
+membw_historyT::~membw_historyT() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		for (const auto &aggregate : open_aggregates) {
+			append_aggregate(aggregate.second);
+		}
+		open_aggregates.clear();
+	}
+
+	::msync(map, map_size, MS_SYNC);
+	::munmap(map, map_size);
+	::close(fd);
+}
+
+membw_historyT::headerT &membw_historyT::header() const { return *reinterpret_cast<headerT *>(map); }
+
+membw_sampleT *membw_historyT::sample_ring() const {
+	return reinterpret_cast<membw_sampleT *>(map + sizeof(headerT));
+}
+
+membw_aggregateT *membw_historyT::aggregate_ring() const {
+	return reinterpret_cast<membw_aggregateT *>(map + sizeof(headerT) +
+												header().sample_capacity * sizeof(membw_sampleT));
+}
+
+void membw_historyT::record(const std::string &host, const size_t slot, const size_t job,
+							const std::string &application, const double utilization, const double membw) {
+	membw_sampleT sample;
+	std::memset(&sample, 0, sizeof(sample));
+	sample.time = to_ms(std::chrono::system_clock::now());
+	sample.job = job;
+	sample.slot = static_cast<uint32_t>(slot);
+	sample.utilization = utilization;
+	sample.membw = membw;
+	copy_name(sample.host, host);
+	copy_name(sample.application, application);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	headerT &h = header();
+	sample_ring()[h.sample_count % h.sample_capacity] = sample;
+	++h.sample_count;
+
+	// downsampling, the aggregate of the previous interval of the slot is complete
+	const int64_t start = sample.time - sample.time % interval_ms;
+	auto iter = open_aggregates.find({host, sample.slot});
+	if (iter != open_aggregates.end() && iter->second.time != start) {
+		append_aggregate(iter->second);
+		open_aggregates.erase(iter);
+		iter = open_aggregates.end();
+	}
+	if (iter == open_aggregates.end()) {
+		membw_aggregateT aggregate;
+		std::memset(&aggregate, 0, sizeof(aggregate));
+		aggregate.time = start;
+		aggregate.slot = sample.slot;
+		copy_name(aggregate.host, host);
+		iter = open_aggregates.emplace(std::make_pair(host, sample.slot), aggregate).first;
+	}
+
+	membw_aggregateT &aggregate = iter->second;
+	++aggregate.samples;
+	aggregate.utilization_sum += utilization;
+	aggregate.utilization_max = std::max(aggregate.utilization_max, utilization);
+	aggregate.membw_sum += membw;
+}
+
+void membw_historyT::append_aggregate(const membw_aggregateT &aggregate) {
+	headerT &h = header();
+	aggregate_ring()[h.aggregate_count % h.aggregate_capacity] = aggregate;
+	++h.aggregate_count;
+}
+
+std::vector<membw_sampleT> membw_historyT::samples(const membw_queryT &query) const {
+	const int64_t since = to_ms(query.since);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	const headerT &h = header();
+	const uint64_t size = std::min(h.sample_count, h.sample_capacity);
+
+	std::vector<membw_sampleT> ret;
+	for (uint64_t i = h.sample_count - size; i < h.sample_count; ++i) {
+		const membw_sampleT &sample = sample_ring()[i % h.sample_capacity];
+		if (sample_matches(sample, query, since)) ret.push_back(sample);
+	}
+	return ret;
+}
+
+std::vector<membw_aggregateT> membw_historyT::aggregates(const membw_queryT &query) const {
+	const int64_t since = to_ms(query.since);
+	const auto matches = [&](const membw_aggregateT &aggregate) {
+		return aggregate.time + interval_ms > since && name_matches(aggregate.host, query.host) &&
+			   (query.slot == membw_queryT::any || aggregate.slot == query.slot);
+	};
+
+	std::lock_guard<std::mutex> lock(mtx);
+	const headerT &h = header();
+	const uint64_t size = std::min(h.aggregate_count, h.aggregate_capacity);
+
+	std::vector<membw_aggregateT> ret;
+	for (uint64_t i = h.aggregate_count - size; i < h.aggregate_count; ++i) {
+		const membw_aggregateT &aggregate = aggregate_ring()[i % h.aggregate_capacity];
+		if (matches(aggregate)) ret.push_back(aggregate);
+	}
+	for (const auto &aggregate : open_aggregates) {
+		if (matches(aggregate.second)) ret.push_back(aggregate.second);
+	}
+	return ret;
+}
+
+double membw_historyT::percentile(const membw_queryT &query, const double p) const {
+	assert(p >= 0 && p <= 1);
+
+	const auto matching = samples(query);
+	if (matching.empty()) return 0;
+
+	std::vector<double> utilization;
+	utilization.reserve(matching.size());
+	for (const auto &sample : matching) {
+		utilization.push_back(sample.utilization);
+	}
+
+	// nearest rank
+	const auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(utilization.size())));
+	const auto nth = utilization.begin() + static_cast<long>(rank == 0 ? 0 : rank - 1);
+	std::nth_element(utilization.begin(), nth, utilization.end());
+	return *nth;
+}
+
+double membw_historyT::trend(const std::string &host, const std::chrono::system_clock::time_point &since) const {
+	membw_queryT query;
+	query.host = host;
+	query.since = since;
+
+	// utilization of the node per interval, the sum of the mean utilization of its slots
+	std::map<int64_t, double> node_utilization;
+	for (const auto &aggregate : aggregates(query)) {
+		node_utilization[aggregate.time] += aggregate.utilization_sum / aggregate.samples;
+	}
+	if (node_utilization.size() < 2) return 0;
+
+	// least squares fit, time in hours relative to the first interval
+	const double origin = static_cast<double>(node_utilization.begin()->first);
+	double sum_t = 0, sum_u = 0, sum_tt = 0, sum_tu = 0;
+	for (const auto &point : node_utilization) {
+		const double t = (static_cast<double>(point.first) - origin) / 3.6e6;
+		sum_t += t;
+		sum_u += point.second;
+		sum_tt += t * t;
+		sum_tu += t * point.second;
+	}
+	const auto n = static_cast<double>(node_utilization.size());
+	return (n * sum_tu - sum_t * sum_u) / (n * sum_tt - sum_t * sum_t);
+}
+
+void membw_historyT::read(const std::string &path, std::vector<membw_sampleT> &samples,
+						  std::vector<membw_aggregateT> &aggregates) {
+	std::ifstream in(path, std::ios::binary);
+	assert(in.good());
+
+	headerT h;
+	in.read(reinterpret_cast<char *>(&h), sizeof(h));
+	const bool valid = in.good() && std::memcmp(h.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) == 0;
+	assert(valid);
+	(void)valid;
+
+	std::vector<membw_sampleT> sample_ring(h.sample_capacity);
+	in.read(reinterpret_cast<char *>(sample_ring.data()),
+			static_cast<std::streamsize>(sample_ring.size() * sizeof(membw_sampleT)));
+	std::vector<membw_aggregateT> aggregate_ring(h.aggregate_capacity);
+	in.read(reinterpret_cast<char *>(aggregate_ring.data()),
+			static_cast<std::streamsize>(aggregate_ring.size() * sizeof(membw_aggregateT)));
+	assert(in.good());
+
+	append_ring(sample_ring.data(), h.sample_capacity, h.sample_count, samples);
+	append_ring(aggregate_ring.data(), h.aggregate_capacity, h.aggregate_count, aggregates);
+}
+
+void membw_historyT::export_samples(const std::vector<membw_sampleT> &samples, std::ostream &os) {
+	const auto flags = os.flags();
+	const auto precision = os.precision();
+	os << std::fixed << std::setprecision(4);
+
+	os << "time_ms,host,slot,job,application,utilization,membw\n";
+	for (const auto &sample : samples) {
+		os << sample.time << ',' << name_of(sample.host) << ',' << sample.slot << ',' << sample.job << ','
+		   << name_of(sample.application) << ',' << sample.utilization << ',' << sample.membw << '\n';
+	}
+
+	os.flags(flags);
+	os.precision(precision);
+}
+
+void membw_historyT::export_aggregates(const std::vector<membw_aggregateT> &aggregates, std::ostream &os) {
+	const auto flags = os.flags();
+	const auto precision = os.precision();
+	os << std::fixed << std::setprecision(4);
+
+	os << "time_ms,host,slot,samples,utilization_mean,utilization_max,membw_mean\n";
+	for (const auto &aggregate : aggregates) {
+		os << aggregate.time << ',' << name_of(aggregate.host) << ',' << aggregate.slot << ',' << aggregate.samples
+		   << ',' << aggregate.utilization_sum / aggregate.samples << ',' << aggregate.utilization_max << ','
+		   << aggregate.membw_sum / aggregate.samples << '\n';
+	}
+
+	os.flags(flags);
+	os.precision(precision);
+}
@@ -0,0 +1,315 @@
+#include "poncos/metrics.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(metrics_log, "metrics")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(metrics_log, info);
+
+// the server thread checks for stop() at least this often
+static constexpr int ACCEPT_POLL_INTERVAL_MS = 200;
+// requests are read until the end of the header or this many bytes
+static constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+struct metric_infoT {
+	const char *name;
+	const char *help;
+};
+
+static constexpr metric_infoT COUNTER_INFO[] = {
+	{"poncos_jobs_submitted_total", "Jobs added to the queue."},
+	{"poncos_jobs_started_total", "Jobs started by the controller."},
+	{"poncos_jobs_finished_total", "Jobs completed."},
+	{"poncos_freezes_total", "Jobs frozen to free their resources."},
+	{"poncos_migrations_total", "Domains migrated to another machine."},
+	{"poncos_measurements_total", "Memory bandwidth measurements of new jobs."},
+};
+
+static constexpr metric_infoT GAUGE_INFO[] = {
+	{"poncos_queue_pending", "Jobs in the queue not started yet."},
+	{"poncos_jobs_running", "Jobs started and not completed."},
+	{"poncos_machines", "Machines managed by the controller."},
+	{"poncos_machines_drained", "Machines that do not accept new jobs."},
+	{"poncos_cpus", "CPUs of all machines."},
+	{"poncos_cpus_free", "CPUs not used by a job."},
+	{"poncos_load", "Mean dominant share of the nodes, i.e. the highest fraction of any capacity used."},
+};
+
+static constexpr metric_infoT NODE_GAUGE_INFO[] = {
+	{"poncos_node_slots_used", "Slots of the machine used by jobs."},
+	{"poncos_node_membw", "Memory bandwidth used on the machine in GB/s (fraction of the peak if not calibrated)."},
+	{"poncos_node_net", "NIC throughput of the machine in GB/s."},
+	{"poncos_node_io", "Local I/O throughput of the machine in GB/s."},
+};
+
+// decisions are expected to take micro- to milliseconds, measurements and migrations seconds to minutes
+static const std::vector<double> DECISION_BUCKETS = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+													  0.025,  0.05,    0.1,    0.25,  0.5,    1,     10};
+static const std::vector<double> DURATION_BUCKETS = {0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600, 1800, 3600};
+
+struct histogram_infoT {
+	const char *name;
+	const char *help;
+	const std::vector<double> &bounds;
+};
+
+static const histogram_infoT HISTOGRAM_INFO[] = {
+	{"poncos_placement_decision_seconds", "Time to place a job once enough resources are available.",
+	 DECISION_BUCKETS},
+	{"poncos_swap_decision_seconds", "Time to search for a better placement of the running jobs.", DECISION_BUCKETS},
+	{"poncos_measurement_seconds", "Duration of the memory bandwidth measurement of new jobs.", DURATION_BUCKETS},
+	{"poncos_migration_seconds", "Duration of domain migrations.", DURATION_BUCKETS},
+	{"poncos_frozen_seconds", "Time jobs were frozen.", DURATION_BUCKETS},
+};
+
+static_assert(sizeof(COUNTER_INFO) / sizeof(COUNTER_INFO[0]) == static_cast<size_t>(counterT::count),
+			  "missing counter");
+static_assert(sizeof(GAUGE_INFO) / sizeof(GAUGE_INFO[0]) == static_cast<size_t>(gaugeT::count), "missing gauge");
+static_assert(sizeof(NODE_GAUGE_INFO) / sizeof(NODE_GAUGE_INFO[0]) == static_cast<size_t>(node_gaugeT::count),
+			  "missing node gauge");
+
+// bucket bounds with the default precision, i.e. 0.0005 instead of its closest double
+static std::string format_bound(const double bound) {
+	std::ostringstream out;
+	out << bound;
+	return out.str();
+}
+
+static void atomic_add(std::atomic<double> &target, const double value) {
+	double old = target.load(std::memory_order_relaxed);
+	while (!target.compare_exchange_weak(old, old + value, std::memory_order_relaxed)) {
+	}
+}
+
+metricsT::metricsT(std::string endpoint) : endpoint(std::move(endpoint)), listen_fd(-1) {
+	for (auto &counter : counters) counter.store(0, std::memory_order_relaxed);
+	for (auto &gauge : gauges) gauge.store(0, std::memory_order_relaxed);
+	for (size_t h = 0; h < histograms.size(); ++h) {
+		assert(HISTOGRAM_INFO[h].bounds.size() < histograms[h].buckets.size());
+		for (auto &bucket : histograms[h].buckets) bucket.store(0, std::memory_order_relaxed);
+		histograms[h].sum.store(0, std::memory_order_relaxed);
+	}
+	for (auto &chunk : node_chunks) chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+metricsT::~metricsT() {
+	stop();
+	for (auto &chunk : node_chunks) delete[] chunk.load();
+}
+
+void metricsT::start() {
+	assert(!running);
+
+	if (endpoint.compare(0, 5, "unix:") == 0) {
+		const std::string path = endpoint.substr(5);
+		sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		assert(!path.empty() && path.size() < sizeof(addr.sun_path));
+		std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+		::unlink(path.c_str());
+
+		listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		assert(listen_fd != -1);
+		const auto temp = ::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+		assert(temp == 0);
+	} else {
+		// the endpoint is only exposed on the loopback interface unless an address is given
+		std::string host = "127.0.0.1";
+		std::string port = endpoint;
+		const auto pos = endpoint.find_last_of(':');
+		if (pos != std::string::npos) {
+			host = endpoint.substr(0, pos);
+			port = endpoint.substr(pos + 1);
+		}
+		sockaddr_in addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(static_cast<uint16_t>(std::stoul(port)));
+		auto temp = ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+		assert(temp == 1);
+
+		listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		assert(listen_fd != -1);
+		const int enable = 1;
+		::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+		temp = ::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+		assert(temp == 0);
+	}
+	const auto temp = ::listen(listen_fd, 16);
+	assert(temp == 0);
+	(void)temp;
+
+	FASTLIB_LOG(metrics_log, info) << "Serving metrics on " << endpoint;
+	running = true;
+	server = std::thread([this] { serve(); });
+}
+
+void metricsT::stop() {
+	if (!running.exchange(false)) return;
+	server.join();
+	::close(listen_fd);
+	if (endpoint.compare(0, 5, "unix:") == 0) ::unlink(endpoint.substr(5).c_str());
+}
+
+void metricsT::add(const counterT counter, const uint64_t value) {
+	counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void metricsT::set(const gaugeT gauge, const double value) {
+	gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+void metricsT::observe(const histogramT histogram, const double value) {
+	histogram_dataT &data = histograms[static_cast<size_t>(histogram)];
+	const auto &bounds = HISTOGRAM_INFO[static_cast<size_t>(histogram)].bounds;
+
+	size_t bucket = 0;
+	while (bucket < bounds.size() && value > bounds[bucket]) ++bucket;
+	data.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	atomic_add(data.sum, value);
+}
+
+void metricsT::set(const node_gaugeT gauge, const size_t machine, const double value) {
+	node(machine).values[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+void metricsT::name_node(const size_t machine, const std::string &host) {
+	// allocates the values of the machine, i.e. render() never sees a named machine without them
+	node(machine);
+
+	std::lock_guard<std::mutex> lock(names_mutex);
+	if (node_names.size() <= machine) node_names.resize(machine + 1);
+	node_names[machine] = host;
+}
+
+metricsT::node_dataT &metricsT::node(const size_t machine) {
+	const size_t c = machine / NODE_CHUNK;
+	assert(c < MAX_NODE_CHUNKS);
+
+	node_dataT *chunk = node_chunks[c].load(std::memory_order_acquire);
+	if (chunk == nullptr) {
+		// racing threads allocate a chunk each, all but one are dropped
+		auto *fresh = new node_dataT[NODE_CHUNK];
+		for (size_t n = 0; n < NODE_CHUNK; ++n) {
+			for (auto &value : fresh[n].values) value.store(0, std::memory_order_relaxed);
+		}
+		if (node_chunks[c].compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+			chunk = fresh;
+		} else {
+			delete[] fresh;
+		}
+	}
+	return chunk[machine % NODE_CHUNK];
+}
+
+std::string metricsT::render() const {
+	std::ostringstream out;
+	out << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+	for (size_t c = 0; c < counters.size(); ++c) {
+		out << "# HELP " << COUNTER_INFO[c].name << ' ' << COUNTER_INFO[c].help << '\n';
+		out << "# TYPE " << COUNTER_INFO[c].name << " counter\n";
+		out << COUNTER_INFO[c].name << ' ' << counters[c].load(std::memory_order_relaxed) << '\n';
+	}
+
+	for (size_t g = 0; g < gauges.size(); ++g) {
+		out << "# HELP " << GAUGE_INFO[g].name << ' ' << GAUGE_INFO[g].help << '\n';
+		out << "# TYPE " << GAUGE_INFO[g].name << " gauge\n";
+		out << GAUGE_INFO[g].name << ' ' << gauges[g].load(std::memory_order_relaxed) << '\n';
+	}
+
+	for (size_t h = 0; h < histograms.size(); ++h) {
+		const histogram_infoT &info = HISTOGRAM_INFO[h];
+		const histogram_dataT &data = histograms[h];
+		out << "# HELP " << info.name << ' ' << info.help << '\n';
+		out << "# TYPE " << info.name << " histogram\n";
+
+		// the count is derived from the buckets, i.e. it matches the +Inf bucket even if observe() runs concurrently
+		uint64_t cumulative = 0;
+		for (size_t b = 0; b < info.bounds.size(); ++b) {
+			cumulative += data.buckets[b].load(std::memory_order_relaxed);
+			out << info.name << "_bucket{le=\"" << format_bound(info.bounds[b]) << "\"} " << cumulative << '\n';
+		}
+		cumulative += data.buckets[info.bounds.size()].load(std::memory_order_relaxed);
+		out << info.name << "_bucket{le=\"+Inf\"} " << cumulative << '\n';
+		out << info.name << "_sum " << data.sum.load(std::memory_order_relaxed) << '\n';
+		out << info.name << "_count " << cumulative << '\n';
+	}
+
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(names_mutex);
+		names = node_names;
+	}
+	for (size_t g = 0; g < static_cast<size_t>(node_gaugeT::count); ++g) {
+		out << "# HELP " << NODE_GAUGE_INFO[g].name << ' ' << NODE_GAUGE_INFO[g].help << '\n';
+		out << "# TYPE " << NODE_GAUGE_INFO[g].name << " gauge\n";
+		for (size_t m = 0; m < names.size(); ++m) {
+			if (names[m].empty()) continue;
+			const node_dataT *chunk = node_chunks[m / NODE_CHUNK].load(std::memory_order_acquire);
+			out << NODE_GAUGE_INFO[g].name << "{node=\"" << names[m] << "\"} "
+				<< chunk[m % NODE_CHUNK].values[g].load(std::memory_order_relaxed) << '\n';
+		}
+	}
+	return out.str();
+}
+
+void metricsT::serve() {
+	while (running) {
+		pollfd pfd = {listen_fd, POLLIN, 0};
+		if (::poll(&pfd, 1, ACCEPT_POLL_INTERVAL_MS) <= 0) continue;
+
+		const int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd == -1) {
+			FASTLIB_LOG(metrics_log, warn) << "Accepting a metrics request failed: " << std::strerror(errno);
+			continue;
+		}
+		answer(fd);
+		::close(fd);
+	}
+}
+
+void metricsT::answer(const int fd) const {
+	// the request itself does not matter, every path returns all metrics
+	std::string request;
+	char buffer[512];
+	while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos &&
+		   request.size() < MAX_REQUEST_SIZE) {
+		pollfd pfd = {fd, POLLIN, 0};
+		if (::poll(&pfd, 1, ACCEPT_POLL_INTERVAL_MS) <= 0) break;
+		const auto bytes = ::read(fd, buffer, sizeof(buffer));
+		if (bytes <= 0) break;
+		request.append(buffer, static_cast<size_t>(bytes));
+	}
+
+	const std::string body = render();
+	std::ostringstream response;
+	response << "HTTP/1.0 200 OK\r\n"
+			 << "Content-Type: text/plain; version=0.0.4\r\n"
+			 << "Content-Length: " << body.size() << "\r\n"
+			 << "Connection: close\r\n\r\n"
+			 << body;
+
+	const std::string data = response.str();
+	size_t written = 0;
+	while (written < data.size()) {
+		const auto bytes = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+		if (bytes <= 0) break;
+		written += static_cast<size_t>(bytes);
+	}
+}
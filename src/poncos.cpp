@@ -8,17 +8,35 @@
  * Some rights reserved. See LICENSE
  */
 
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 
 #include "poncos/controller_cgroup.hpp"
 #include "poncos/controller_vm.hpp"
+#include "poncos/event_trace.hpp"
+#include "poncos/interference_model.hpp"
+#include "poncos/job_source.hpp"
+#include "poncos/journal.hpp"
+#include "poncos/machine_watcher.hpp"
+#include "poncos/mbm_monitor.hpp"
+#include "poncos/decision_log.hpp"
+#include "poncos/membw_history.hpp"
+#include "poncos/metrics.hpp"
+#include "poncos/psi_monitor.hpp"
+#include "poncos/rack.hpp"
+#include "poncos/resource_monitor.hpp"
+#include "poncos/submission_server.hpp"
 #include "poncos/poncos.hpp"
+#include "poncos/progress_monitor.hpp"
 #include "poncos/scheduler.hpp"
 #include "poncos/scheduler_multi_app.hpp"
 #include "poncos/scheduler_multi_app_consec.hpp"
 #include "poncos/scheduler_two_app.hpp"
+#include "poncos/threshold_tuner.hpp"
+#include "poncos/topology.hpp"
 
 #include <fast-lib/message/migfra/time_measurement.hpp>
 #include <fast-lib/mqtt_communicator.hpp>
@@ -31,10 +49,42 @@ FASTLIB_LOG_SET_LEVEL_GLOBAL(poncos_log, info);
 static std::string server;
 static size_t port = 1883;
 static std::string queue_filename;
+static std::string swf_filename;
+static std::string swf_command = "sleep %r";
+static double replay_speedup = 1;
 static std::string machine_filename;
+static bool watch_machines = false;
+static bool elastic_machines = false;
 static std::string system_config_filename;
 static std::string slot_path;
+static std::string topology_strategy;
+static size_t topology_slots = 2;
+static bool validate_topology = false;
+static std::string sysfs_root = "/sys/devices/system";
+static std::string resctrl_path;
 static std::chrono::seconds wait_time(20);
+static bool use_mbm = false;
+static double mbm_peak = 0;
+static std::chrono::milliseconds mbm_window(1000);
+static bool use_psi = false;
+static std::string cgroup_path = "/sys/fs/cgroup";
+static bool use_resources = false;
+static std::string proc_path = "/proc";
+static double membw_threshold = schedulerT::DEFAULT_MEMBW_TH;
+static double target_efficiency = 0;
+static std::string interference_filename;
+static bool use_progress = false;
+static bool accept_submissions = false;
+static std::string journal_path;
+static std::string trace_path;
+static std::string metrics_endpoint;
+static std::string history_path;
+static std::string decision_log_path;
+static std::chrono::milliseconds agent_deadline(0);
+static size_t agent_retries = 2;
+static drain_policyT drain_policy = drain_policyT::keep;
+static std::string rack_name;
+static std::string racks_filename;
 static bool use_vms = false;
 static bool use_multi_sched = false;
 static bool use_multi_sched_consec = false;
@@ -46,11 +96,44 @@ static bool use_multi_sched_consec = false;
 	std::cout << "\t --multi-sched-consec \t Use the multi-app scheduler w/o co-scheduling.\t Default: disabled\n";
 	std::cout << "\t --server \t\t URI of the MQTT broker. \t\t\t Required!\n";
 	std::cout << "\t --port \t\t Port of the MQTT broker. \t\t\t Default: 1883\n";
-	std::cout << "\t --queue \t\t Filename for the job queue. \t\t\t Required!\n";
+	std::cout << "\t --queue \t\t Filename for the job queue. \t\t\t Required unless listening!\n";
+	std::cout << "\t --swf \t\t\t Replay a trace in the Standard Workload Format instead of --queue.\n";
+	std::cout << "\t --swf-command \t\t Command of the SWF jobs, %r = runtime, %n = job, %p = procs. \t Default: sleep %r\n";
+	std::cout << "\t --replay-speedup \t Factor applied to the submit times of the jobs. \t Default: 1\n";
+	std::cout << "\t --listen \t\t Accept jobs via MQTT until the queue is closed. \t Default: disabled\n";
+	std::cout << "\t --journal \t\t Journal file to resume running jobs after a restart. \t Default: disabled\n";
+	std::cout << "\t --trace \t\t Binary file to record the job lifecycle events, see poncos_trace. \t Default: disabled\n";
+	std::cout << "\t --metrics \t\t Serve Prometheus metrics on [<address>:]<port> or unix:<path>. \t Default: disabled\n";
+	std::cout << "\t --history \t\t File storing the membw measurements across runs, see poncos_history. \t Default: disabled\n";
+	std::cout << "\t --decision-log \t File recording the inputs and outcome of every scheduling decision, see poncos_replay. \t Default: disabled\n";
+	std::cout << "\t --agent-deadline \t Seconds an agent may take to reply before its node is drained. \t Default: none\n";
+	std::cout << "\t --agent-retries \t Retries of idempotent agent requests before the deadline is missed. \t Default: 2\n";
+	std::cout << "\t --drain-policy \t Jobs on drained nodes: keep (running) or kill. \t Default: keep\n";
+	std::cout << "\t --rack \t\t Manage the nodes of a rack for a top-level dispatcher (implies --listen).\n";
+	std::cout << "\t --racks \t\t Filename containing rack names; dispatch jobs to the racks instead of nodes.\n";
 	std::cout << "\t --machine \t\t Filename containing node names. \t\t Required!\n";
+	std::cout << "\t --watch-machines \t Add and remove hosts once the machine file changes. \t Default: disabled\n";
+	std::cout << "\t --elastic \t\t Accept requests to add and remove hosts (with --listen). \t Default: disabled\n";
 	std::cout << "\t --system-config \t Filename containing the slot configuration in YAML forma. \t\t Required!\n";
+	std::cout << "\t --topology \t\t Generate the slots from sysfs instead: per-socket, per-numa or interleaved.\n";
+	std::cout << "\t --topology-slots \t Number of slots for interleaved. \t\t Default: 2\n";
+	std::cout << "\t --validate-topology \t Warn if the system config conflicts with sysfs. \t Default: disabled\n";
+	std::cout << "\t --sysfs-root \t\t Path used for topology discovery, %h is replaced by the host. \t Default: /sys/devices/system\n";
 	std::cout << "\t --slot-path \t\t VM only: Path to XML slot specifications. \t Required!\n";
+	std::cout << "\t --resctrl-path \t cgroup only: resctrl mount point, %h is replaced by the host. \t Default: /sys/fs/resctrl\n";
 	std::cout << "\t --wait \t\t Seconds to wait before starting distgen. \t Default: 20\n";
+	std::cout << "\t --membw-source \t Measure membw with 'distgen' or 'mbm' (resctrl). \t Default: distgen\n";
+	std::cout << "\t --mbm-peak \t\t MBM only: Calibrated peak membw of a node in GB/s. \t Required!\n";
+	std::cout << "\t --mbm-window \t\t MBM only: Sliding window in ms. \t\t\t Default: 1000\n";
+	std::cout << "\t --psi \t\t\t cgroup only: Monitor pressure stall information. \t Default: disabled\n";
+	std::cout << "\t --cgroup-path \t\t cgroup v2 mount point, %h is replaced by the host. \t Default: /sys/fs/cgroup\n";
+	std::cout << "\t --resources \t\t cgroup only: Co-schedule by NIC and local I/O throughput as well. \t Default: disabled\n";
+	std::cout << "\t --proc-path \t\t procfs mount point, %h is replaced by the host. \t Default: /proc\n";
+	std::cout << "\t --membw-threshold \t Highest membw utilization of a node (0..1). \t Default: "
+			  << schedulerT::DEFAULT_MEMBW_TH << "\n";
+	std::cout << "\t --interference-model \t File to load/store the learned interference of application pairs.\n";
+	std::cout << "\t --progress \t\t Undo co-location that slows down the progress reported by jobs. \t Default: disabled\n";
+	std::cout << "\t --tune-threshold \t Adjust the threshold to reach the target efficiency (0..1). \t Default: disabled\n";
 
 	exit(0);
 }
@@ -91,6 +174,31 @@ static void parse_options(size_t argc, const char **argv) {
 			++i;
 			continue;
 		}
+		if (arg == "--swf") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			swf_filename = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+		if (arg == "--swf-command") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			swf_command = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+		if (arg == "--replay-speedup") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			replay_speedup = std::stod(std::string(argv[i + 1]));
+			if (replay_speedup <= 0) print_help(argv[0]);
+			++i;
+			continue;
+		}
 		if (arg == "--machine") {
 			if (i + 1 >= argc) {
 				print_help(argv[0]);
@@ -99,6 +207,14 @@ static void parse_options(size_t argc, const char **argv) {
 			++i;
 			continue;
 		}
+		if (arg == "--watch-machines") {
+			watch_machines = true;
+			continue;
+		}
+		if (arg == "--elastic") {
+			elastic_machines = true;
+			continue;
+		}
 		if (arg == "--system-config") {
 			if (i + 1 >= argc) {
 				print_help(argv[0]);
@@ -108,6 +224,38 @@ static void parse_options(size_t argc, const char **argv) {
 			continue;
 		}
 
+		if (arg == "--topology") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			topology_strategy = std::string(argv[i + 1]);
+			if (topology_strategy != "per-socket" && topology_strategy != "per-numa" &&
+				topology_strategy != "interleaved")
+				print_help(argv[0]);
+			++i;
+			continue;
+		}
+		if (arg == "--topology-slots") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			topology_slots = std::stoul(std::string(argv[i + 1]));
+			++i;
+			continue;
+		}
+		if (arg == "--validate-topology") {
+			validate_topology = true;
+			continue;
+		}
+		if (arg == "--sysfs-root") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			sysfs_root = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
 		if (arg == "--vm") {
 			use_vms = true;
 			continue;
@@ -121,6 +269,15 @@ static void parse_options(size_t argc, const char **argv) {
 			continue;
 		}
 
+		if (arg == "--resctrl-path") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			resctrl_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
 		if (arg == "--wait") {
 			if (i + 1 >= argc) {
 				print_help(argv[0]);
@@ -131,6 +288,186 @@ static void parse_options(size_t argc, const char **argv) {
 			continue;
 		}
 
+		if (arg == "--membw-source") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			const std::string source(argv[i + 1]);
+			if (source != "distgen" && source != "mbm") print_help(argv[0]);
+			use_mbm = source == "mbm";
+			++i;
+			continue;
+		}
+		if (arg == "--mbm-peak") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			mbm_peak = std::stod(std::string(argv[i + 1])) * 1e9;
+			++i;
+			continue;
+		}
+		if (arg == "--mbm-window") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			mbm_window = std::chrono::milliseconds(std::stoul(std::string(argv[i + 1])));
+			++i;
+			continue;
+		}
+
+		if (arg == "--psi") {
+			use_psi = true;
+			continue;
+		}
+		if (arg == "--cgroup-path") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			cgroup_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--resources") {
+			use_resources = true;
+			continue;
+		}
+		if (arg == "--proc-path") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			proc_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--membw-threshold") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			membw_threshold = std::stod(std::string(argv[i + 1]));
+			if (membw_threshold <= 0 || membw_threshold > 1) print_help(argv[0]);
+			++i;
+			continue;
+		}
+		if (arg == "--tune-threshold") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			target_efficiency = std::stod(std::string(argv[i + 1]));
+			if (target_efficiency <= 0 || target_efficiency > 1) print_help(argv[0]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--interference-model") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			interference_filename = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--listen") {
+			accept_submissions = true;
+			continue;
+		}
+		if (arg == "--journal") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			journal_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--trace") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			trace_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--metrics") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			metrics_endpoint = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--history") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			history_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--decision-log") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			decision_log_path = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--agent-deadline") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			agent_deadline = std::chrono::milliseconds(static_cast<long>(std::stod(std::string(argv[i + 1])) * 1000));
+			++i;
+			continue;
+		}
+		if (arg == "--agent-retries") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			agent_retries = std::stoul(std::string(argv[i + 1]));
+			++i;
+			continue;
+		}
+		if (arg == "--drain-policy") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			const std::string policy(argv[i + 1]);
+			if (policy != "keep" && policy != "kill") print_help(argv[0]);
+			drain_policy = drain_policy_from_string(policy);
+			++i;
+			continue;
+		}
+
+		if (arg == "--rack") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			rack_name = std::string(argv[i + 1]);
+			accept_submissions = true;
+			++i;
+			continue;
+		}
+		if (arg == "--racks") {
+			if (i + 1 >= argc) {
+				print_help(argv[0]);
+			}
+			racks_filename = std::string(argv[i + 1]);
+			++i;
+			continue;
+		}
+
+		if (arg == "--progress") {
+			use_progress = true;
+			continue;
+		}
+
 		if (arg == "--multi-sched") {
 			use_multi_sched = true;
 			continue;
@@ -144,42 +481,284 @@ static void parse_options(size_t argc, const char **argv) {
 	}
 
 	if (use_multi_sched_consec && use_multi_sched) print_help(argv[0]);
-	if (queue_filename == "" || machine_filename == "" || system_config_filename == "") print_help(argv[0]);
+	// only the multi-app scheduler handles machines added or removed at runtime
+	if ((watch_machines || elastic_machines) && !use_multi_sched) print_help(argv[0]);
+	if (elastic_machines && !accept_submissions) print_help(argv[0]);
+	if (queue_filename != "" && swf_filename != "") print_help(argv[0]);
+	// the trace replaces the queue file
+	const bool has_queue = queue_filename != "" || swf_filename != "";
+	// the dispatcher only needs the racks, the nodes are managed by the racks
+	if (racks_filename != "") {
+		if (rack_name != "" || journal_path != "" || server == "") print_help(argv[0]);
+		if (!has_queue && !accept_submissions) print_help(argv[0]);
+		return;
+	}
+	if ((!has_queue && !accept_submissions && journal_path == "") || machine_filename == "") {
+		print_help(argv[0]);
+	}
+	if (system_config_filename == "" && topology_strategy == "") print_help(argv[0]);
+	if (system_config_filename != "" && topology_strategy != "") print_help(argv[0]);
 	if (use_vms && slot_path == "") print_help(argv[0]);
+	// MBM requires the resctrl groups created by the cgroup controller
+	if (use_mbm && (use_vms || mbm_peak <= 0)) print_help(argv[0]);
+	if (use_mbm && resctrl_path == "") resctrl_path = "/sys/fs/resctrl";
+	if (use_psi && use_vms) print_help(argv[0]);
+	if (use_resources && use_vms) print_help(argv[0]);
 
 	if (wait_set && consec_set) {
 		std::cout << "multi-sched-consec selected. Ignoring wait argument." << std::endl;
 	}
 }
 
-int main(int argc, char const *argv[]) {
-	parse_options(static_cast<size_t>(argc), argv);
+// the schedulers pair the jobs of a node, i.e. every node needs exactly two slots
+static void require_two_slots(const system_configT &config, const std::string &host) {
+	if (config.slots.size() == 2) return;
+	std::cerr << "the slot layout of " << host << " has " << config.slots.size()
+			  << " slots, the schedulers require two" << std::endl;
+	exit(EXIT_FAILURE);
+}
 
-	FASTLIB_LOG(poncos_log, info) << "Reading job queue " << queue_filename << " ...";
-	job_queueT job_queue(queue_filename);
+// slots generated from the topology of host, i.e. from sysfs_root with %h replaced by host
+static system_configT generate_node_config(const std::string &host) {
+	const std::string problem = check_host_path(sysfs_root, {host}, "cpu/online", false);
+	if (problem != "") {
+		std::cerr << "cannot read the topology of " << host << ": " << problem << std::endl;
+		exit(EXIT_FAILURE);
+	}
 
-	FASTLIB_LOG(poncos_log, info) << "Job queue:";
-	FASTLIB_LOG(poncos_log, info) << "==============";
-	for (const auto &job : job_queue.jobs) {
-		FASTLIB_LOG(poncos_log, info) << job;
+	const std::string root = expand_host_path(sysfs_root, host);
+	FASTLIB_LOG(poncos_log, info) << "Generating " << topology_strategy << " slots of " << host << " from " << root
+								  << " ...";
+	const system_configT config =
+		topologyT(root).generate(slot_strategy_from_string(topology_strategy), topology_slots);
+	require_two_slots(config, host);
+	return config;
+}
+
+// submits the jobs of --queue or --swf to job_queue once they are due, the first skip jobs were submitted before
+// a restart. SWF jobs requesting more than max_procs are skipped. Without submissions via MQTT the queue is closed
+// at the end of the trace.
+static void feed_queue(job_queueT &job_queue, const size_t skip, const size_t max_procs) {
+	std::unique_ptr<job_sourceT> source;
+	if (queue_filename != "") {
+		FASTLIB_LOG(poncos_log, info) << "Reading job queue " << queue_filename << " ...";
+		source.reset(new yaml_job_sourceT(queue_filename));
+	} else if (swf_filename != "") {
+		FASTLIB_LOG(poncos_log, info) << "Replaying SWF trace " << swf_filename << " ...";
+		source.reset(new swf_job_sourceT(swf_filename, swf_command, max_procs));
+	}
+
+	if (source == nullptr) {
+		if (!accept_submissions) job_queue.close();
+		return;
 	}
-	FASTLIB_LOG(poncos_log, info) << "==============";
+	if (skip > 0) FASTLIB_LOG(poncos_log, info) << "Skipping the " << skip << " jobs submitted before the restart";
+	job_queue.feed(std::move(source), !accept_submissions, replay_speedup, 1024, skip);
+}
+
+// top-level of a two-level setup, the racks are poncos instances started with --rack
+static void dispatch_to_racks() {
+	std::vector<std::string> racks;
+	read_file(racks_filename, racks);
+	racks.erase(std::remove(racks.begin(), racks.end(), ""), racks.end());
+
+	job_queueT job_queue;
+	// the racks reject the jobs they cannot run
+	feed_queue(job_queue, 0, std::numeric_limits<size_t>::max());
 
 	auto comm = std::make_shared<fast::MQTT_communicator>("fast/poncos", "fast/poncos", "fast/poncos", server,
 														  static_cast<int>(port), 60);
 
+	rack_dispatcherT dispatcher(comm, racks);
+	submission_serverT submission_server(comm, job_queue);
+	if (accept_submissions) {
+		submission_server.check_jobs([&](const jobT &job) { return dispatcher.reject_reason(job); });
+		submission_server.start();
+	}
+
+	FASTLIB_LOG(poncos_log, info) << "Dispatching jobs to " << racks.size() << " racks";
+	dispatcher.dispatch(job_queue);
+
+	if (accept_submissions) submission_server.stop();
+}
+
+int main(int argc, char const *argv[]) {
+	parse_options(static_cast<size_t>(argc), argv);
+
+	if (racks_filename != "") {
+		dispatch_to_racks();
+		return 0;
+	}
+
+	std::shared_ptr<journalT> journal;
+	if (journal_path != "") journal = std::make_shared<journalT>(journal_path);
+	const bool recovering = journal != nullptr && journal->recovered();
+
+	job_queueT job_queue;
+
+	std::shared_ptr<event_traceT> trace;
+	if (trace_path != "") {
+		trace = std::make_shared<event_traceT>(trace_path);
+		trace->start();
+		job_queue.use_trace(trace);
+	}
+
+	std::shared_ptr<metricsT> metrics;
+	if (metrics_endpoint != "") {
+		metrics = std::make_shared<metricsT>(metrics_endpoint);
+		metrics->start();
+		job_queue.use_metrics(metrics);
+	}
+
+	// the topology of every host is read if the sysfs root contains %h, otherwise the local one applies to all
+	std::vector<std::string> hosts;
+	read_file(machine_filename, hosts);
+	hosts.erase(std::remove(hosts.begin(), hosts.end(), std::string()), hosts.end());
+	for (auto &host : hosts) {
+		host = host.substr(0, host.find_first_of(" \t"));
+	}
+	const bool per_host_topology = sysfs_root.find("%h") != std::string::npos;
+	if ((topology_strategy != "" || validate_topology) && !per_host_topology &&
+		(hosts.size() > 1 || (hosts.size() == 1 && !is_local_host(hosts[0])))) {
+		FASTLIB_LOG(poncos_log, warn) << "The topology of the local host is used for all hosts, add %h to "
+									  << sysfs_root << " to read the topology of every host";
+	}
+
 	controllerT *controller;
-	system_configT system_config(system_config_filename);
+	system_configT system_config;
+	controllerT::node_config_sourceT node_configs;
+	if (topology_strategy != "" && per_host_topology) {
+		if (hosts.empty()) print_help(argv[0]);
+		// the global layout is the one of the first host
+		system_config = generate_node_config(hosts.front());
+		node_configs = generate_node_config;
+	} else if (topology_strategy != "") {
+		FASTLIB_LOG(poncos_log, info) << "Generating " << topology_strategy << " slots from " << sysfs_root << " ...";
+		system_config = topologyT(sysfs_root).generate(slot_strategy_from_string(topology_strategy), topology_slots);
+	} else {
+		system_config = system_configT(system_config_filename);
+	}
+	require_two_slots(system_config, "the system config");
+
+	// the racks share the broker, i.e. their client ids must differ
+	const std::string client_id = rack_name == "" ? "fast/poncos" : "fast/poncos/racks/" + rack_name;
+	auto comm = std::make_shared<fast::MQTT_communicator>(client_id, "fast/poncos", "fast/poncos", server,
+														  static_cast<int>(port), 60);
 
 	if (use_vms)
-		controller = new vm_controller(comm, machine_filename, system_config, slot_path);
+		controller = new vm_controller(comm, machine_filename, system_config, slot_path, node_configs);
 	else
-		controller = new cgroup_controller(comm, machine_filename, system_config);
+		controller = new cgroup_controller(comm, machine_filename, system_config, resctrl_path, node_configs);
+
+	if (validate_topology && per_host_topology) {
+		for (size_t m = 0; m < controller->machines.size(); ++m) {
+			const std::string &host = controller->machines[m];
+			for (const auto &warning :
+				 topologyT(expand_host_path(sysfs_root, host)).validate(controller->node_config[m])) {
+				FASTLIB_LOG(poncos_log, warn) << "system config of " << host << " conflicts with topology: " << warning;
+			}
+		}
+	} else if (validate_topology) {
+		for (const auto &warning : topologyT(sysfs_root).validate(system_config)) {
+			FASTLIB_LOG(poncos_log, warn) << "system config conflicts with topology: " << warning;
+		}
+	}
+	controller->set_agent_deadline(agent_deadline, agent_retries, drain_policy);
+	if (trace != nullptr) controller->use_trace(trace);
+	if (metrics != nullptr) controller->use_metrics(metrics);
 
 	schedulerT *sched = nullptr;
 	if (use_multi_sched) sched = new multi_app_sched(system_config);
 	if (use_multi_sched_consec) sched = new multi_app_sched_consec(system_config);
-	if (sched == nullptr) sched = new two_app_sched(system_config);
+	if (sched == nullptr) {
+		const std::string problem = two_app_sched::layout_problem(*controller);
+		if (problem != "") {
+			std::cerr << "the slots of the machines cannot be used by the two-app scheduler: " << problem << std::endl;
+			return EXIT_FAILURE;
+		}
+		sched = new two_app_sched(system_config);
+	}
+
+	sched->set_membw_threshold(membw_threshold);
+	if (metrics != nullptr) sched->use_metrics(metrics);
+	if (history_path != "") sched->use_history(std::make_shared<membw_historyT>(history_path));
+	if (decision_log_path != "") sched->use_decision_log(std::make_shared<decision_logT>(decision_log_path));
+	if (target_efficiency > 0) {
+		sched->use_threshold_tuner(std::make_shared<threshold_tunerT>(membw_threshold, target_efficiency));
+	}
+
+	// the resctrl groups and the monitors use the file systems of the nodes, e.g. mounted via sshfs. Each host needs
+	// its own mount unless poncos runs on the only node.
+	std::vector<std::pair<std::string, std::string>> host_paths;
+	if (!use_vms && (system_config.has_resctrl() || resctrl_path != "")) {
+		host_paths.emplace_back(resctrl_path == "" ? "/sys/fs/resctrl" : resctrl_path, "schemata");
+	}
+	if (use_mbm) host_paths.emplace_back(resctrl_path, "mon_data");
+	// the domain cgroups must be created in the unified hierarchy, there are no pressure files in v1
+	if (use_psi || use_resources) host_paths.emplace_back(cgroup_path, "cgroup.controllers");
+	if (use_resources) host_paths.emplace_back(proc_path, "net/dev");
+	for (const auto &host_path : host_paths) {
+		const std::string problem =
+			check_host_path(host_path.first, controller->machines, host_path.second, elastic_machines);
+		if (problem == "") continue;
+		std::cerr << "cannot access the nodes: " << problem << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::shared_ptr<mbm_monitorT> mbm_monitor;
+	if (use_mbm) {
+		mbm_monitor = std::make_shared<mbm_monitorT>(resctrlT(resctrl_path), mbm_peak, mbm_window);
+		mbm_monitor->start();
+		sched->use_mbm(mbm_monitor);
+	}
+
+	std::shared_ptr<psi_monitorT> psi_monitor;
+	if (use_psi) {
+		psi_monitor = std::make_shared<psi_monitorT>(cgroup_path, std::chrono::milliseconds(1000));
+		psi_monitor->start();
+		sched->use_psi(psi_monitor);
+	}
+
+	std::shared_ptr<resource_monitorT> resource_monitor;
+	if (use_resources) {
+		resource_monitor = std::make_shared<resource_monitorT>(cgroup_path, proc_path, std::chrono::milliseconds(1000));
+		resource_monitor->start();
+		sched->use_resources(resource_monitor);
+	}
+
+	std::shared_ptr<interference_modelT> interference_model;
+	if (interference_filename != "") {
+		interference_model = std::make_shared<interference_modelT>(interference_filename);
+		sched->use_interference_model(interference_model);
+	}
+
+	std::shared_ptr<progress_monitorT> progress_monitor;
+	if (use_progress) {
+		// the applications connect to the same broker as poncos
+		controller->set_job_env("PONCOS_MQTT_SERVER", server);
+		controller->set_job_env("PONCOS_MQTT_PORT", std::to_string(port));
+
+		progress_monitor = std::make_shared<progress_monitorT>(comm);
+		progress_monitor->start();
+		sched->use_progress(progress_monitor);
+	}
+
+	if (journal != nullptr) {
+		controller->use_journal(journal);
+		job_queue.use_journal(journal);
+		if (recovering) {
+			FASTLIB_LOG(poncos_log, info) << "Recovering from journal " << journal_path << " ...";
+			// the scheduler did not measure the adopted jobs, it only releases their slots
+			controller->recover([&](const size_t id) {
+				sched->command_done(id, *controller);
+				job_queue.finished(id);
+			});
+			// the schedulers start one job per queue entry, i.e. the ids of queue and controller match
+			job_queue.recover(controller->next_id, [&](const size_t id) { return controller->running(id); });
+		}
+	}
+	// jobs are read while the schedulers run, after a restart the trace continues after the jobs restored
+	feed_queue(job_queue, job_queue.fed(), controller->summary().max_job_cpus);
 
 	// Create Time_measurement instance
 	fast::msg::migfra::Time_measurement timers(true, "timestamps");
@@ -190,29 +769,59 @@ int main(int argc, char const *argv[]) {
 	controller->init();
 	timers.tock("Start time");
 
-	// subscribe to the various topics
-	for (const std::string &mach : controller->machines) {
-		std::string topic = "fast/agent/" + mach + "/mmbwmon/response";
-		comm->add_subscription(topic);
+	FASTLIB_LOG(poncos_log, info) << "MQTT ready!";
+
+	const std::string submit_topic =
+		rack_name == "" ? "fast/poncos/submit" : "fast/poncos/racks/" + rack_name + "/submit";
+	submission_serverT submission_server(comm, job_queue, submit_topic);
+	if (accept_submissions) {
+		if (elastic_machines) submission_server.manage_machines(*controller);
+		submission_server.check_jobs([&](const jobT &job) { return sched->reject_reason(job, *controller); });
+		submission_server.start();
+		FASTLIB_LOG(poncos_log, info) << "Accepting jobs on " << submit_topic;
 	}
 
-	FASTLIB_LOG(poncos_log, info) << "MQTT ready!";
+	machine_watcherT machine_watcher(*controller, machine_filename, std::chrono::milliseconds(1000));
+	if (watch_machines) machine_watcher.start();
+
+	rack_reporterT rack_reporter(comm, *controller, job_queue, rack_name);
+	if (rack_name != "") rack_reporter.start();
 
 	timers.tick("Runtime");
 	sched->schedule(job_queue, *comm, *controller, wait_time);
 	timers.tock("Runtime");
 
+	if (accept_submissions) submission_server.stop();
+	if (rack_name != "") rack_reporter.stop();
+	if (watch_machines) machine_watcher.stop();
+
 	timers.tick("Stop time");
 	controller->dismantle();
 	timers.tock("Stop time");
 	timers.tock("Total time");
 
+	// all jobs completed, the next start is a fresh one
+	if (journal != nullptr) journal->clear();
+
 	// print timer
 	FASTLIB_LOG(poncos_log, info) << "Start time: " << timers.emit()["Start time"].as<std::string>() << " s";
 	FASTLIB_LOG(poncos_log, info) << "Runtime   : " << timers.emit()["Runtime"].as<std::string>() << " s";
 	FASTLIB_LOG(poncos_log, info) << "Stop time : " << timers.emit()["Stop time"].as<std::string>() << " s";
 	FASTLIB_LOG(poncos_log, info) << "Total time: " << timers.emit()["Total time"].as<std::string>() << " s";
 
+	if (mbm_monitor != nullptr) mbm_monitor->stop();
+	if (psi_monitor != nullptr) psi_monitor->stop();
+	if (resource_monitor != nullptr) resource_monitor->stop();
+	if (interference_model != nullptr) interference_model->save(interference_filename);
+	if (progress_monitor != nullptr) progress_monitor->stop();
+	if (metrics != nullptr) metrics->stop();
+	if (trace != nullptr) {
+		trace->stop();
+		if (trace->dropped() > 0) {
+			FASTLIB_LOG(poncos_log, warn) << trace->dropped() << " events were dropped from " << trace_path;
+		}
+	}
+
 	delete sched;
 	delete controller;
 }
@@ -0,0 +1,64 @@
+#include "poncos/progress_monitor.hpp"
+
+#include <exception>
+
+#include "poncos/poncos.hpp"
+#include "poncos/progress.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(progress_monitor_log, "progress-monitor")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(progress_monitor_log, info);
+
+progress_monitorT::progress_monitorT(std::shared_ptr<fast::MQTT_communicator> comm, std::chrono::seconds history)
+	: comm(std::move(comm)), history(history) {}
+
+void progress_monitorT::start() {
+	comm->add_subscription(progress_topic, [this](std::string message) { receive(message); }, 0);
+}
+
+void progress_monitorT::stop() { comm->remove_subscription(progress_topic); }
+
+void progress_monitorT::receive(const std::string &message) {
+	progress_msgT msg;
+	try {
+		msg.from_string(message);
+	} catch (const std::exception &e) {
+		FASTLIB_LOG(progress_monitor_log, warn) << "Ignoring malformed progress message: " << e.what();
+		return;
+	}
+
+	const auto now = clockT::now();
+	std::lock_guard<std::mutex> lock(mtx);
+
+	auto &job_samples = samples[msg.job];
+	job_samples.emplace_back(now, msg.iterations);
+	while (!job_samples.empty() && now - job_samples.front().first > history) {
+		job_samples.pop_front();
+	}
+	FASTLIB_LOG(progress_monitor_log, debug) << msg.job << ": " << msg.iterations << " iterations";
+}
+
+double progress_monitorT::throughput(const std::string &job, clockT::time_point from, clockT::time_point to) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const auto iter = samples.find(job);
+	if (iter == samples.end()) return 0;
+
+	// first and last sample within [from, to]
+	const std::pair<clockT::time_point, size_t> *first = nullptr;
+	const std::pair<clockT::time_point, size_t> *last = nullptr;
+	for (const auto &sample : iter->second) {
+		if (sample.first < from || sample.first > to) continue;
+		if (first == nullptr) first = &sample;
+		last = &sample;
+	}
+	if (first == nullptr || first == last) return 0;
+
+	const std::chrono::duration<double> elapsed = last->first - first->first;
+	return (last->second - first->second) / elapsed.count();
+}
+
+bool progress_monitorT::reports(const std::string &job) {
+	std::lock_guard<std::mutex> lock(mtx);
+	return samples.find(job) != samples.end();
+}
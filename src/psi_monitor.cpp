@@ -0,0 +1,141 @@
+#include "poncos/psi_monitor.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(psi_monitor_log, "psi-monitor")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(psi_monitor_log, info);
+
+static const std::array<std::string, 3> PSI_FILES = {{"cpu.pressure", "memory.pressure", "io.pressure"}};
+
+// returns the total stall time of the "some" line, e.g.
+// some avg10=0.00 avg60=0.00 avg300=0.00 total=12345
+static bool read_some_total(const std::string &filename, unsigned long long &total) {
+	std::ifstream file(filename);
+	if (!file.good()) return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.compare(0, 5, "some ") != 0) continue;
+
+		const auto pos = line.find("total=");
+		if (pos == std::string::npos) return false;
+		total = std::stoull(line.substr(pos + 6));
+		return true;
+	}
+	return false;
+}
+
+psi_monitorT::psi_monitorT(std::string root, std::chrono::milliseconds interval, double alpha)
+	: root(std::move(root)), interval(interval), alpha(alpha), running(false) {
+	assert(alpha > 0 && alpha <= 1);
+	assert(interval.count() > 0);
+}
+
+psi_monitorT::~psi_monitorT() { stop(); }
+
+void psi_monitorT::start() {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (running) return;
+	running = true;
+
+	sampler = std::thread([this] {
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if (!running) break;
+				sample_all();
+			}
+			std::this_thread::sleep_for(interval);
+		}
+	});
+}
+
+void psi_monitorT::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		running = false;
+	}
+	if (sampler.joinable()) sampler.join();
+}
+
+void psi_monitorT::poll() {
+	std::lock_guard<std::mutex> lock(mtx);
+	sample_all();
+}
+
+void psi_monitorT::watch(const std::string &host, const std::string &group) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const keyT key(host, group);
+	if (states.find(key) != states.end()) return;
+
+	stateT state;
+	if (sample(key, state)) states.insert({key, state});
+}
+
+pressureT psi_monitorT::pressure(const std::string &host, const std::string &group) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const auto iter = states.find(keyT(host, group));
+	if (iter == states.end()) return pressureT();
+	return iter->second.avg;
+}
+
+std::string psi_monitorT::group_path(const keyT &key) const {
+	return expand_host_path(root, key.first) + "/" + key.second;
+}
+
+void psi_monitorT::sample_all() {
+	for (auto iter = states.begin(); iter != states.end();) {
+		if (!sample(iter->first, iter->second)) {
+			FASTLIB_LOG(psi_monitor_log, debug) << "dropping removed cgroup " << iter->first.second << " on "
+												<< iter->first.first;
+			iter = states.erase(iter);
+			continue;
+		}
+		++iter;
+	}
+}
+
+bool psi_monitorT::sample(const keyT &key, stateT &state) const {
+	const auto now = clockT::now();
+	const std::string path = group_path(key);
+
+	std::array<unsigned long long, 3> totals;
+	for (size_t i = 0; i < PSI_FILES.size(); ++i) {
+		if (!read_some_total(path + "/" + PSI_FILES[i], totals[i])) return false;
+	}
+
+	if (state.initialized) {
+		const std::chrono::duration<double, std::micro> elapsed = now - state.time;
+		if (elapsed.count() <= 0) return true;
+
+		std::array<double *, 3> avgs = {{&state.avg.cpu, &state.avg.memory, &state.avg.io}};
+		for (size_t i = 0; i < totals.size(); ++i) {
+			// counters may be reset if the cgroup was recreated
+			const double stalled = totals[i] >= state.totals[i] ? totals[i] - state.totals[i] : 0;
+			const double fraction = std::min(1.0, stalled / elapsed.count());
+			*avgs[i] = alpha * fraction + (1 - alpha) * *avgs[i];
+		}
+	}
+
+	state.totals = totals;
+	state.time = now;
+	state.initialized = true;
+	return true;
+}
+
+std::ostream &operator<<(std::ostream &os, const pressureT &pressure) {
+	os << "cpu: " << pressure.cpu << "; ";
+	os << "memory: " << pressure.memory << "; ";
+	os << "io: " << pressure.io;
+
+	return os;
+}
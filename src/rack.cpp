@@ -0,0 +1,369 @@
+#include "poncos/rack.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+
+#include "poncos/poncos.hpp"
+#include "poncos/submission_server.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(rack_log, "rack")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(rack_log, info);
+
+// racks that did not report for this long are not considered by the dispatcher
+constexpr std::chrono::seconds STATUS_TIMEOUT(10);
+// racks that did not report for this long are considered dead: their pending jobs are dispatched again and their
+// running jobs are given up
+constexpr std::chrono::seconds RACK_EXPIRY(60);
+// time a rack may take to answer a submission
+constexpr std::chrono::seconds SUBMIT_TIMEOUT(10);
+// the dispatcher checks for stale reports at least this often while waiting for a rack
+constexpr std::chrono::milliseconds DISPATCH_POLL_INTERVAL(1000);
+
+static std::string rack_topic(const std::string &rack) { return "fast/poncos/racks/" + rack; }
+
+YAML::Node rack_statusT::emit() const {
+	YAML::Node node;
+	node["rack"] = rack;
+	node["machines"] = capacity.machines;
+	node["drained"] = capacity.drained;
+	node["total-cpus"] = capacity.total_cpus;
+	node["free-cpus"] = capacity.free_cpus;
+	node["free-memory"] = capacity.free_memory;
+	node["max-job-cpus"] = capacity.max_job_cpus;
+	node["max-job-memory"] = capacity.max_job_memory;
+	node["running"] = capacity.running;
+	node["started"] = capacity.started;
+	node["load"] = capacity.load;
+	node["submitted"] = submitted;
+	node["pending"] = pending;
+	node["running-jobs"] = running;
+	return node;
+}
+
+void rack_statusT::load(const YAML::Node &node) {
+	fast::load(rack, node["rack"]);
+	fast::load(capacity.machines, node["machines"]);
+	fast::load(capacity.drained, node["drained"], 0);
+	fast::load(capacity.total_cpus, node["total-cpus"]);
+	fast::load(capacity.free_cpus, node["free-cpus"]);
+	fast::load(capacity.free_memory, node["free-memory"], std::numeric_limits<size_t>::max());
+	fast::load(capacity.max_job_cpus, node["max-job-cpus"], std::numeric_limits<size_t>::max());
+	fast::load(capacity.max_job_memory, node["max-job-memory"], std::numeric_limits<size_t>::max());
+	fast::load(capacity.running, node["running"], 0);
+	fast::load(capacity.started, node["started"]);
+	fast::load(capacity.load, node["load"], 0.0);
+	fast::load(submitted, node["submitted"]);
+	fast::load(pending, node["pending"], std::vector<size_t>());
+	fast::load(running, node["running-jobs"], std::vector<size_t>());
+}
+
+rack_reporterT::rack_reporterT(std::shared_ptr<fast::MQTT_communicator> comm, const controllerT &controller,
+							   job_queueT &job_queue, std::string rack, std::chrono::milliseconds interval)
+	: comm(std::move(comm)), controller(controller), job_queue(job_queue), rack(std::move(rack)),
+	  interval(interval) {}
+
+rack_reporterT::~rack_reporterT() { stop(); }
+
+void rack_reporterT::start() {
+	assert(!running);
+	running = true;
+	reporter = std::thread([this] {
+		std::unique_lock<std::mutex> lock(mtx);
+		while (running) {
+			report();
+			cv.wait_for(lock, interval);
+		}
+	});
+}
+
+void rack_reporterT::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (!running) return;
+		running = false;
+	}
+	cv.notify_all();
+	reporter.join();
+
+	// the last report tells the dispatcher about the jobs completed since the previous one
+	report();
+}
+
+void rack_reporterT::report() {
+	rack_statusT status;
+	status.rack = rack;
+	status.capacity = controller.summary();
+	status.submitted = job_queue.unfinished(status.pending, status.running);
+	comm->send_message(status.to_string(), rack_topic(rack) + "/status", 0);
+}
+
+rack_dispatcherT::rack_dispatcherT(std::shared_ptr<fast::MQTT_communicator> comm, std::vector<std::string> names)
+	: comm(std::move(comm)) {
+	assert(!names.empty());
+	racks.resize(names.size());
+	for (size_t r = 0; r < names.size(); ++r) {
+		racks[r].name = names[r];
+	}
+}
+
+void rack_dispatcherT::dispatch(job_queueT &_job_queue) {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		job_queue = &_job_queue;
+	}
+	for (const auto &rack : racks) {
+		comm->add_subscription(rack_topic(rack.name) + "/status", [this](std::string message) { receive(message); },
+							   0);
+		comm->add_subscription(rack_topic(rack.name) + "/submit/reply");
+	}
+
+	size_t queue_id;
+	jobT job;
+	while (next_job(queue_id, job)) {
+		// racks that rejected the job
+		std::vector<size_t> refused;
+		while (true) {
+			size_t rack;
+			std::string reason;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				// reports may turn stale without a message, i.e. the predicate is re-checked periodically
+				while ((rack = select(job, refused)) == racks.size()) {
+					expire_racks();
+					reason = infeasible(job, refused);
+					if (!reason.empty()) break;
+					cv.wait_for(lock, DISPATCH_POLL_INTERVAL);
+				}
+			}
+			if (rack == racks.size()) {
+				FASTLIB_LOG(rack_log, warn) << "Dropping job " << queue_id << ": " << reason;
+				_job_queue.finished(queue_id);
+				break;
+			}
+
+			const std::string status = submit(rack, queue_id, job);
+			if (status == "pending") break;
+			if (status == "rejected") refused.push_back(rack);
+		}
+	}
+
+	for (size_t r = 0; r < racks.size(); ++r) {
+		close(r);
+		comm->remove_subscription(rack_topic(racks[r].name) + "/status");
+		comm->remove_subscription(rack_topic(racks[r].name) + "/submit/reply");
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+	job_queue = nullptr;
+}
+
+std::string rack_dispatcherT::reject_reason(const jobT &job) {
+	std::lock_guard<std::mutex> lock(mtx);
+	return infeasible(job, {});
+}
+
+bool rack_dispatcherT::next_job(size_t &queue_id, jobT &job) {
+	while (true) {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			if (!rerouted.empty()) {
+				queue_id = rerouted.front().queue_id;
+				job = rerouted.front().job;
+				rerouted.pop_front();
+				return true;
+			}
+		}
+		if (job_queue->next(queue_id, job)) return true;
+
+		// the jobs are completed once the racks stop reporting them, the jobs of dead racks are dispatched again
+		std::unique_lock<std::mutex> lock(mtx);
+		while (rerouted.empty() &&
+			   !std::all_of(racks.begin(), racks.end(), [](const rackT &rack) { return rack.jobs.empty(); })) {
+			expire_racks();
+			cv.wait_for(lock, DISPATCH_POLL_INTERVAL);
+		}
+		if (rerouted.empty()) return false;
+	}
+}
+
+void rack_dispatcherT::receive(const std::string &message) {
+	rack_statusT status;
+	try {
+		status.from_string(message);
+	} catch (const std::exception &e) {
+		FASTLIB_LOG(rack_log, warn) << "Ignoring malformed rack status: " << e.what();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto iter =
+		std::find_if(racks.begin(), racks.end(), [&status](const rackT &rack) { return rack.name == status.rack; });
+	if (iter == racks.end()) return;
+
+	rackT &rack = *iter;
+	rack.status = status;
+	rack.last_report = std::chrono::steady_clock::now();
+	rack.reported = true;
+
+	// jobs known to the rack that are neither pending nor running are completed
+	for (auto job = rack.jobs.begin(); job != rack.jobs.end();) {
+		const size_t id = job->first;
+		const bool completed = id < status.submitted &&
+							   std::find(status.pending.begin(), status.pending.end(), id) == status.pending.end() &&
+							   std::find(status.running.begin(), status.running.end(), id) == status.running.end();
+		if (!completed) {
+			++job;
+			continue;
+		}
+
+		FASTLIB_LOG(rack_log, info) << "Job " << job->second.queue_id << " completed on rack " << rack.name;
+		if (job_queue != nullptr) job_queue->finished(job->second.queue_id);
+		job = rack.jobs.erase(job);
+	}
+
+	cv.notify_all();
+}
+
+size_t rack_dispatcherT::select(const jobT &job, const std::vector<size_t> &refused) const {
+	const auto now = std::chrono::steady_clock::now();
+
+	size_t best = racks.size();
+	size_t best_free = 0;
+	for (size_t r = 0; r < racks.size(); ++r) {
+		const rackT &rack = racks[r];
+		if (!rack.open || !rack.reported || now - rack.last_report > STATUS_TIMEOUT) continue;
+		if (std::find(refused.begin(), refused.end(), r) != refused.end()) continue;
+		if (rack.status.capacity.free_memory < job.memory) continue;
+
+		const size_t free = expected_free_cpus(rack);
+		if (free < job.req_cpus()) continue;
+
+		// least loaded rack first, the one with the most free CPUs on ties
+		if (best != racks.size()) {
+			const double load = rack.status.capacity.load;
+			const double best_load = racks[best].status.capacity.load;
+			if (load > best_load || (load == best_load && free <= best_free)) continue;
+		}
+		best = r;
+		best_free = free;
+	}
+	return best;
+}
+
+std::string rack_dispatcherT::infeasible(const jobT &job, const std::vector<size_t> &refused) const {
+	bool open = false;
+	for (size_t r = 0; r < racks.size(); ++r) {
+		const rackT &rack = racks[r];
+		if (!rack.open || std::find(refused.begin(), refused.end(), r) != refused.end()) continue;
+		// the size of the largest job is unknown until the rack reported
+		if (!rack.reported) return "";
+		open = true;
+
+		const capacity_summaryT &capacity = rack.status.capacity;
+		if (job.req_cpus() <= capacity.max_job_cpus && job.memory <= capacity.max_job_memory) return "";
+	}
+	if (!open) return "no rack accepts the job";
+	return "no rack provides " + std::to_string(job.req_cpus()) + " CPUs and " + std::to_string(job.memory) +
+		   " MiB for a job";
+}
+
+void rack_dispatcherT::expire_racks() {
+	const auto now = std::chrono::steady_clock::now();
+	for (auto &rack : racks) {
+		// racks that never reported may not be up yet
+		if (rack.last_report == std::chrono::steady_clock::time_point() || now - rack.last_report <= RACK_EXPIRY) {
+			continue;
+		}
+		if (!rack.open && rack.jobs.empty()) continue;
+
+		FASTLIB_LOG(rack_log, warn) << "Rack " << rack.name << " did not report for " << RACK_EXPIRY.count()
+									<< " s, giving it up";
+		rack.open = false;
+		for (const auto &job : rack.jobs) {
+			// jobs not started by the rack as of its last report are dispatched to another rack
+			const auto &running = rack.status.running;
+			if (std::find(running.begin(), running.end(), job.first) == running.end()) {
+				FASTLIB_LOG(rack_log, info) << "Dispatching job " << job.second.queue_id << " again";
+				rerouted.push_back(job.second);
+				continue;
+			}
+
+			FASTLIB_LOG(rack_log, warn) << "Job " << job.second.queue_id << " was running on rack " << rack.name
+										<< " and is lost";
+			if (job_queue != nullptr) job_queue->finished(job.second.queue_id);
+		}
+		rack.jobs.clear();
+	}
+}
+
+size_t rack_dispatcherT::expected_free_cpus(const rackT &rack) const {
+	size_t required = 0;
+	for (const auto &job : rack.jobs) {
+		if (job.first >= rack.status.capacity.started) required += job.second.job.req_cpus();
+	}
+
+	const size_t free = rack.status.capacity.free_cpus;
+	return free > required ? free - required : 0;
+}
+
+std::string rack_dispatcherT::submit(const size_t rack, const size_t queue_id, const jobT &job) {
+	const std::string topic = rack_topic(racks[rack].name) + "/submit";
+
+	submission_requestT request;
+	request.task = "submit";
+	request.job = job;
+	request.tag = std::to_string(queue_id);
+	request.reply_topic = topic + "/reply";
+	comm->send_message(request.to_string(), topic, 2);
+
+	submission_replyT reply;
+	try {
+		// replies to requests that timed out before are skipped
+		do {
+			reply.from_string(comm->get_message(request.reply_topic, SUBMIT_TIMEOUT));
+		} while (reply.tag != request.tag);
+	} catch (const std::runtime_error &e) {
+		FASTLIB_LOG(rack_log, warn) << "Rack " << racks[rack].name << " did not accept job " << queue_id << ": "
+									<< e.what();
+		// the rack is skipped until it reports again
+		std::lock_guard<std::mutex> lock(mtx);
+		racks[rack].reported = false;
+		return "unknown";
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+	if (reply.status == "closed") {
+		FASTLIB_LOG(rack_log, warn) << "Rack " << racks[rack].name << " is closed";
+		racks[rack].open = false;
+		return reply.status;
+	}
+	if (reply.status == "rejected") {
+		FASTLIB_LOG(rack_log, warn) << "Rack " << racks[rack].name << " rejected job " << queue_id << ": "
+									<< reply.reason;
+		return reply.status;
+	}
+
+	FASTLIB_LOG(rack_log, info) << "Dispatched job " << queue_id << " to rack " << racks[rack].name << " (job "
+								<< reply.id << ")";
+	racks[rack].jobs[reply.id] = dispatched_jobT{queue_id, job};
+	return reply.status;
+}
+
+void rack_dispatcherT::close(const size_t rack) {
+	const std::string topic = rack_topic(racks[rack].name) + "/submit";
+
+	submission_requestT request;
+	request.task = "close";
+	request.reply_topic = topic + "/reply";
+	comm->send_message(request.to_string(), topic, 2);
+
+	try {
+		comm->get_message(request.reply_topic, SUBMIT_TIMEOUT);
+	} catch (const std::runtime_error &e) {
+		FASTLIB_LOG(rack_log, warn) << "Rack " << racks[rack].name << " did not confirm closing: " << e.what();
+	}
+}
@@ -0,0 +1,212 @@
+/**
+ * Decision replay
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Runs the decisions of a decision log written with --decision-log through the current multi-app scheduler and
+ * reports every decision with a different outcome, as well as the recorded and replayed decision latencies. The
+ * interference model entries stored with the decisions are used; the model passed on the command line is only used
+ * for logs recorded without them. Exits with 2 if any decision differs. Usage:
+ *
+ *   poncos_replay [--interference-model <file>] <log>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "poncos/controller_offline.hpp"
+#include "poncos/decision_log.hpp"
+#include "poncos/interference_model.hpp"
+#include "poncos/scheduler_multi_app.hpp"
+
+[[noreturn]] static void print_help(const char *argv) {
+	std::cerr << "usage: " << argv << " [--interference-model <file>] <log>\n";
+	exit(1);
+}
+
+static std::string to_flow(const YAML::Node &node) {
+	YAML::Emitter out;
+	out.SetMapFormat(YAML::Flow);
+	out.SetSeqFormat(YAML::Flow);
+	out << node;
+	return out.c_str();
+}
+
+struct replay_summaryT {
+	size_t decisions = 0;
+	size_t mismatches = 0;
+	// seconds
+	std::vector<double> recorded;
+	std::vector<double> replayed;
+};
+
+// mean, 95th percentile and maximum in ms
+static void print_latency(std::vector<double> &latency) {
+	std::sort(latency.begin(), latency.end());
+
+	double sum = 0;
+	for (const auto l : latency) sum += l;
+	const auto rank = static_cast<size_t>(std::ceil(0.95 * static_cast<double>(latency.size())));
+
+	std::cout << std::setw(10) << sum / latency.size() * 1e3 << std::setw(10)
+			  << latency[rank == 0 ? 0 : rank - 1] * 1e3 << std::setw(10) << latency.back() * 1e3;
+}
+
+class replayerT {
+  public:
+	replayerT(std::shared_ptr<interference_modelT> interference_model)
+		: interference_model(std::move(interference_model)) {}
+
+	void session(const YAML::Node &record) {
+		// the controller refers to the system configuration
+		scheduler.reset();
+		controller.reset();
+
+		system_config = record["system-config"].as<system_configT>();
+		controller.reset(new offline_controllerT(system_config, record["capabilities"].as<controller_capabilitiesT>()));
+		scheduler.reset(new multi_app_sched(system_config));
+		if (interference_model != nullptr) scheduler->use_interference_model(interference_model);
+	}
+
+	void placement(const size_t index, const YAML::Node &record) {
+		scheduler->restore_inputs(*controller, record);
+		const jobT job = record["job"].as<jobT>();
+
+		YAML::Node replayed;
+		const auto start = std::chrono::steady_clock::now();
+		if (record["cores"]) {
+			const auto packing = scheduler->pack_job(job, *controller);
+			replayed["config"] = controllerT::execute_config{packing.first};
+			replayed["cores"] = packing.second;
+		} else {
+			replayed["config"] = scheduler->select_slots(job, *controller);
+		}
+		const double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		compare(index, record, replayed, {"config", "cores"}, latency);
+	}
+
+	void co_scheduling(const size_t index, const YAML::Node &record) {
+		scheduler->restore_inputs(*controller, record);
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto decision = scheduler->decide_overload(*controller, record["job-id"].as<size_t>(),
+														 record["config"].as<controllerT::execute_config>(),
+														 record["slowed"].as<std::vector<size_t>>());
+		const double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		YAML::Node replayed;
+		replayed["result"] = multi_app_sched::name_of(decision.result);
+		replayed["marked"] = decision.marked_machines;
+		replayed["candidates"] = decision.swap_candidates;
+		replayed["new-config"] = decision.new_config;
+		compare(index, record, replayed, {"result", "marked", "candidates", "new-config"}, latency);
+	}
+
+	bool in_session() const { return controller != nullptr; }
+	std::map<std::string, replay_summaryT> &summary() { return summaries; }
+
+  private:
+	void compare(const size_t index, const YAML::Node &record, const YAML::Node &replayed,
+				 const std::vector<std::string> &fields, const double latency) {
+		const std::string type = record["type"].as<std::string>();
+		replay_summaryT &summary = summaries[type];
+		++summary.decisions;
+		summary.recorded.push_back(record["latency"].as<double>());
+		summary.replayed.push_back(latency);
+
+		bool match = true;
+		for (const auto &field : fields) {
+			if (!record[field] && !replayed[field]) continue;
+			const std::string expected = record[field] ? to_flow(record[field]) : "~";
+			const std::string actual = replayed[field] ? to_flow(replayed[field]) : "~";
+			if (expected == actual) continue;
+
+			if (match) {
+				std::cout << "record " << index << " (" << type;
+				if (record["job-id"]) std::cout << " of job-id " << record["job-id"].as<size_t>();
+				if (record["job"]) std::cout << " of " << to_flow(record["job"]);
+				std::cout << "):\n";
+			}
+			std::cout << "  " << field << ": recorded " << expected << ", replayed " << actual << "\n";
+			match = false;
+		}
+		if (!match) ++summary.mismatches;
+	}
+
+  private:
+	std::shared_ptr<interference_modelT> interference_model;
+
+	system_configT system_config;
+	std::unique_ptr<offline_controllerT> controller;
+	std::unique_ptr<multi_app_sched> scheduler;
+
+	std::map<std::string, replay_summaryT> summaries;
+};
+
+int main(int argc, char const *argv[]) {
+	std::string model_filename;
+	std::string filename;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--interference-model") == 0 && i + 1 < argc) {
+			model_filename = argv[++i];
+		} else if (filename.empty()) {
+			filename = argv[i];
+		} else {
+			print_help(argv[0]);
+		}
+	}
+	if (filename.empty()) print_help(argv[0]);
+
+	std::shared_ptr<interference_modelT> interference_model;
+	if (!model_filename.empty()) interference_model = std::make_shared<interference_modelT>(model_filename);
+
+	const std::vector<YAML::Node> records = decision_logT::read(filename);
+	replayerT replayer(interference_model);
+	for (size_t i = 0; i < records.size(); ++i) {
+		const YAML::Node &record = records[i];
+		const std::string type = record["type"].as<std::string>();
+		if (type == "session") {
+			replayer.session(record);
+			continue;
+		}
+		if (!replayer.in_session()) {
+			std::cerr << "record " << i << " precedes the first session, skipped\n";
+			continue;
+		}
+
+		if (type == "placement") {
+			replayer.placement(i, record);
+		} else if (type == "co-scheduling") {
+			replayer.co_scheduling(i, record);
+		}
+	}
+
+	size_t mismatches = 0;
+	std::cout << "\n" << std::left << std::setw(16) << "decision" << std::setw(11) << "replayed" << std::setw(12)
+			  << "mismatches"
+			  << "latency in ms (mean, p95, max), recorded / replayed\n";
+	for (auto &summary : replayer.summary()) {
+		std::cout << std::setw(16) << summary.first << std::setw(11) << summary.second.decisions << std::setw(12)
+				  << summary.second.mismatches;
+		print_latency(summary.second.recorded);
+		std::cout << " / ";
+		print_latency(summary.second.replayed);
+		std::cout << "\n";
+		mismatches += summary.second.mismatches;
+	}
+
+	return mismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,137 @@
+#include "poncos/resctrl.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(resctrl_log, "resctrl")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(resctrl_log, info);
+
+resctrlT::resctrlT(std::string root) : root(std::move(root)) {}
+
+std::string resctrlT::group_path(const std::string &host, const std::string &name) const {
+	std::string path = expand_host_path(root, host);
+	if (!name.empty()) path += "/" + name;
+	return path;
+}
+
+void resctrlT::create_group(const std::string &host, const std::string &name, const std::string &schemata) const {
+	const std::string path = group_path(host, name);
+	FASTLIB_LOG(resctrl_log, debug) << "creating resctrl group " << path;
+
+	const int ret = mkdir(path.c_str(), 0755);
+	assert(ret == 0 || errno == EEXIST);
+	(void)ret;
+
+	write_schemata(host, name, schemata);
+}
+
+void resctrlT::remove_group(const std::string &host, const std::string &name) const {
+	const std::string path = group_path(host, name);
+	FASTLIB_LOG(resctrl_log, debug) << "removing resctrl group " << path;
+
+	// the kernel removes the control files together with the group, a mock tree does not
+	for (const char *file : {"schemata", "tasks"}) {
+		unlink((path + "/" + file).c_str());
+	}
+	const int ret = rmdir(path.c_str());
+	assert(ret == 0 || errno == ENOENT);
+	(void)ret;
+}
+
+void resctrlT::write_schemata(const std::string &host, const std::string &name, const std::string &schemata) const {
+	if (schemata.empty()) return;
+
+	std::ofstream file(group_path(host, name) + "/schemata");
+	assert(file.is_open());
+	file << schemata;
+	file.close();
+	assert(!file.fail());
+}
+
+bool resctrlT::group_exists(const std::string &host, const std::string &name) const {
+	struct stat info;
+	return stat(group_path(host, name).c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// counters are located at <group>/mon_data/mon_L3_<domain>/<event>
+unsigned long long resctrlT::mbm_bytes(const std::string &host, const std::string &name,
+									   const std::string &event) const {
+	const std::string mon_path = group_path(host, name) + "/mon_data";
+
+	DIR *dir = opendir(mon_path.c_str());
+	assert(dir != nullptr);
+
+	unsigned long long bytes = 0;
+	while (const dirent *entry = readdir(dir)) {
+		const std::string domain(entry->d_name);
+		if (domain.compare(0, 7, "mon_L3_") != 0) continue;
+
+		std::ifstream file(mon_path + "/" + domain + "/" + event);
+		assert(file.good());
+		unsigned long long domain_bytes = 0;
+		file >> domain_bytes;
+		bytes += domain_bytes;
+	}
+	closedir(dir);
+
+	return bytes;
+}
+
+std::string resctrlT::generate_schemata(const std::string &host, const unsigned int mba,
+									   const std::string &l3_mask) const {
+	assert(mba <= 100);
+	std::string schemata;
+
+	if (!l3_mask.empty()) {
+		std::string line = "L3:";
+		for (const auto &id : domain_ids(host, "L3")) {
+			line += id + "=" + l3_mask + ";";
+		}
+		line.pop_back();
+		schemata += line + "\n";
+	}
+
+	if (mba != 0) {
+		std::string line = "MB:";
+		for (const auto &id : domain_ids(host, "MB")) {
+			line += id + "=" + std::to_string(mba) + ";";
+		}
+		line.pop_back();
+		schemata += line + "\n";
+	}
+
+	return schemata;
+}
+
+// the root schemata contains one line per resource, e.g. "MB:0=100;1=100"
+std::vector<std::string> resctrlT::domain_ids(const std::string &host, const std::string &resource) const {
+	std::ifstream file(group_path(host, "") + "/schemata");
+	assert(file.good());
+
+	std::vector<std::string> ids;
+	std::string line;
+	while (std::getline(file, line)) {
+		// strip leading whitespace used by the kernel for alignment
+		line.erase(0, line.find_first_not_of(" \t"));
+		if (line.compare(0, resource.size() + 1, resource + ":") != 0) continue;
+
+		std::stringstream domains(line.substr(resource.size() + 1));
+		std::string domain;
+		while (std::getline(domains, domain, ';')) {
+			ids.emplace_back(domain.substr(0, domain.find('=')));
+		}
+	}
+	assert(!ids.empty());
+
+	return ids;
+}
@@ -0,0 +1,233 @@
+#include "poncos/resource_monitor.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(resource_monitor_log, "resource-monitor")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(resource_monitor_log, info);
+
+resource_vectorT &resource_vectorT::operator+=(const resource_vectorT &other) {
+	membw += other.membw;
+	net += other.net;
+	io += other.io;
+	return *this;
+}
+
+resource_vectorT &resource_vectorT::operator-=(const resource_vectorT &other) {
+	membw -= other.membw;
+	net -= other.net;
+	io -= other.io;
+	return *this;
+}
+
+resource_vectorT operator+(resource_vectorT lhs, const resource_vectorT &rhs) { return lhs += rhs; }
+
+resource_vectorT operator*(resource_vectorT lhs, const double factor) {
+	lhs.membw *= factor;
+	lhs.net *= factor;
+	lhs.io *= factor;
+	return lhs;
+}
+
+std::ostream &operator<<(std::ostream &os, const resource_vectorT &resources) {
+	os << "membw: " << resources.membw << "; ";
+	os << "net: " << resources.net << "; ";
+	os << "io: " << resources.io;
+
+	return os;
+}
+
+bool exceeds(const resource_vectorT &usage, const resource_vectorT &limit) {
+	if (limit.membw > 0 && usage.membw > limit.membw) return true;
+	if (limit.net > 0 && usage.net > limit.net) return true;
+	if (limit.io > 0 && usage.io > limit.io) return true;
+	return false;
+}
+
+double dominant_share(const resource_vectorT &usage, const resource_vectorT &capacity) {
+	double share = 0;
+	if (capacity.membw > 0) share = std::max(share, usage.membw / capacity.membw);
+	if (capacity.net > 0) share = std::max(share, usage.net / capacity.net);
+	if (capacity.io > 0) share = std::max(share, usage.io / capacity.io);
+	return share;
+}
+
+// returns the received and transmitted bytes of all interfaces but loopback, e.g.
+//   eth0: 5678 12 0 0 0 0 0 0 91011 34 0 0 0 0 0 0
+static bool read_net_bytes(const std::string &filename, unsigned long long &bytes) {
+	std::ifstream file(filename);
+	if (!file.good()) return false;
+
+	bytes = 0;
+	std::string line;
+	while (std::getline(file, line)) {
+		const auto pos = line.find(':');
+		if (pos == std::string::npos) continue;
+
+		std::string iface = line.substr(0, pos);
+		iface.erase(0, iface.find_first_not_of(' '));
+		if (iface == "lo") continue;
+
+		std::stringstream fields(line.substr(pos + 1));
+		std::vector<unsigned long long> values;
+		unsigned long long value;
+		while (fields >> value) {
+			values.push_back(value);
+		}
+		if (values.size() < 9) return false;
+		bytes += values[0] + values[8];
+	}
+	return true;
+}
+
+// returns the read and written bytes of all devices of io.stat, e.g.
+//   8:0 rbytes=1459200 wbytes=314773504 rios=192 wios=353 dbytes=0 dios=0
+static bool read_io_bytes(const std::string &filename, unsigned long long &bytes) {
+	std::ifstream file(filename);
+	if (!file.good()) return false;
+
+	bytes = 0;
+	std::string token;
+	while (file >> token) {
+		if (token.compare(0, 7, "rbytes=") == 0) bytes += std::stoull(token.substr(7));
+		if (token.compare(0, 7, "wbytes=") == 0) bytes += std::stoull(token.substr(7));
+	}
+	return true;
+}
+
+resource_monitorT::resource_monitorT(std::string cgroup_root, std::string proc_root,
+									 std::chrono::milliseconds interval, double alpha)
+	: cgroup_root(std::move(cgroup_root)), proc_root(std::move(proc_root)), interval(interval), alpha(alpha),
+	  running(false) {
+	assert(alpha > 0 && alpha <= 1);
+	assert(interval.count() > 0);
+}
+
+resource_monitorT::~resource_monitorT() { stop(); }
+
+void resource_monitorT::start() {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (running) return;
+	running = true;
+
+	sampler = std::thread([this] {
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if (!running) break;
+				sample_all();
+			}
+			std::this_thread::sleep_for(interval);
+		}
+	});
+}
+
+void resource_monitorT::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		running = false;
+	}
+	if (sampler.joinable()) sampler.join();
+}
+
+void resource_monitorT::watch(const std::string &host, const std::string &group) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	if (hosts.find(host) == hosts.end()) {
+		counterT counter;
+		if (sample_net(host, counter)) {
+			hosts.insert({host, counter});
+		} else {
+			FASTLIB_LOG(resource_monitor_log, warn) << "cannot read the NIC statistics of " << host;
+		}
+	}
+
+	const keyT key(host, group);
+	if (groups.find(key) != groups.end()) return;
+
+	counterT counter;
+	if (sample_io(key, counter)) groups.insert({key, counter});
+}
+
+double resource_monitorT::net(const std::string &host) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const auto iter = hosts.find(host);
+	if (iter == hosts.end()) return 0;
+	return iter->second.rate;
+}
+
+double resource_monitorT::io(const std::string &host, const std::string &group) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	const auto iter = groups.find(keyT(host, group));
+	if (iter == groups.end()) return 0;
+	return iter->second.rate;
+}
+
+size_t resource_monitorT::memory(const std::string &host, const std::string &group) const {
+	const std::string path = expand_host_path(cgroup_root, host) + "/" + group;
+	for (const char *file : {"/memory.peak", "/memory.current"}) {
+		std::ifstream stream(path + file);
+		unsigned long long bytes;
+		if (stream >> bytes) return static_cast<size_t>(bytes >> 20);
+	}
+	return 0;
+}
+
+void resource_monitorT::sample_all() {
+	for (auto &host : hosts) {
+		sample_net(host.first, host.second);
+	}
+
+	for (auto iter = groups.begin(); iter != groups.end();) {
+		if (!sample_io(iter->first, iter->second)) {
+			FASTLIB_LOG(resource_monitor_log, debug) << "dropping removed cgroup " << iter->first.second << " on "
+													 << iter->first.first;
+			iter = groups.erase(iter);
+			continue;
+		}
+		++iter;
+	}
+}
+
+bool resource_monitorT::sample_net(const std::string &host, counterT &counter) const {
+	unsigned long long bytes;
+	if (!read_net_bytes(expand_host_path(proc_root, host) + "/net/dev", bytes)) return false;
+
+	update(counter, bytes);
+	return true;
+}
+
+bool resource_monitorT::sample_io(const keyT &key, counterT &counter) const {
+	unsigned long long bytes;
+	if (!read_io_bytes(expand_host_path(cgroup_root, key.first) + "/" + key.second + "/io.stat", bytes)) {
+		return false;
+	}
+
+	update(counter, bytes);
+	return true;
+}
+
+void resource_monitorT::update(counterT &counter, const unsigned long long bytes) const {
+	const auto now = clockT::now();
+
+	if (counter.initialized) {
+		const std::chrono::duration<double> elapsed = now - counter.time;
+		if (elapsed.count() <= 0) return;
+
+		// counters may be reset if the cgroup was recreated or an interface removed
+		const double transferred = bytes >= counter.bytes ? bytes - counter.bytes : 0;
+		counter.rate = alpha * (transferred / elapsed.count() / 1e9) + (1 - alpha) * counter.rate;
+	}
+
+	counter.bytes = bytes;
+	counter.time = now;
+	counter.initialized = true;
+}
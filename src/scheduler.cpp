@@ -1,5 +1,9 @@
 #include "poncos/scheduler.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
 #include <fast-lib/message/agent/mmbwmon/reply.hpp>
 #include <fast-lib/message/agent/mmbwmon/request.hpp>
 
@@ -7,20 +11,62 @@
 FASTLIB_LOG_INIT(scheduler_log, "scheduler")
 FASTLIB_LOG_SET_LEVEL_GLOBAL(scheduler_log, info);
 
-schedulerT::schedulerT(const system_configT &system_config) : system_config(system_config) {}
+constexpr double schedulerT::DEFAULT_MEMBW_TH;
+
+// highest predicted slowdown of a pair of jobs we accept to share nodes
+constexpr double MAX_PAIR_SLOWDOWN = 1.2;
+
+// throughput a co-runner may lose once a job is started before we consider the pairing harmful
+constexpr double MAX_PROGRESS_LOSS = 0.2;
+// time span used to determine the throughput of a co-runner before a job is started
+constexpr std::chrono::seconds PROGRESS_WINDOW(60);
+
+schedulerT::schedulerT(const system_configT &system_config)
+	: system_config(system_config), membw_th(DEFAULT_MEMBW_TH) {}
 schedulerT::~schedulerT() = default;
 
-std::vector<double> schedulerT::run_distgen(fast::MQTT_communicator &comm, const controllerT &controller,
-											const size_t job_id) {
+bool schedulerT::next_job(job_queueT &job_queue, controllerT &controller, size_t &id, jobT &job) const {
+	while (true) {
+		// completing jobs must be able to update the controller while we wait
+		if (!job_queue.ready()) controller.unlock();
+		if (!job_queue.next(id, job)) return false;
+
+		// the machines may have changed since the job was submitted
+		const std::string reason = reject_reason(job, controller);
+		if (reason.empty()) return true;
+
+		FASTLIB_LOG(scheduler_log, warn) << "Dropping job " << id << ": " << reason;
+		controller.reject();
+		job_queue.finished(id);
+	}
+}
+
+std::string schedulerT::reject_reason(const jobT &job, const controllerT &controller) const {
+	const capacity_summaryT summary = controller.summary();
+	if (job.nprocs == 0 || job.threads_per_proc == 0) return "no processes or threads requested";
+	if (job.req_cpus() > summary.max_job_cpus) {
+		return std::to_string(job.req_cpus()) + " CPUs requested, one slot per machine provides " +
+			   std::to_string(summary.max_job_cpus);
+	}
+	if (job.memory > summary.max_job_memory) {
+		return std::to_string(job.memory) + " MiB requested, the largest machine provides " +
+			   std::to_string(summary.max_job_memory);
+	}
+	return "";
+}
+
+std::vector<double> schedulerT::run_distgen(fast::MQTT_communicator &comm, controllerT &controller,
+											const size_t job_id, std::vector<bool> &answered) {
 	const std::vector<std::string> &machines = controller.machines;
 	const controllerT::execute_config &config = controller.generate_opposing_config(job_id);
 	assert(!config.empty());
 	// ask for measurements
+	std::vector<std::string> requests;
 	{
 		for (const auto &c : config) {
 			fast::msg::agent::mmbwmon::request m;
 
-			const auto &slot_conf = controller.system_config[c.second];
+			const auto &slot_conf = controller.node_slots[c.first][c.second];
 
 			// TODO check if we can use the same type
 			m.cores.resize(slot_conf.cpus.size());
@@ -31,20 +77,34 @@ std::vector<double> schedulerT::run_distgen(fast::MQTT_communicator &comm, const
 			const std::string topic = "fast/agent/" + machines[c.first] + "/mmbwmon/request";
 			FASTLIB_LOG(scheduler_log, debug) << "sending message \n topic: " << topic << "\n message:\n"
 											  << m.to_string();
-			comm.send_message(m.to_string(), topic);
+			requests.push_back(m.to_string());
+			if (!controller.drained[c.first]) comm.send_message(requests.back(), topic);
 		}
 	}
 
 	std::vector<double> ret;
 	ret.reserve(config.size());
+	answered.assign(config.size(), true);
 
 	// wait for results
 	{
-		for (const auto &c : config) {
+		for (size_t i = 0; i < config.size(); ++i) {
+			const auto &c = config[i];
 			fast::msg::agent::mmbwmon::reply m;
 			const std::string topic = "fast/agent/" + machines[c.first] + "/mmbwmon/response";
 			FASTLIB_LOG(scheduler_log, debug) << "Waiting on topic: " << topic << " ... ";
-			m.from_string(comm.get_message(topic));
+
+			// measuring is idempotent; without reply the node counts as saturated
+			std::string reply;
+			const auto resend = [&] {
+				comm.send_message(requests[i], "fast/agent/" + machines[c.first] + "/mmbwmon/request");
+			};
+			if (!controller.await_agent(c.first, topic, reply, resend)) {
+				ret.push_back(0);
+				answered[i] = false;
+				continue;
+			}
+			m.from_string(reply);
 			FASTLIB_LOG(scheduler_log, debug) << "Message received!";
 
 			ret.push_back(m.result);
@@ -53,3 +113,275 @@ std::vector<double> schedulerT::run_distgen(fast::MQTT_communicator &comm, const
 
 	return ret;
 }
+
+std::vector<double> schedulerT::run_mbm(const controllerT &controller, const size_t job_id) {
+	assert(mbm_monitor != nullptr);
+	const controllerT::execute_config &config = controller.id_to_config[job_id];
+	const std::string group = controller.cmd_name_from_id(job_id);
+
+	// a job has one resctrl group per host, i.e. the bandwidth is split evenly across its slots on a host
+	std::unordered_map<size_t, size_t> slots_per_host;
+	for (const auto &c : config) {
+		++slots_per_host[c.first];
+	}
+
+	std::unordered_map<size_t, double> util_per_host;
+	for (const auto &sph : slots_per_host) {
+		const std::string &host = controller.machines[sph.first];
+		// the calibrated capacity of the node takes precedence over the global peak bandwidth
+		const double capacity = controller.membw_capacity[sph.first];
+		util_per_host[sph.first] = capacity > 0 ? mbm_monitor->bandwidth(host, group) / (capacity * 1e9)
+												: mbm_monitor->utilization(host, group);
+		FASTLIB_LOG(scheduler_log, debug) << "MBM utilization of " << group << " on " << host << ": "
+										  << util_per_host[sph.first];
+	}
+
+	std::vector<double> ret;
+	ret.reserve(config.size());
+	for (const auto &c : config) {
+		ret.push_back(1 - util_per_host[c.first] / slots_per_host[c.first]);
+	}
+
+	return ret;
+}
+
+std::vector<double> schedulerT::measure_membw(fast::MQTT_communicator &comm, controllerT &controller,
+											  const size_t job_id) {
+	controller.record_event(event_typeT::measurement_started, job_id);
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<double> ret;
+	std::vector<bool> answered;
+	if (mbm_monitor != nullptr) {
+		// MBM measures passively, no need to stop anything
+		ret = run_mbm(controller, job_id);
+		answered.assign(ret.size(), true);
+	} else {
+		// distgen measures the remaining bandwidth, we must stop the opposing jobs
+		controller.freeze_opposing(job_id);
+		ret = run_distgen(comm, controller, job_id, answered);
+		controller.thaw_opposing(job_id);
+	}
+
+	controller.record_event(event_typeT::measurement_finished, job_id);
+	if (metrics != nullptr) metrics->add(counterT::measurements);
+	if (history != nullptr) {
+		const std::string application = interference_modelT::class_of(controller.id_to_job[job_id]);
+		const auto &config = controller.id_to_config[job_id];
+		for (size_t i = 0; i < ret.size(); ++i) {
+			// the saturation assumed for a timed out node is no measurement
+			if (!answered[i]) continue;
+			const size_t machine = config[i].first;
+			const double utilization = 1 - ret[i];
+			history->record(controller.machines[machine], config[i].second, job_id, application, utilization,
+							utilization * membw_capacity_of(controller, machine));
+		}
+	}
+	observe_latency(histogramT::measurement, start);
+	return ret;
+}
+
+void schedulerT::observe_latency(const histogramT histogram, const std::chrono::steady_clock::time_point &start) const {
+	if (metrics == nullptr) return;
+	metrics->observe(histogram, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+double schedulerT::predict_utilization(const jobT &job) const {
+	if (history == nullptr) return 0;
+
+	membw_queryT query;
+	query.application = interference_modelT::class_of(job);
+	return history->percentile(query, 0.95);
+}
+
+double schedulerT::membw_capacity_of(const controllerT &controller, const size_t machine) const {
+	const double capacity = controller.membw_capacity[machine];
+	return capacity > 0 ? capacity : 1.0;
+}
+
+void schedulerT::watch_pressure(const controllerT &controller, const size_t job_id) {
+	if (psi_monitor == nullptr) return;
+
+	const std::string group = controller.cmd_name_from_id(job_id);
+	for (const auto &c : controller.id_to_config[job_id]) {
+		psi_monitor->watch(controller.machines[c.first], group);
+	}
+}
+
+pressureT schedulerT::pressure_of_node(const controllerT &controller, const size_t machine) const {
+	pressureT ret;
+	if (psi_monitor == nullptr) return ret;
+
+	for (size_t s = 0; s < controller.machine_usage[machine].size(); ++s) {
+		for (const auto id : controller.domains_on({machine, s})) {
+			const pressureT p =
+				psi_monitor->pressure(controller.machines[machine], controller.cmd_name_from_id(id));
+			ret.cpu = std::max(ret.cpu, p.cpu);
+			ret.memory = std::max(ret.memory, p.memory);
+			ret.io = std::max(ret.io, p.io);
+		}
+	}
+
+	return ret;
+}
+
+void schedulerT::watch_resources(const controllerT &controller, const size_t job_id) {
+	if (resource_monitor == nullptr) return;
+
+	const std::string group = controller.cmd_name_from_id(job_id);
+	for (const auto &c : controller.id_to_config[job_id]) {
+		resource_monitor->watch(controller.machines[c.first], group);
+	}
+}
+
+resource_vectorT schedulerT::sample_resources(const controllerT &controller, const size_t job_id,
+											  const size_t machine) const {
+	resource_vectorT ret;
+	if (resource_monitor == nullptr) return ret;
+
+	const std::string &host = controller.machines[machine];
+	ret.net = resource_monitor->net(host);
+	ret.io = resource_monitor->io(host, controller.cmd_name_from_id(job_id));
+	return ret;
+}
+
+void schedulerT::observe_memory(controllerT &controller, const size_t job_id) const {
+	if (resource_monitor == nullptr) return;
+
+	const std::string group = controller.cmd_name_from_id(job_id);
+	size_t footprint = 0;
+	for (const auto &c : controller.id_to_config[job_id]) {
+		footprint = std::max(footprint, resource_monitor->memory(controller.machines[c.first], group));
+	}
+
+	const size_t required = controller.id_to_job[job_id].memory;
+	if (required > 0 && footprint > required) {
+		FASTLIB_LOG(scheduler_log, warn) << ">> \t job-#" << job_id << " uses " << footprint << " MiB per node, "
+										 << required << " MiB were requested";
+	}
+	controller.set_memory_footprint(job_id, footprint);
+}
+
+resource_vectorT schedulerT::capacity_of(const controllerT &controller, const size_t machine) const {
+	resource_vectorT ret;
+	ret.membw = membw_capacity_of(controller, machine);
+	ret.net = controller.net_capacity[machine];
+	ret.io = controller.io_capacity[machine];
+	return ret;
+}
+
+double schedulerT::membw_threshold() const {
+	return threshold_tuner != nullptr ? threshold_tuner->threshold() : membw_th;
+}
+
+void schedulerT::observe_job(const size_t job_id) {
+	if (threshold_tuner == nullptr && interference_model == nullptr) return;
+	observations[job_id].start = std::chrono::steady_clock::now();
+}
+
+void schedulerT::observe_utilization(const size_t job_id, const double utilization) {
+	auto iter = observations.find(job_id);
+	if (iter == observations.end()) return;
+	iter->second.utilization = std::max(iter->second.utilization, utilization);
+}
+
+void schedulerT::observe_partner(const size_t job_id, const jobT &partner) {
+	auto iter = observations.find(job_id);
+	if (iter == observations.end()) return;
+
+	const std::string partner_class = interference_modelT::class_of(partner);
+	auto &partners = iter->second.partners;
+	if (std::find(partners.begin(), partners.end(), partner_class) == partners.end()) {
+		partners.push_back(partner_class);
+	}
+}
+
+void schedulerT::discard_observation(const size_t job_id) {
+	auto iter = observations.find(job_id);
+	if (iter == observations.end()) return;
+	iter->second.valid = false;
+}
+
+void schedulerT::record_runtime(const controllerT &controller, const size_t job_id) {
+	auto iter = observations.find(job_id);
+	if (iter == observations.end()) return;
+
+	if (iter->second.valid) {
+		const jobT &job = controller.id_to_job[job_id];
+		const std::chrono::duration<double> runtime = std::chrono::steady_clock::now() - iter->second.start;
+		if (threshold_tuner != nullptr) threshold_tuner->record(job.command, iter->second.utilization, runtime);
+
+		// runs with more than one partner cannot be attributed to a pair
+		const auto &partners = iter->second.partners;
+		if (interference_model != nullptr && partners.size() <= 1) {
+			interference_model->record(interference_modelT::class_of(job), partners.empty() ? "" : partners.front(),
+									   runtime.count());
+		}
+	}
+	observations.erase(iter);
+}
+
+double schedulerT::predict_slowdown(const jobT &a, const jobT &b) const {
+	if (interference_model == nullptr) return 0;
+
+	const std::string class_a = interference_modelT::class_of(a);
+	const std::string class_b = interference_modelT::class_of(b);
+	const double slowdown_a = interference_model->slowdown(class_a, class_b);
+	const double slowdown_b = interference_model->slowdown(class_b, class_a);
+	if (slowdown_a == 0 || slowdown_b == 0) return 0;
+
+	return std::max(slowdown_a, slowdown_b);
+}
+
+schedulerT::pairingT schedulerT::predict_pairing(const jobT &a, const jobT &b) const {
+	const double slowdown = predict_slowdown(a, b);
+	if (slowdown == 0) return pairingT::unknown;
+
+	return slowdown > MAX_PAIR_SLOWDOWN ? pairingT::refused : pairingT::acceptable;
+}
+
+std::unordered_map<size_t, double> schedulerT::corunner_progress(const controllerT &controller,
+																 const size_t job_id) const {
+	std::unordered_map<size_t, double> ret;
+	if (progress_monitor == nullptr) return ret;
+
+	const auto now = std::chrono::steady_clock::now();
+	for (const auto &c : controller.id_to_config[job_id]) {
+		for (size_t s = 0; s < controller.machine_usage[c.first].size(); ++s) {
+			for (const auto id : controller.domains_on({c.first, s})) {
+				if (id == job_id || ret.find(id) != ret.end()) continue;
+
+				const double rate =
+					progress_monitor->throughput(controller.cmd_name_from_id(id), now - PROGRESS_WINDOW, now);
+				if (rate > 0) ret[id] = rate;
+			}
+		}
+	}
+	return ret;
+}
+
+std::vector<size_t> schedulerT::progress_loss(const controllerT &controller, const size_t job_id,
+											  const std::unordered_map<size_t, double> &before,
+											  const std::chrono::steady_clock::time_point &started) const {
+	std::vector<size_t> ret;
+	if (progress_monitor == nullptr) return ret;
+
+	for (const auto &c : controller.id_to_config[job_id]) {
+		for (size_t s = 0; s < controller.machine_usage[c.first].size(); ++s) {
+			for (const auto id : controller.domains_on({c.first, s})) {
+				const auto iter = before.find(id);
+				if (iter == before.end()) continue;
+
+				// the co-runner progressed before (see corunner_progress()), no progress since is the worst loss
+				const double rate = progress_monitor->throughput(controller.cmd_name_from_id(id), started);
+				if (rate >= iter->second * (1 - MAX_PROGRESS_LOSS)) continue;
+
+				FASTLIB_LOG(scheduler_log, info) << "job-#" << id << " slowed down from " << iter->second << " to "
+												 << rate << " iterations/s on " << controller.machines[c.first]
+												 << " by job-#" << job_id;
+				if (std::find(ret.begin(), ret.end(), c.first) == ret.end()) ret.push_back(c.first);
+			}
+		}
+	}
+	return ret;
+}
@@ -4,7 +4,11 @@
 #include <cassert>
 #include <chrono>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <numeric>
+#include <set>
+#include <thread>
 
 #include "poncos/controller.hpp"
 #include "poncos/job.hpp"
@@ -14,69 +18,159 @@
 FASTLIB_LOG_INIT(scheduler_multi_app_log, "multi-app scheduler")
 FASTLIB_LOG_SET_LEVEL_GLOBAL(scheduler_multi_app_log, info);
 
-// per machine threshold for the membw utilization
-// TODO make it controllable via command line parameter
-constexpr double PER_MACHINE_TH = 0.9;
+// stall fraction of any PSI resource we consider a node to be contended
+constexpr double PSI_TH = 0.1;
+
+// a job must use at least this many times less membw per CPU than its co-runner to receive CPUs of it
+constexpr double RESIZE_RATIO = 2.0;
+// fraction of its original CPUs a job keeps at least when its slot shrinks
+constexpr double MIN_SLOT_FRACTION = 0.5;
+
+// lowest memory bandwidth allocation (in percent) we are willing to throttle a job to
+constexpr unsigned int MIN_MBA = 10;
+
+// slowdown assumed for pairings without history when ordering the nodes, i.e. unknown pairings are tried
+// after pairings predicted to slow down the jobs by less
+constexpr double UNKNOWN_PAIR_SLOWDOWN = 1.1;
+
+// weight of the node's dominant share compared to the unused CPUs of a slot when packing small jobs
+constexpr double PACKING_LOAD_WEIGHT = 1.0;
 
 multi_app_sched::multi_app_sched(const system_configT &system_config) : schedulerT(system_config) {}
 
-double multi_app_sched::membw_util_of_node(const size_t &idx) const {
-	assert(idx < membw_util.size());
+resource_vectorT multi_app_sched::util_of_node(const size_t &idx) const {
+	assert(idx < util.size());
 
-	double total_membw_util = 0;
+	resource_vectorT total_util;
 	for (size_t slot = 0; slot < system_config.slots.size(); ++slot) {
-		total_membw_util += membw_util[idx][slot];
+		total_util += util[idx][slot];
 	}
 
-	return total_membw_util;
+	return total_util;
+}
+
+resource_vectorT multi_app_sched::threshold_of_node(const size_t &idx) const {
+	assert(idx < capacity.size());
+	return capacity[idx] * membw_threshold();
 }
 
-std::vector<size_t> multi_app_sched::sort_machines_by_membw_util(const std::vector<size_t> &machine_idxs,
-																 const bool reverse) const {
-	assert(machine_idxs.size() <= membw_util.size());
+std::vector<size_t> multi_app_sched::sort_machines_by_load(const std::vector<size_t> &machine_idxs,
+														   const bool reverse) const {
+	assert(machine_idxs.size() <= util.size());
 
-	// determine membw_util per node
-	std::vector<double> total_membw_util;
-	total_membw_util.reserve(membw_util.size());
-	for (size_t idx = 0; idx < membw_util.size(); ++idx) {
-		total_membw_util.emplace_back(membw_util_of_node(idx));
+	// determine the dominant share per node
+	std::vector<double> load;
+	load.reserve(util.size());
+	for (size_t idx = 0; idx < util.size(); ++idx) {
+		load.emplace_back(dominant_share(util_of_node(idx), capacity[idx]));
 	}
 
-	// sort machine indices in accordance with the nodes' total_membw_util
+	// sort machine indices in accordance with the nodes' load
 	std::vector<size_t> sorted_machine_idxs = machine_idxs;
-	std::sort(sorted_machine_idxs.begin(), sorted_machine_idxs.end(),
-			  [&total_membw_util, &reverse](size_t i1, size_t i2) {
-				  if (reverse) {
-					  return total_membw_util[i1] > total_membw_util[i2];
-				  }
-				  return total_membw_util[i1] < total_membw_util[i2];
-			  });
+	std::sort(sorted_machine_idxs.begin(), sorted_machine_idxs.end(), [&load, &reverse](size_t i1, size_t i2) {
+		if (reverse) {
+			return load[i1] > load[i2];
+		}
+		return load[i1] < load[i2];
+	});
 
 	return sorted_machine_idxs;
 }
 
+// machine indices sorted by the pressure of the jobs running on them, least pressure first.
+// Without PSI this is the identity.
+std::vector<size_t> multi_app_sched::sort_machines_by_pressure(const controllerT &controller) const {
+	std::vector<size_t> machine_idxs(controller.machines.size());
+	std::iota(machine_idxs.begin(), machine_idxs.end(), 0);
+	if (psi_monitor == nullptr) return machine_idxs;
+
+	std::vector<double> pressures;
+	pressures.reserve(machine_idxs.size());
+	for (const auto m : machine_idxs) {
+		const pressureT pressure = pressure_of_node(controller, m);
+		pressures.emplace_back(std::max({pressure.cpu, pressure.memory, pressure.io}));
+	}
+
+	std::stable_sort(machine_idxs.begin(), machine_idxs.end(),
+					 [&pressures](size_t i1, size_t i2) { return pressures[i1] < pressures[i2]; });
+	return machine_idxs;
+}
+
+// best fit bin packing of jobs smaller than a slot: the slot with the fewest CPUs left unused is preferred,
+// weighted with the dominant share of the resources of the node. Overloaded nodes are only used if no other
+// slot fits.
+std::pair<controllerT::execute_config_elemT, std::vector<size_t>>
+multi_app_sched::pack_job(const jobT &job, const controllerT &controller) const {
+	std::pair<controllerT::execute_config_elemT, std::vector<size_t>> best;
+	std::pair<bool, double> best_score{true, std::numeric_limits<double>::max()};
+	for (const size_t m : sort_machines_by_pressure(controller)) {
+		const resource_vectorT node_util = util_of_node(m);
+
+		for (size_t s = 0; s < system_config.slots.size(); ++s) {
+			const std::vector<size_t> free = controller.free_cores({m, s});
+			if (free.size() < job.req_cpus() || !controller.admits(m, job.memory)) continue;
+
+			const auto slot_size = static_cast<double>(controller.node_slots[m][s].cpus.size());
+			const double unused = (free.size() - job.req_cpus()) / slot_size;
+			const std::pair<bool, double> score{exceeds(node_util, threshold_of_node(m)),
+												unused + PACKING_LOAD_WEIGHT * dominant_share(node_util, capacity[m])};
+			if (score >= best_score) continue;
+
+			best_score = score;
+			best.first = {m, s};
+			best.second.assign(free.begin(), free.begin() + static_cast<long>(job.req_cpus()));
+		}
+	}
+
+	return best;
+}
+
+// machine indices sorted by the predicted slowdown of job and the jobs running on them, nodes without a
+// co-runner first followed by known good pairings, unknown pairings and refused pairings. Falls back to
+// sort_machines_by_pressure() without an interference model.
+std::vector<size_t> multi_app_sched::sort_machines_by_interference(const controllerT &controller,
+																   const jobT &job) const {
+	std::vector<size_t> machine_idxs = sort_machines_by_pressure(controller);
+	if (interference_model == nullptr) return machine_idxs;
+
+	std::vector<double> slowdowns(controller.machines.size(), 1.0);
+	for (const auto m : machine_idxs) {
+		for (const auto id : jobs_on_node(controller, m)) {
+			const double slowdown = predict_slowdown(job, controller.id_to_job[id]);
+			slowdowns[m] = std::max(slowdowns[m], slowdown == 0 ? UNKNOWN_PAIR_SLOWDOWN : slowdown);
+		}
+	}
+
+	std::stable_sort(machine_idxs.begin(), machine_idxs.end(),
+					 [&slowdowns](size_t i1, size_t i2) { return slowdowns[i1] < slowdowns[i2]; });
+	return machine_idxs;
+}
+
 // TODO move to base class
-std::vector<size_t> multi_app_sched::check_membw(const controllerT::execute_config &config) const {
+std::vector<size_t> multi_app_sched::check_resources(const controllerT &controller,
+													 const controllerT::execute_config &config) const {
 	std::vector<size_t> marked_machines;
 	for (const auto &c : config) {
-		// get membw
-		double membw = 0.0;
-		for (size_t s = 0; s < system_config.slots.size(); ++s) {
-			membw += membw_util[c.first][s];
+		// a known pair of jobs is judged by its interference instead of the additive resource model
+		const std::vector<size_t> ids = jobs_on_node(controller, c.first);
+		if (ids.size() == 2) {
+			const pairingT pairing = predict_pairing(controller.id_to_job[ids[0]], controller.id_to_job[ids[1]]);
+			if (pairing == pairingT::refused) marked_machines.push_back(c.first);
+			if (pairing != pairingT::unknown) continue;
 		}
 
-		// 	membw ok?
+		// 	resources ok?
 		// 		no -> mark it
-		if (membw > PER_MACHINE_TH) {
+		if (exceeds(util_of_node(c.first), threshold_of_node(c.first))) {
 			marked_machines.push_back(c.first);
 		}
 	}
 	return marked_machines;
 }
 
-// update membw_util in accordance with new_config
-void multi_app_sched::update_membw_util(const controllerT::execute_config &old_config,
-										const controllerT::execute_config &new_config) {
+// update util in accordance with new_config
+void multi_app_sched::update_util(const controllerT::execute_config &old_config,
+								  const controllerT::execute_config &new_config) {
 	assert(old_config.size() == new_config.size());
 
 	for (size_t idx = 0; idx < new_config.size(); ++idx) {
@@ -85,9 +179,11 @@ void multi_app_sched::update_membw_util(const controllerT::execute_config &old_c
 		size_t new_mach = new_config[idx].first;
 		size_t new_slot = new_config[idx].second;
 
-		std::swap(membw_util[old_mach][old_slot], membw_util[new_mach][new_slot]);
-		assert(membw_util_of_node(old_mach) < PER_MACHINE_TH);
-		assert(membw_util_of_node(new_mach) < PER_MACHINE_TH);
+		std::swap(util[old_mach][old_slot], util[new_mach][new_slot]);
+		assert(!exceeds(util_of_node(old_mach), threshold_of_node(old_mach)));
+		assert(!exceeds(util_of_node(new_mach), threshold_of_node(new_mach)));
+		publish_util(old_mach);
+		publish_util(new_mach);
 	}
 }
 
@@ -100,15 +196,15 @@ controllerT::execute_config multi_app_sched::generate_new_config(const controlle
 	}
 	assert(marked_machines.size() <= swap_candidates.size());
 
-	std::vector<size_t> marked_machines_sorted = sort_machines_by_membw_util(marked_machines, true);
+	std::vector<size_t> marked_machines_sorted = sort_machines_by_load(marked_machines, true);
 
 	// determine sorted swap config
 	//
 	// 	marked_machines are iterated in descending order with respect
-	// 	to their total_membw_util while the swap_candidates are iterated
+	// 	to their load while the swap_candidates are iterated
 	// 	in ascending order, i.e., we always match nodes with high
-	// 	total_membw_util to those we a low value. For each pair choose
-	// 	the swap slot such that the variance of the total_membw_util of
+	// 	load to those we a low value. For each pair choose
+	// 	the swap slot such that the variance of the load of
 	// 	the respective nodes is minimized (see below).
 	controllerT::execute_config new_config_sorted;
 	new_config_sorted.reserve(old_config.size());
@@ -124,24 +220,30 @@ controllerT::execute_config multi_app_sched::generate_new_config(const controlle
 
 		// determine 'optimal' slot on new_mach
 		//
-		// 	This is done by minimizing the total_membw_util
+		// 	This is done by minimizing the load
 		// 	variances of old_mach and new_mach, i.e., if the old
-		// 	slot exhibits the lower membw_util on old_mach, we
+		// 	slot exhibits the lower dominant share on old_mach, we
 		// 	should swap with the slot having the higher value on the
 		// 	new_mach and vice versa.
 		const size_t slots = system_config.slots.size();
-		std::vector<double>::const_iterator new_slot_it;
-		if (membw_util[old_mach][old_slot] <
-			membw_util[old_mach][(old_slot + 1) % slots]) { // TODO: what about more than 2 slots?
-			new_slot_it = std::max_element(membw_util[new_mach].begin(), membw_util[new_mach].end());
+		const auto by_share = [this, new_mach](const resource_vectorT &a, const resource_vectorT &b) {
+			return dominant_share(a, capacity[new_mach]) < dominant_share(b, capacity[new_mach]);
+		};
+		const resource_vectorT *new_slot_it;
+		if (dominant_share(util[old_mach][old_slot], capacity[old_mach]) <
+			dominant_share(util[old_mach][(old_slot + 1) % slots],
+						   capacity[old_mach])) { // TODO: what about more than 2 slots?
+			new_slot_it = std::max_element(util[new_mach].begin(), util[new_mach].end(), by_share);
 		} else {
-			new_slot_it = std::min_element(membw_util[new_mach].begin(), membw_util[new_mach].end());
+			new_slot_it = std::min_element(util[new_mach].begin(), util[new_mach].end(), by_share);
 		}
-		const auto new_slot = static_cast<size_t>(std::distance(membw_util[new_mach].begin(), new_slot_it));
-		assert(membw_util[old_mach][(old_slot + 1) % slots] + membw_util[new_mach][new_slot] < PER_MACHINE_TH);
-		assert(membw_util[new_mach][(new_slot + 1) % slots] + membw_util[old_mach][old_slot] < PER_MACHINE_TH);
+		const auto new_slot = static_cast<size_t>(std::distance(util[new_mach].begin(), new_slot_it));
+		assert(!exceeds(util[old_mach][(old_slot + 1) % slots] + util[new_mach][new_slot],
+						threshold_of_node(old_mach)));
+		assert(!exceeds(util[new_mach][(new_slot + 1) % slots] + util[old_mach][old_slot],
+						threshold_of_node(new_mach)));
 
-		new_config_sorted.emplace_back(new_mach, std::distance(membw_util[new_mach].begin(), new_slot_it));
+		new_config_sorted.emplace_back(new_mach, new_slot);
 	}
 	assert(new_config_sorted.size() == marked_machines.size());
 
@@ -162,31 +264,39 @@ controllerT::execute_config multi_app_sched::generate_new_config(const controlle
 
 // find nodes that are eligible to resolve the overload of marked_machines
 // 	assumptions: -- marked_machines are N overloaded nodes
-// 	             -- good candidates have a preferably low total_membw_util
-// 	condition  : we can only resolve the overload if the total_membw_util
-// 	             utilization of marked_machines and the swap candidates does
-// 	             not exceed N * PER_MACHINE_TH * 2
-// 	goal       : find the N nodes with lowest total_membw_util such that the
+// 	             -- good candidates have a preferably low load
+// 	condition  : we can only resolve the overload if the total usage of
+// 	             every resource of marked_machines and the swap candidates
+// 	             does not exceed the sum of their thresholds
+// 	goal       : find the N nodes with lowest load such that the
 // 	             condition is met
-std::vector<size_t> multi_app_sched::find_swap_candidates(const std::vector<size_t> &marked_machines) const {
+std::vector<size_t> multi_app_sched::find_swap_candidates(const controllerT &controller,
+															 const std::vector<size_t> &marked_machines) const {
 	// determine swap candidates
-	// -> sorted list of machine indices in accordance with membw_util
-	std::vector<size_t> swap_candidates(membw_util.size());
-	std::iota(swap_candidates.begin(), swap_candidates.end(), 0);
-	swap_candidates = sort_machines_by_membw_util(swap_candidates, false);
+	// -> sorted list of machine indices in accordance with their load, drained and removed machines
+	//    do not accept jobs
+	std::vector<size_t> swap_candidates;
+	for (size_t m = 0; m < util.size(); ++m) {
+		if (controller.admits(m, 0)) swap_candidates.push_back(m);
+	}
+	if (swap_candidates.size() < marked_machines.size()) return {};
+	swap_candidates = sort_machines_by_load(swap_candidates, false);
 
-	// calculate current total membw_util for all marked machines and
+	// calculate current total usage for all marked machines and
 	// swap candidates
-	double total_membw_util = 0;
+	resource_vectorT total_util;
+	resource_vectorT total_threshold;
 	for (size_t idx = 0; idx < marked_machines.size(); ++idx) {
-		total_membw_util += membw_util_of_node(marked_machines[idx]);
-		total_membw_util += membw_util_of_node(swap_candidates[idx]);
+		total_util += util_of_node(marked_machines[idx]);
+		total_util += util_of_node(swap_candidates[idx]);
+		total_threshold += threshold_of_node(marked_machines[idx]);
+		total_threshold += threshold_of_node(swap_candidates[idx]);
 	}
 
 	// are we able to find a new config?
-	// -> if the total sum of all membw_utils exceeds the some of all
+	// -> if the total sum of any resource exceeds the some of all
 	//    thresholds, a new config won't be able to resolve the overload
-	if (total_membw_util < PER_MACHINE_TH * marked_machines.size() * 2) {
+	if (!exceeds(total_util, total_threshold)) {
 		swap_candidates.resize(marked_machines.size());
 		return swap_candidates;
 	}
@@ -194,137 +304,583 @@ std::vector<size_t> multi_app_sched::find_swap_candidates(const std::vector<size
 	return {};
 }
 
+// try to resolve the overload of marked_machines by tightening the memory bandwidth allocation of
+// the noisier job on each machine. We assume the membw utilization to scale linearly with the MBA.
+// The throttles are planned for all machines first, i.e. no MBA is changed unless the whole overload is resolved.
+bool multi_app_sched::throttle_membw(controllerT &controller, const std::vector<size_t> &marked_machines) {
+	// MBA planned per job, in the order the jobs were throttled
+	std::vector<std::pair<size_t, unsigned int>> planned;
+	// membw of the slots before the plan, restored if it fails
+	std::vector<std::pair<controllerT::execute_config_elemT, double>> previous;
+	// machines of the jobs throttled so far
+	std::vector<size_t> throttled_machines;
+	const auto discard = [&] {
+		for (auto it = previous.rbegin(); it != previous.rend(); ++it) {
+			util[it->first.first][it->first.second].membw = it->second;
+		}
+		return false;
+	};
+
+	for (const auto m : marked_machines) {
+		const double node_util = util_of_node(m).membw;
+		const double threshold = threshold_of_node(m).membw;
+		if (node_util <= threshold) {
+			// MBA does not help with an overloaded NIC or I/O
+			if (exceeds(util_of_node(m), threshold_of_node(m))) return discard();
+			// marked for another reason than membw (e.g. a refused pairing or a slowed co-runner) unless resolved by
+			// throttling a job on a previous machine
+			if (std::find(throttled_machines.begin(), throttled_machines.end(), m) == throttled_machines.end()) {
+				return discard();
+			}
+			continue;
+		}
+
+		const auto noisy_it =
+			std::max_element(util[m].begin(), util[m].end(),
+							 [](const resource_vectorT &a, const resource_vectorT &b) { return a.membw < b.membw; });
+		const auto noisy_slot = static_cast<size_t>(std::distance(util[m].begin(), noisy_it));
+		const size_t noisy_id = controller.machine_usage[m][noisy_slot];
+		// the membw of a shared slot is not tracked per job
+		if (noisy_id == std::numeric_limits<size_t>::max() || noisy_id == controllerT::shared_slot) return discard();
+
+		// a job spanning several marked machines may be throttled again
+		auto plan = std::find_if(planned.begin(), planned.end(),
+								 [noisy_id](const std::pair<size_t, unsigned int> &p) { return p.first == noisy_id; });
+		const double factor = (noisy_it->membw - (node_util - threshold)) / noisy_it->membw;
+		const unsigned int cur_mba = plan == planned.end() ? controller.get_mba(noisy_id) : plan->second;
+		// MBA is applied in steps of 10 percent
+		const unsigned int new_mba = static_cast<unsigned int>(cur_mba * factor) / 10 * 10;
+		if (factor <= 0 || new_mba < MIN_MBA) return discard();
+
+		if (plan == planned.end()) {
+			planned.emplace_back(noisy_id, new_mba);
+		} else {
+			plan->second = new_mba;
+		}
+
+		const double applied = static_cast<double>(new_mba) / cur_mba;
+		for (const auto &c : controller.id_to_config[noisy_id]) {
+			previous.emplace_back(c, util[c.first][c.second].membw);
+			util[c.first][c.second].membw *= applied;
+			throttled_machines.push_back(c.first);
+		}
+	}
+
+	for (const auto &plan : planned) {
+		controller.set_mba(plan.first, plan.second);
+		throttled_jobs.insert(plan.first);
+		FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t throttled job-#" << std::to_string(plan.first) << " to "
+												   << plan.second << "% MBA";
+	}
+	for (const auto m : throttled_machines) {
+		publish_util(m);
+	}
+
+	return true;
+}
+
+// shift CPUs from a membw bound job to a compute bound co-runner on the same machine.
+// We assume the membw utilization of the compute bound job to scale linearly with its CPUs, while the
+// membw bound job keeps its utilization, i.e. the node must stay below the threshold with this estimate.
+// CPUs are moved as whole physical cores, i.e. with their SMT siblings as listed in the cores of the system config
+// of the node (generated by --topology). The increased estimate is kept once the controller resets the layout,
+// which is conservative.
+void multi_app_sched::rebalance_slots(controllerT &controller, const controllerT::execute_config &config) {
+	assert(controller.resize_supported());
+	if (system_config.slots.size() != 2) return;
+
+	for (const auto &c : config) {
+		const size_t m = c.first;
+		const auto &mu = controller.machine_usage[m];
+		if (mu[0] == std::numeric_limits<size_t>::max() || mu[1] == std::numeric_limits<size_t>::max()) continue;
+		if (mu[0] == mu[1]) continue;
+		if (mu[0] == controllerT::shared_slot || mu[1] == controllerT::shared_slot) continue;
+
+		const auto &layout = controller.node_slots[m];
+		const double per_cpu_0 = util[m][0].membw / layout[0].cpus.size();
+		const double per_cpu_1 = util[m][1].membw / layout[1].cpus.size();
+
+		// grow the slot with the compute bound job
+		const size_t grow = per_cpu_0 < per_cpu_1 ? 0 : 1;
+		const size_t shrink = 1 - grow;
+		if (std::min(per_cpu_0, per_cpu_1) * RESIZE_RATIO > std::max(per_cpu_0, per_cpu_1)) continue;
+
+		std::vector<slotT> new_layout = layout;
+		std::vector<unsigned int> &grow_cpus = new_layout[grow].cpus;
+		std::vector<unsigned int> &shrink_cpus = new_layout[shrink].cpus;
+		const auto min_cpus =
+			static_cast<size_t>(controller.node_config[m][shrink].cpus.size() * MIN_SLOT_FRACTION);
+
+		while (!shrink_cpus.empty()) {
+			// move the physical core of the highest CPU, a core split between the slots is not moved
+			const std::vector<unsigned int> core =
+				controller.node_config[m].core_of(*std::max_element(shrink_cpus.begin(), shrink_cpus.end()));
+			const bool whole = std::all_of(core.begin(), core.end(), [&](const unsigned int cpu) {
+				return std::find(shrink_cpus.begin(), shrink_cpus.end(), cpu) != shrink_cpus.end();
+			});
+			if (!whole || shrink_cpus.size() < min_cpus + core.size()) break;
+
+			const resource_vectorT new_util =
+				util[m][grow] * (static_cast<double>(grow_cpus.size() + core.size()) / layout[grow].cpus.size());
+			if (exceeds(new_util + util[m][shrink], threshold_of_node(m))) break;
+
+			for (const auto cpu : core) {
+				shrink_cpus.erase(std::find(shrink_cpus.begin(), shrink_cpus.end(), cpu));
+				grow_cpus.push_back(cpu);
+			}
+			std::sort(grow_cpus.begin(), grow_cpus.end());
+		}
+		if (grow_cpus.size() == layout[grow].cpus.size()) continue;
+
+		FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t resizing slots of " << controller.machines[m] << " to "
+												   << new_layout[0].cpus.size() << "/" << new_layout[1].cpus.size();
+		util[m][grow] = util[m][grow] * (static_cast<double>(grow_cpus.size()) / layout[grow].cpus.size());
+		publish_util(m);
+		controller.resize_slots(m, new_layout);
+	}
+}
+
+std::vector<size_t> multi_app_sched::jobs_on_node(const controllerT &controller, const size_t machine) const {
+	std::vector<size_t> ids;
+	for (size_t s = 0; s < system_config.slots.size(); ++s) {
+		for (const auto id : controller.domains_on({machine, s})) {
+			if (std::find(ids.begin(), ids.end(), id) == ids.end()) ids.push_back(id);
+		}
+	}
+	return ids;
+}
+
+// the utilization and co-runners of the nodes of every running job are observations for the threshold
+// tuner and the interference model
+void multi_app_sched::observe_nodes(const controllerT &controller) {
+	if (threshold_tuner == nullptr && interference_model == nullptr) return;
+
+	for (size_t m = 0; m < util.size(); ++m) {
+		const double utilization = util_of_node(m).membw / capacity[m].membw;
+		const std::vector<size_t> ids = jobs_on_node(controller, m);
+		for (const auto id : ids) {
+			observe_utilization(id, utilization);
+			for (const auto partner : ids) {
+				if (partner != id) observe_partner(id, controller.id_to_job[partner]);
+			}
+		}
+	}
+}
+
+void multi_app_sched::track_machines(const controllerT &controller) {
+	const size_t known = util.size();
+	util.resize(controller.machines.size(), system_config.slots.size());
+	capacity.resize(controller.machines.size());
+	for (size_t m = known; m < capacity.size(); ++m) {
+		capacity[m] = capacity_of(controller, m);
+	}
+}
+
+void multi_app_sched::report_load(controllerT &controller) const {
+	if (util.empty()) return;
+
+	double load = 0;
+	for (size_t m = 0; m < util.size(); ++m) {
+		load += dominant_share(util_of_node(m), capacity[m]);
+	}
+	controller.set_load(load / util.size());
+}
+
+void multi_app_sched::publish_util(const size_t machine) const {
+	if (metrics == nullptr) return;
+
+	const resource_vectorT node_util = util_of_node(machine);
+	metrics->set(node_gaugeT::membw, machine, node_util.membw);
+	metrics->set(node_gaugeT::net, machine, node_util.net);
+	metrics->set(node_gaugeT::io, machine, node_util.io);
+}
+
 // called after a command was completed
 void multi_app_sched::command_done(const size_t id, controllerT &controller) {
 	const auto &config = controller.id_to_config[id];
+	record_runtime(controller, id);
 
+	// the jobs throttled on the machines of the completed job get the MBA of their slots back
+	throttled_jobs.erase(id);
 	for (const auto &c : config) {
-		membw_util[c.first][c.second] = 0.0;
+		for (const auto other_id : jobs_on_node(controller, c.first)) {
+			if (throttled_jobs.erase(other_id) == 0) continue;
+
+			const double throttled_mba = controller.get_mba(other_id);
+			controller.set_mba(other_id, 0);
+			const double applied = controller.get_mba(other_id) / throttled_mba;
+			for (const auto &o : controller.id_to_config[other_id]) {
+				util[o.first][o.second].membw *= applied;
+				publish_util(o.first);
+			}
+			FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t restored the MBA of job-#" << other_id;
+		}
+	}
+
+	const auto share = id_to_share.find(id);
+	if (share != id_to_share.end()) {
+		const auto &c = config.front();
+		resource_vectorT &slot_util = util[c.first][c.second];
+		slot_util -= share->second;
+		slot_util.membw = std::max(0.0, slot_util.membw);
+		slot_util.net = std::max(0.0, slot_util.net);
+		slot_util.io = std::max(0.0, slot_util.io);
+		// avoid accumulating rounding errors once the slot is empty
+		if (controller.machine_usage[c.first][c.second] == std::numeric_limits<size_t>::max()) {
+			slot_util = resource_vectorT();
+		}
+		id_to_share.erase(share);
+		publish_util(c.first);
+		report_load(controller);
+		return;
 	}
+
+	for (const auto &c : config) {
+		util[c.first][c.second] = resource_vectorT();
+		publish_util(c.first);
+	}
+	report_load(controller);
 }
 
-void multi_app_sched::schedule(const job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
+static YAML::Node emit_resources(const resource_vectorT &resources) {
+	YAML::Node node;
+	node.push_back(resources.membw);
+	node.push_back(resources.net);
+	node.push_back(resources.io);
+	return node;
+}
+
+static resource_vectorT load_resources(const YAML::Node &node) {
+	resource_vectorT resources;
+	resources.membw = node[0].as<double>();
+	resources.net = node[1].as<double>();
+	resources.io = node[2].as<double>();
+	return resources;
+}
+
+YAML::Node multi_app_sched::decision_inputs(const controllerT &controller, const jobT &job) const {
+	YAML::Node node;
+	node["threshold"] = membw_threshold();
+	node["capacity"] = YAML::Node(YAML::NodeType::Sequence);
+	node["util"] = YAML::Node(YAML::NodeType::Sequence);
+	for (size_t m = 0; m < util.size(); ++m) {
+		node["capacity"].push_back(emit_resources(capacity[m]));
+		YAML::Node slots;
+		for (const auto &slot_util : util[m]) {
+			slots.push_back(emit_resources(slot_util));
+		}
+		node["util"].push_back(slots);
+	}
+	node["controller"] = controller.snapshot();
+
+	if (interference_model != nullptr) {
+		std::set<std::string> classes{interference_modelT::class_of(job)};
+		for (size_t m = 0; m < controller.machines.size(); ++m) {
+			for (const auto id : jobs_on_node(controller, m)) {
+				classes.insert(interference_modelT::class_of(controller.id_to_job[id]));
+			}
+		}
+		node["interference"] = interference_model->emit_classes(classes);
+	}
+	return node;
+}
+
+void multi_app_sched::restore_inputs(offline_controllerT &controller, const YAML::Node &record) {
+	controller.restore(record["controller"]);
+	set_membw_threshold(record["threshold"].as<double>());
+	if (record["interference"]) {
+		auto model = std::make_shared<interference_modelT>();
+		model->load(record["interference"]);
+		use_interference_model(model);
+	}
+
+	const YAML::Node &nodes = record["util"];
+	util.clear();
+	util.resize(nodes.size(), system_config.slots.size());
+	capacity.clear();
+	for (size_t m = 0; m < nodes.size(); ++m) {
+		capacity.push_back(load_resources(record["capacity"][m]));
+		for (size_t s = 0; s < nodes[m].size(); ++s) {
+			util[m][s] = load_resources(nodes[m][s]);
+		}
+	}
+	assert(util.size() == controller.machines.size());
+}
+
+void multi_app_sched::log_decision(YAML::Node &record, const std::chrono::steady_clock::duration latency) const {
+	if (decision_log == nullptr) return;
+
+	const auto now = std::chrono::system_clock::now().time_since_epoch();
+	record["time"] = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+	record["latency"] = std::chrono::duration<double>(latency).count();
+	decision_log->append(record);
+}
+
+controllerT::execute_config multi_app_sched::select_slots(const jobT &job, const controllerT &controller) const {
+	controllerT::execute_config config;
+	size_t cpus = 0;
+	for (const size_t m : sort_machines_by_interference(controller, job)) {
+		const auto &mu = controller.machine_usage[m];
+		if (!controller.admits(m, job.memory)) continue;
+
+		// TODO check distgen values here?
+		// -> don't use the ones that are already saturated?
+		// -> prioritize something else?
+
+		// pick one slot per machine
+		for (size_t s = 0; s < system_config.slots.size(); ++s) {
+			if (mu[s] == std::numeric_limits<size_t>::max()) {
+				config.emplace_back(m, s);
+				cpus += controller.node_slots[m][s].cpus.size();
+				break;
+			}
+		}
+		if (cpus >= job.req_cpus()) return config;
+	}
+	return controllerT::execute_config();
+}
+
+multi_app_sched::overload_decisionT multi_app_sched::decide_overload(controllerT &controller, const size_t job_id,
+																	 const controllerT::execute_config &config,
+																	 const std::vector<size_t> &slowed_machines) const {
+	overload_decisionT decision;
+
+	// for all host-id of new job
+	decision.marked_machines = check_resources(controller, config);
+	for (const auto m : slowed_machines) {
+		if (std::find(decision.marked_machines.begin(), decision.marked_machines.end(), m) ==
+			decision.marked_machines.end()) {
+			decision.marked_machines.push_back(m);
+		}
+	}
+
+	// everything fine?
+	if (decision.marked_machines.empty()) return decision;
+
+	decision.result = overloadT::unresolved;
+	if (!controller.update_supported()) return decision;
+
+	decision.swap_candidates = find_swap_candidates(controller, decision.marked_machines);
+	const controllerT::execute_config &old_config = controller.id_to_config[job_id];
+	decision.new_config = generate_new_config(old_config, decision.marked_machines, decision.swap_candidates);
+	if (!decision.new_config.empty()) {
+		assert(decision.new_config.size() == old_config.size());
+		decision.result = overloadT::swap;
+	}
+	return decision;
+}
+
+const char *multi_app_sched::name_of(const overloadT result) {
+	switch (result) {
+	case overloadT::none:
+		return "none";
+	case overloadT::swap:
+		return "swap";
+	case overloadT::unresolved:
+		return "unresolved";
+	}
+	return "";
+}
+
+void multi_app_sched::schedule(job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
 							   std::chrono::seconds wait_time) {
 
-	membw_util.resize(controller.machines.size(), std::vector<double>(system_config.slots.size(), 0));
+	if (decision_log != nullptr) {
+		YAML::Node session;
+		session["type"] = "session";
+		session["system-config"] = system_config;
+		session["capabilities"] = capabilities_of(controller);
+		decision_log->append(session);
+	}
+
+	track_machines(controller);
 
 	// for all commands
-	for (const auto &job : job_queue.jobs) {
-		assert(job.req_cpus() <= controller.machines.size() * controller.system_config.slot_size());
-		controller.wait_for_ressource(job.req_cpus(), 1);
+	size_t queue_id;
+	jobT job;
+	while (next_job(job_queue, controller, queue_id, job)) {
+		// jobs smaller than a slot share slots with other small jobs, the slots of the nodes may differ in size
+		bool subslot = false;
+		for (size_t m = 0; m < controller.machines.size() && controller.subslot_supported(); ++m) {
+			if (controller.removed[m]) continue;
+			for (const auto &slot : controller.node_slots[m]) {
+				subslot = subslot || job.req_cpus() < slot.cpus.size();
+			}
+		}
 
-		// select ressources
 		controllerT::execute_config config;
-		for (size_t m = 0; m < controller.machine_usage.size(); ++m) {
-			const auto &mu = controller.machine_usage[m];
-
-			// TODO check distgen values here?
-			// -> don't use the ones that are already saturated?
-			// -> prioritize something else?
-
-			// pick one slot per machine
-			for (size_t s = 0; s < system_config.slots.size(); ++s) {
-				if (mu[s] == std::numeric_limits<size_t>::max()) {
-					config.emplace_back(m, s);
-					break;
-				}
+		size_t job_id;
+		YAML::Node record;
+		if (subslot) {
+			controller.wait_for_cores(job.req_cpus(), job.memory);
+			const auto decision_start = std::chrono::steady_clock::now();
+			track_machines(controller);
+			if (decision_log != nullptr) record = decision_inputs(controller, job);
+			const auto packing = pack_job(job, controller);
+			assert(!packing.second.empty());
+
+			config.push_back(packing.first);
+			observe_latency(histogramT::placement_decision, decision_start);
+			if (decision_log != nullptr) {
+				record["type"] = "placement";
+				record["job"] = job;
+				record["config"] = config;
+				record["cores"] = packing.second;
+				log_decision(record, std::chrono::steady_clock::now() - decision_start);
+			}
+			job_id = controller.execute(job, packing.first, packing.second,
+										[&controller, &job_queue, this, queue_id](const size_t config) {
+											command_done(config, controller);
+											job_queue.finished(queue_id);
+										}, queue_id);
+		} else {
+			controller.wait_for_ressource(job.req_cpus(), 1, job.memory);
+			const auto decision_start = std::chrono::steady_clock::now();
+			track_machines(controller);
+			if (decision_log != nullptr) record = decision_inputs(controller, job);
+
+			// select ressources
+			config = select_slots(job, controller);
+			assert(!config.empty());
+			observe_latency(histogramT::placement_decision, decision_start);
+			if (decision_log != nullptr) {
+				record["type"] = "placement";
+				record["job"] = job;
+				record["config"] = config;
+				log_decision(record, std::chrono::steady_clock::now() - decision_start);
 			}
-			if (config.size() * controller.system_config.slot_size() == job.req_cpus()) break;
-		}
 
-		assert(config.size() * controller.system_config.slot_size() == job.req_cpus());
+			// start job
+			job_id = controller.execute(job, config, [&controller, &job_queue, this, queue_id](const size_t config) {
+				command_done(config, controller);
+				job_queue.finished(queue_id);
+			}, queue_id);
+		}
+		if (job_id == controllerT::not_started) {
+			FASTLIB_LOG(scheduler_multi_app_log, warn) << ">> \t '" << job << "' could not be started, it is queued again";
+			job_queue.requeue(queue_id, job);
+			continue;
+		}
 
-		// start job
-		auto job_id = controller.execute(
-			job, config, [&controller, this](const size_t config) { command_done(config, controller); });
 		FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t starting '" << job;
+		watch_pressure(controller, job_id);
+		watch_resources(controller, job_id);
+		observe_job(job_id);
+		const auto progress_before = corunner_progress(controller, job_id);
+		const auto started = std::chrono::steady_clock::now();
 
 		// for the initialization phase of the application to be completed
 		std::this_thread::sleep_for(wait_time);
+		observe_memory(controller, job_id);
 
-		// stop the opposing VM
-		controller.freeze_opposing(job_id);
-
-		// start distgen
-		auto distgen_res = schedulerT::run_distgen(comm, controller, job_id);
+		// measure the membw of the new job, the history is queried before it contains the measurement
+		const double predicted = predict_utilization(job);
+		auto distgen_res = schedulerT::measure_membw(comm, controller, job_id);
 		assert(distgen_res.size() == config.size());
 
+		// the NIC is shared by the whole machine, the job is charged what is not explained by the other slots
+		std::vector<resource_vectorT> measured;
 		for (size_t i = 0; i < distgen_res.size(); ++i) {
 			const auto &c = config[i];
-			assert(membw_util[c.first][c.second] == 0.0);
-			membw_util[c.first][c.second] = 1 - distgen_res[i];
+			resource_vectorT resources = sample_resources(controller, job_id, c.first);
+			resources.membw = (1 - distgen_res[i]) * capacity[c.first].membw;
+			resources.net = std::max(0.0, resources.net - util_of_node(c.first).net);
+			measured.push_back(resources);
 		}
 
-		{
-			// TODO move to function
-			double avg_membw = 0;
-			for (size_t i = 0; i < distgen_res.size(); ++i) {
-				avg_membw += 1 - distgen_res[i];
-			}
-			avg_membw /= distgen_res.size();
-
-			FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t job-#" << std::to_string(job_id)
-													   << " has an average membw util of " << std::to_string(avg_membw);
-			std::string str;
-
-			for (size_t i = 0; i < membw_util.size(); ++i) {
-				str += "(";
-				double sum = 0;
-				for (size_t s = 0; s < system_config.slots.size(); ++s) {
-					str += std::to_string(membw_util[i][s]);
-					if (s != system_config.slots.size() - 1) str += " + ";
-					sum += membw_util[i][s];
-				}
-				str += " = ";
-				str += std::to_string(sum);
-				str += ")";
-				if (i != membw_util.size() - 1) str += ", ";
+		if (subslot) {
+			// MBM measures the job itself, distgen everything running on the slot
+			const auto &c = config.front();
+			resource_vectorT share = measured.front();
+			if (mbm_monitor == nullptr) share.membw = std::max(0.0, share.membw - util[c.first][c.second].membw);
+			util[c.first][c.second] += share;
+			id_to_share[job_id] = share;
+		} else {
+			for (size_t i = 0; i < measured.size(); ++i) {
+				const auto &c = config[i];
+				assert(util[c.first][c.second].membw == 0.0);
+				util[c.first][c.second] = measured[i];
 			}
+		}
 
-			FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t membw-util: '" << str;
+		double avg_membw = 0;
+		for (const auto &m : measured) {
+			avg_membw += m.membw;
+		}
+		avg_membw /= measured.size();
+		FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t job-#" << std::to_string(job_id)
+												   << " has an average membw util of " << std::to_string(avg_membw);
+		if (predicted > 0) {
+			const double capacity = membw_capacity_of(controller, config.front().first);
+			FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t 95th percentile of earlier runs: "
+													   << std::to_string(predicted * capacity);
+		}
+		for (const auto &c : config) {
+			publish_util(c.first);
+		}
+
+		// stalls not caused by membw are not resolved by the scheduler, but should be visible
+		for (const auto &c : config) {
+			const pressureT pressure = pressure_of_node(controller, c.first);
+			if (std::max({pressure.cpu, pressure.memory, pressure.io}) > PSI_TH) {
+				FASTLIB_LOG(scheduler_multi_app_log, warn) << ">> \t high pressure on " << controller.machines[c.first]
+														   << ": " << pressure;
+			}
 		}
 
 		// TODO: How to handle jobs that need to run exclusively? (i.e.,
-		//       they already exceed the PER_MACHINE_TH)
+		//       they already exceed the membw threshold)
 		//       This should be done in find_swap_candidates.
 
-		// restart opposing VM
-		controller.thaw_opposing(job_id);
-
 		bool frozen = false;
 
-		while (true) {
-			// for all host-id of new job
-			const auto marked_machines = check_membw(config);
+		// co-runners that progress slower since the job started are treated as overloaded until the job is frozen
+		std::vector<size_t> slowed_machines = progress_loss(controller, job_id, progress_before, started);
 
-			// everything fine?
-			if (marked_machines.empty()) {
-				if (frozen) controller.thaw(job_id);
-				break;
+		while (true) {
+			YAML::Node record;
+			if (decision_log != nullptr) {
+				record = decision_inputs(controller, job);
+				record["type"] = "co-scheduling";
+				record["job-id"] = job_id;
+				record["config"] = config;
+				record["distgen-res"] = distgen_res;
+				record["slowed"] = slowed_machines;
 			}
 
-			if (controller.update_supported()) {
-				const std::vector<size_t> swap_candidates = find_swap_candidates(marked_machines);
-				controllerT::execute_config old_config = controller.id_to_config[job_id];
-				controllerT::execute_config new_config =
-					generate_new_config(old_config, marked_machines, swap_candidates);
-
-				if (!new_config.empty()) {
-					assert(new_config.size() == old_config.size());
-					// we need to thaw the job to be able to trigger the S/R protocol
-					if (frozen) controller.thaw(job_id);
+			const auto decision_start = std::chrono::steady_clock::now();
+			const overload_decisionT decision = decide_overload(controller, job_id, config, slowed_machines);
+			const auto latency = std::chrono::steady_clock::now() - decision_start;
+			observe_latency(histogramT::swap_decision, decision_start);
 
-					controller.update_config(job_id, new_config);
-					update_membw_util(old_config, new_config);
-					break;
-				}
-			}
+			// the action taken is only recorded, poncos_replay compares the decision
+			const char *action = "none";
+			bool resolved = true;
+			if (decision.result == overloadT::none) {
+				if (frozen) controller.thaw(job_id);
+				if (controller.resize_supported()) rebalance_slots(controller, config);
+			} else if (decision.result == overloadT::swap) {
+				action = "swap";
+				const controllerT::execute_config old_config = controller.id_to_config[job_id];
+				// we need to thaw the job to be able to trigger the S/R protocol
+				if (frozen) controller.thaw(job_id);
 
-			if (!frozen) {
+				controller.update_config(job_id, decision.new_config);
+				update_util(old_config, decision.new_config);
+			} else if (controller.mba_supported() && throttle_membw(controller, decision.marked_machines)) {
+				action = "throttle";
+				if (frozen) controller.thaw(job_id);
+			} else if (frozen) {
+				action = "wait";
+				resolved = false;
+			} else {
+				action = "freeze";
 				controller.freeze(job_id);
+				discard_observation(job_id);
 				FASTLIB_LOG(scheduler_multi_app_log, info) << ">> \t froze job #" << std::to_string(job_id)
 														   << " because some machines exceeded the threshhold.";
 				frozen = true;
+				slowed_machines.clear();
 
 				if (!controller.update_supported()) {
 					// ok, we had to freeze the current job and we cannot move it anywhere else
@@ -332,11 +888,11 @@ void multi_app_sched::schedule(const job_queueT &job_queue, fast::MQTT_communica
 					// on these machines is fine again and thaw the job
 					// TODO this has a big overlapp with the outer loop and is way to long for a lambda.
 					//      cleanup!!!
-					thread_pool.emplace_back(
+					std::thread(
 						[&controller, this, config](size_t job_id) {
 							while (true) {
 								controller.wait_for_change();
-								const auto marked_machines = check_membw(config);
+								const auto marked_machines = check_resources(controller, config);
 
 								// check if any nodes the job is using are part of marked_machines
 								bool ok = true;
@@ -356,13 +912,29 @@ void multi_app_sched::schedule(const job_queueT &job_queue, fast::MQTT_communica
 
 							controller.unlock();
 						},
-						job_id);
-					thread_pool[thread_pool.size() - 1].detach();
-					break;
+						job_id)
+						.detach();
+				} else {
+					resolved = false;
 				}
 			}
+
+			if (decision_log != nullptr) {
+				record["marked"] = decision.marked_machines;
+				record["candidates"] = decision.swap_candidates;
+				record["new-config"] = decision.new_config;
+				record["result"] = name_of(decision.result);
+				record["action"] = action;
+				log_decision(record, latency);
+			}
+			if (resolved) break;
+
 			controller.wait_for_change();
+			track_machines(controller);
 		}
+
+		observe_nodes(controller);
+		report_load(controller);
 	}
 
 	controller.done();
@@ -19,36 +19,51 @@ multi_app_sched_consec::multi_app_sched_consec(const system_configT &system_conf
 // called after a command was completed
 void multi_app_sched_consec::command_done(const size_t /*id*/, controllerT & /*controller*/) {}
 
-void multi_app_sched_consec::schedule(const job_queueT &job_queue, fast::MQTT_communicator & /*comm*/,
+void multi_app_sched_consec::schedule(job_queueT &job_queue, fast::MQTT_communicator & /*comm*/,
 									  controllerT &controller, std::chrono::seconds /*wait_time*/) {
 
 	const size_t slots = system_config.slots.size();
 
 	// for all commands
-	for (const auto &job : job_queue.jobs) {
-		assert(job.req_cpus() <= controller.machines.size() * controller.system_config.slot_size() * slots);
-		controller.wait_for_ressource(job.req_cpus(), slots);
+	size_t queue_id;
+	jobT job;
+	while (next_job(job_queue, controller, queue_id, job)) {
+		controller.wait_for_ressource(job.req_cpus(), slots, job.memory);
+		const auto decision_start = std::chrono::steady_clock::now();
 
 		// select ressources
 		controllerT::execute_config config;
+		size_t cpus = 0;
 		for (size_t m = 0; m < controller.machine_usage.size(); ++m) {
 			const auto &mu = controller.machine_usage[m];
 
 			// the same job should be running on all slots of a node
 			assert(mu[0] == mu[1]);
+			if (!controller.admits(m, job.memory)) continue;
 
 			// take all slots if empty
 			if (mu[0] == std::numeric_limits<size_t>::max()) {
 				for (size_t s = 0; s < slots; ++s) {
 					config.emplace_back(m, s);
+					cpus += controller.node_slots[m][s].cpus.size();
 				}
 			}
-			if (config.size() * controller.system_config.slot_size() >= job.req_cpus()) break;
+			if (cpus >= job.req_cpus()) break;
 		}
-		assert(config.size() * controller.system_config.slot_size() >= job.req_cpus());
+		assert(cpus >= job.req_cpus());
+		observe_latency(histogramT::placement_decision, decision_start);
 
 		// start job
-		controller.execute(job, config, [&](const size_t config) { command_done(config, controller); });
+		const size_t job_id = controller.execute(job, config, [&, queue_id](const size_t config) {
+			command_done(config, controller);
+			job_queue.finished(queue_id);
+		}, queue_id);
+		if (job_id == controllerT::not_started) {
+			FASTLIB_LOG(scheduler_multi_app_consec_log, warn) << ">> \t '" << job
+															  << "' could not be started, it is queued again";
+			job_queue.requeue(queue_id, job);
+			continue;
+		}
 		FASTLIB_LOG(scheduler_multi_app_consec_log, info) << ">> \t starting '" << job;
 	}
 
@@ -5,6 +5,7 @@
 #include <chrono>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 
 #include "poncos/controller.hpp"
 #include "poncos/job.hpp"
@@ -19,22 +20,62 @@ two_app_sched::two_app_sched(const system_configT &system_config)
 	  co_config_distgend(std::vector<double>(system_config.slots.size(), 0.0)) {}
 
 // called after a command was completed
-void two_app_sched::command_done(const size_t config, controllerT & /*controller*/) {
-	co_config_in_use[config] = false;
-	co_config_distgend[config] = 0;
+void two_app_sched::command_done(const size_t id, controllerT &controller) {
+	record_runtime(controller, id);
+
+	// all config elements of a job use the same slot
+	const size_t slot = controller.id_to_config[id].front().second;
+	co_config_in_use[slot] = false;
+	co_config_distgend[slot] = 0;
+}
+
+// CPUs of slot summed over all machines, the machines may provide slots of different sizes
+static size_t slot_cpus(const controllerT &controller, const size_t slot) {
+	size_t cpus = 0;
+	for (size_t m = 0; m < controller.machines.size(); ++m) {
+		cpus += controller.node_config[m].slots[slot].cpus.size();
+	}
+	return cpus;
+}
+
+std::string two_app_sched::layout_problem(const controllerT &controller) {
+	for (size_t s = 1; s < controller.system_config.slots.size(); ++s) {
+		if (slot_cpus(controller, s) == slot_cpus(controller, 0)) continue;
+		return "slot " + std::to_string(s) + " provides " + std::to_string(slot_cpus(controller, s)) +
+			   " CPUs on all machines, slot 0 provides " + std::to_string(slot_cpus(controller, 0));
+	}
+	return "";
+}
+
+std::string two_app_sched::reject_reason(const jobT &job, const controllerT &controller) const {
+	const std::string reason = schedulerT::reject_reason(job, controller);
+	if (!reason.empty()) return reason;
+
+	// all slots provide the same number of CPUs, see layout_problem()
+	const size_t cpus = slot_cpus(controller, 0);
+	if (job.req_cpus() != cpus) {
+		return std::to_string(job.req_cpus()) + " CPUs requested, jobs have to use one slot of every machine (" +
+			   std::to_string(cpus) + " CPUs)";
+	}
+	return "";
 }
 
-void two_app_sched::schedule(const job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
+void two_app_sched::schedule(job_queueT &job_queue, fast::MQTT_communicator &comm, controllerT &controller,
 							 std::chrono::seconds wait_time) {
 	// for all commands
-	for (const auto &job : job_queue.jobs) {
-		assert(job.req_cpus() == controller.machines.size() * controller.system_config.slot_size());
+	size_t queue_id;
+	jobT job;
+	while (next_job(job_queue, controller, queue_id, job)) {
+		assert(job.req_cpus() == slot_cpus(controller, 0));
 
-		controller.wait_for_ressource(job.req_cpus(), 1);
+		controller.wait_for_ressource(job.req_cpus(), 1, job.memory);
+		const auto decision_start = std::chrono::steady_clock::now();
 
 		// search for a free slot and assign it to a new job
 		size_t new_slot = 0;
 		size_t job_id = 0;
+		std::unordered_map<size_t, double> progress_before;
+		std::chrono::steady_clock::time_point started;
 		for (; new_slot < system_config.slots.size(); ++new_slot) {
 			if (!co_config_in_use[new_slot]) {
 				co_config_in_use[new_slot] = true;
@@ -44,48 +85,76 @@ void two_app_sched::schedule(const job_queueT &job_queue, fast::MQTT_communicato
 				for (size_t j = 0; j < controller.machines.size(); ++j) {
 					config.emplace_back(j, new_slot);
 				}
-
-				job_id =
-					controller.execute(job, config, [&](const size_t config) { command_done(config, controller); });
+				observe_latency(histogramT::placement_decision, decision_start);
+
+				job_id = controller.execute(job, config, [&, queue_id](const size_t config) {
+					command_done(config, controller);
+					job_queue.finished(queue_id);
+				}, queue_id);
+				if (job_id == controllerT::not_started) {
+					co_config_in_use[new_slot] = false;
+					break;
+				}
 
 				FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t starting '" << job << "' at configuration "
 														 << new_slot;
+				watch_pressure(controller, job_id);
+				observe_job(job_id);
+				progress_before = corunner_progress(controller, job_id);
+				started = std::chrono::steady_clock::now();
 
 				break;
 			}
 		}
 		assert(new_slot < system_config.slots.size());
+		if (job_id == controllerT::not_started) {
+			FASTLIB_LOG(scheduler_two_app_log, warn) << ">> \t '" << job << "' could not be started, it is queued again";
+			job_queue.requeue(queue_id, job);
+			continue;
+		}
 
 		// for the initialization phase of the application to be completed
 		std::this_thread::sleep_for(wait_time);
+		observe_memory(controller, job_id);
 
-		// check if two are running
-		if (co_config_in_use[0] && co_config_in_use[1]) {
-			FASTLIB_LOG(scheduler_two_app_log, debug) << "0: freezing old";
-			controller.freeze_opposing(job_id);
-		}
-
-		// measure distgen result
-		FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t Running distgend";
-		auto temp = run_distgen(comm, controller, job_id);
+		// measure membw, the opposing job is frozen if required by the measurement
+		FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t Measuring membw";
+		auto temp = measure_membw(comm, controller, job_id);
 		co_config_distgend[new_slot] = *std::max_element(temp.begin(), temp.end());
 
 		FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t Result for command '" << job
 												 << "' is: " << 1 - co_config_distgend[new_slot];
 
-		if (co_config_in_use[0] && co_config_in_use[1]) {
-			FASTLIB_LOG(scheduler_two_app_log, debug) << "0: thaw old";
-			controller.thaw_opposing(job_id);
+		// the co-runner may have completed while the new job was measured
+		const size_t other_id = controller.machine_usage[0][(new_slot + 1) % system_config.slots.size()];
+		if (co_config_in_use[0] && co_config_in_use[1] && controller.running(other_id)) {
+			const double total_usage = (1 - co_config_distgend[0]) + (1 - co_config_distgend[1]);
+			FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t Estimating total usage of " << total_usage;
+			observe_utilization(job_id, total_usage);
+			observe_utilization(other_id, total_usage);
+			observe_partner(job_id, controller.id_to_job[other_id]);
+			observe_partner(other_id, job);
+			if (psi_monitor != nullptr) {
+				for (size_t m = 0; m < controller.machines.size(); ++m) {
+					FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t Pressure on " << controller.machines[m] << ": "
+															 << pressure_of_node(controller, m);
+				}
+			}
 
-			FASTLIB_LOG(scheduler_two_app_log, info) << ">> \t Estimating total usage of "
-													 << (1 - co_config_distgend[0]) + (1 - co_config_distgend[1]);
+			// a known pair is judged by its interference instead of the additive membw model
+			const pairingT pairing = predict_pairing(job, controller.id_to_job[other_id]);
+			// the co-runner progressing slower is more reliable than any estimate
+			const bool overloaded =
+				!progress_loss(controller, job_id, progress_before, started).empty() ||
+				(pairing == pairingT::unknown ? total_usage > membw_threshold() : pairing == pairingT::refused);
 
-			if ((1 - co_config_distgend[0]) + (1 - co_config_distgend[1]) > 0.9) {
+			if (overloaded) {
 				FASTLIB_LOG(scheduler_two_app_log, info) << " -> we will run one";
 				FASTLIB_LOG(scheduler_two_app_log, debug) << "0: freezing new";
 				controller.freeze(job_id);
+				discard_observation(job_id);
 
-				controller.wait_for_ressource(job.req_cpus(), 1);
+				controller.wait_for_ressource(job.req_cpus(), 1, job.memory);
 
 				FASTLIB_LOG(scheduler_two_app_log, debug) << "0: thaw new";
 				controller.thaw(job_id);
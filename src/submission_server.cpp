@@ -0,0 +1,114 @@
+#include "poncos/submission_server.hpp"
+
+#include <exception>
+#include <sstream>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(submission_server_log, "submission-server")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(submission_server_log, info);
+
+YAML::Node submission_requestT::emit() const {
+	YAML::Node node;
+	node["task"] = task;
+	if (task == "submit") node["job"] = job;
+	if (task == "status") node["id"] = id;
+	if (task == "add-machine" || task == "remove-machine") node["machine"] = machine;
+	if (!tag.empty()) node["tag"] = tag;
+	node["reply-topic"] = reply_topic;
+	return node;
+}
+
+void submission_requestT::load(const YAML::Node &node) {
+	fast::load(task, node["task"]);
+	if (task == "submit") fast::load(job, node["job"]);
+	if (task == "status") fast::load(id, node["id"]);
+	if (task == "add-machine" || task == "remove-machine") fast::load(machine, node["machine"]);
+	fast::load(tag, node["tag"], std::string());
+	fast::load(reply_topic, node["reply-topic"], std::string("fast/poncos/submit/reply"));
+}
+
+YAML::Node submission_replyT::emit() const {
+	YAML::Node node;
+	if (!tag.empty()) node["tag"] = tag;
+	node["id"] = id;
+	node["status"] = status;
+	if (!reason.empty()) node["reason"] = reason;
+	return node;
+}
+
+void submission_replyT::load(const YAML::Node &node) {
+	fast::load(tag, node["tag"], std::string());
+	fast::load(id, node["id"]);
+	fast::load(status, node["status"]);
+	fast::load(reason, node["reason"], std::string());
+}
+
+submission_serverT::submission_serverT(std::shared_ptr<fast::MQTT_communicator> comm, job_queueT &job_queue,
+									   std::string topic)
+	: comm(std::move(comm)), job_queue(job_queue), topic(std::move(topic)) {}
+
+void submission_serverT::start() {
+	comm->add_subscription(topic, [this](std::string message) { receive(message); }, 2);
+}
+
+void submission_serverT::stop() { comm->remove_subscription(topic); }
+
+void submission_serverT::manage_machines(controllerT &_controller) { controller = &_controller; }
+
+void submission_serverT::check_jobs(std::function<std::string(const jobT &)> check) { job_check = std::move(check); }
+
+void submission_serverT::receive(const std::string &message) {
+	submission_requestT request;
+	submission_replyT reply;
+	reply.status = "unknown";
+	try {
+		request.from_string(message);
+	} catch (const std::exception &e) {
+		FASTLIB_LOG(submission_server_log, warn) << "Ignoring malformed request: " << e.what();
+		return;
+	}
+	reply.tag = request.tag;
+
+	if (request.task == "submit") {
+		if (job_check) reply.reason = job_check(request.job);
+		if (!reply.reason.empty()) {
+			reply.status = "rejected";
+			FASTLIB_LOG(submission_server_log, warn) << "Rejected job " << request.job << ": " << reply.reason;
+		} else if (!job_queue.submit(request.job, reply.id)) {
+			reply.status = "closed";
+		} else {
+			reply.status = "pending";
+			FASTLIB_LOG(submission_server_log, info) << "Submitted job " << reply.id << ": " << request.job;
+		}
+	} else if (request.task == "status") {
+		job_statusT status;
+		reply.id = request.id;
+		if (job_queue.status(request.id, status)) {
+			std::stringstream ss;
+			ss << status;
+			reply.status = ss.str();
+		}
+	} else if (request.task == "close") {
+		FASTLIB_LOG(submission_server_log, info) << "Closing the job queue";
+		job_queue.close();
+		reply.status = "closed";
+	} else if ((request.task == "add-machine" || request.task == "remove-machine") && controller == nullptr) {
+		reply.status = "refused";
+		reply.reason = "changing the machines is not enabled";
+		FASTLIB_LOG(submission_server_log, warn) << "Refusing to " << request.task << " " << request.machine;
+	} else if (request.task == "add-machine" || request.task == "remove-machine") {
+		FASTLIB_LOG(submission_server_log, info) << "Request to " << request.task << " " << request.machine;
+		if (request.task == "add-machine") {
+			controller->add_machine(request.machine);
+		} else {
+			controller->remove_machine(request.machine);
+		}
+		reply.status = "queued";
+	} else {
+		FASTLIB_LOG(submission_server_log, warn) << "Ignoring unknown task '" << request.task << "'";
+	}
+
+	comm->send_message(reply.to_string(), request.reply_topic, 2);
+}
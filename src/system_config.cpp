@@ -1,6 +1,7 @@
 #include "poncos/system_config.hpp"
 #include "poncos/poncos.hpp"
 
+#include <algorithm>
 #include <fstream>
 
 slotT::slotT(std::vector<unsigned int> cpus, std::vector<unsigned int> mems) : cpus(cpus), mems(mems) {}
@@ -9,12 +10,17 @@ YAML::Node slotT::emit() const {
 	YAML::Node node;
 	node["cpus"] = cpus;
 	node["mems"] = mems;
+	if (mba != 0) node["mba"] = mba;
+	if (!l3_mask.empty()) node["l3-mask"] = l3_mask;
 	return node;
 }
 
 void slotT::load(const YAML::Node &node) {
 	fast::load(cpus, node["cpus"]);
 	fast::load(mems, node["mems"]);
+	fast::load(mba, node["mba"], 0u);
+	fast::load(l3_mask, node["l3-mask"], std::string());
+	assert(mba <= 100);
 }
 
 system_configT::system_configT(std::vector<slotT> slots) : slots(std::move(slots)) {}
@@ -26,15 +32,35 @@ system_configT::system_configT(const std::string &config_filename) {
 YAML::Node system_configT::emit() const {
 	YAML::Node node;
 	node["slot-list"] = slots;
+	if (!cores.empty()) node["cores"] = cores;
 
 	return node;
 }
 
-void system_configT::load(const YAML::Node &node) { fast::load(slots, node["slot-list"]); }
+void system_configT::load(const YAML::Node &node) {
+	fast::load(slots, node["slot-list"]);
+	fast::load(cores, node["cores"], std::vector<std::vector<unsigned int>>());
+}
+
+std::vector<unsigned int> system_configT::core_of(const unsigned int cpu) const {
+	for (const auto &core : cores) {
+		if (std::find(core.begin(), core.end(), cpu) != core.end()) return core;
+	}
+	return {cpu};
+}
+
+bool system_configT::has_resctrl(void) const {
+	for (const auto &slot : slots) {
+		if (slot.has_resctrl()) return true;
+	}
+	return false;
+}
 
 std::ostream &operator<<(std::ostream &os, const slotT &slot) {
 	os << "cpus: " << slot.cpus << "; ";
 	os << "mems: " << slot.mems << "; ";
+	if (slot.mba != 0) os << "mba: " << slot.mba << "; ";
+	if (!slot.l3_mask.empty()) os << "l3-mask: " << slot.l3_mask << "; ";
 
 	return os;
 }
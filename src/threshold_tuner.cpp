@@ -0,0 +1,102 @@
+#include "poncos/threshold_tuner.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(threshold_tuner_log, "threshold-tuner")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(threshold_tuner_log, info);
+
+// number of recent runs used to fit the slowdown
+constexpr size_t RUN_WINDOW = 64;
+// runs (of commands executed at least twice) required before the threshold is adjusted
+constexpr size_t MIN_RUNS = 5;
+// largest change of the threshold per adjustment
+constexpr double MAX_STEP = 0.05;
+// minimal variance of the utilization of the runs to fit a slope
+constexpr double MIN_VARIANCE = 1e-4;
+
+threshold_tunerT::threshold_tunerT(double threshold, double target_efficiency, double min_threshold,
+								   double max_threshold)
+	: current_threshold(std::max(min_threshold, std::min(max_threshold, threshold))),
+	  target_efficiency(target_efficiency), min_threshold(min_threshold), max_threshold(max_threshold) {
+	assert(target_efficiency > 0 && target_efficiency <= 1);
+	assert(min_threshold <= max_threshold);
+}
+
+void threshold_tunerT::record(const std::string &command, double utilization, std::chrono::duration<double> runtime) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	runs.push_back({command, utilization, runtime.count()});
+	if (runs.size() > RUN_WINDOW) runs.pop_front();
+
+	auto iter = best_runtime.find(command);
+	if (iter == best_runtime.end()) {
+		best_runtime.emplace(command, runtime.count());
+	} else {
+		iter->second = std::min(iter->second, runtime.count());
+	}
+
+	adjust();
+}
+
+double threshold_tunerT::threshold() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return current_threshold;
+}
+
+void threshold_tunerT::adjust() {
+	// the slowdown is only known for commands that ran more than once
+	std::unordered_map<std::string, size_t> run_count;
+	for (const auto &run : runs) {
+		++run_count[run.command];
+	}
+
+	std::vector<std::pair<double, double>> samples;
+	for (const auto &run : runs) {
+		if (run_count[run.command] < 2) continue;
+		samples.emplace_back(run.utilization, run.runtime / best_runtime[run.command]);
+	}
+	if (samples.size() < MIN_RUNS) return;
+
+	// least squares fit of slowdown = a + b * utilization
+	double mean_u = 0;
+	double mean_s = 0;
+	for (const auto &sample : samples) {
+		mean_u += sample.first;
+		mean_s += sample.second;
+	}
+	mean_u /= samples.size();
+	mean_s /= samples.size();
+
+	double var_u = 0;
+	double cov = 0;
+	for (const auto &sample : samples) {
+		var_u += (sample.first - mean_u) * (sample.first - mean_u);
+		cov += (sample.first - mean_u) * (sample.second - mean_s);
+	}
+	var_u /= samples.size();
+	cov /= samples.size();
+	if (var_u < MIN_VARIANCE) return;
+
+	const double b = cov / var_u;
+	const double a = mean_s - b * mean_u;
+
+	// no measurable slowdown -> allow more co-location
+	double target = max_threshold;
+	if (b > 0) target = (1 / target_efficiency - a) / b;
+	target = std::max(min_threshold, std::min(max_threshold, target));
+
+	const double new_threshold =
+		current_threshold + std::max(-MAX_STEP, std::min(MAX_STEP, target - current_threshold));
+	if (std::abs(new_threshold - current_threshold) < 1e-3) return;
+
+	FASTLIB_LOG(threshold_tuner_log, info) << "adjusting membw threshold from " << current_threshold << " to "
+										   << new_threshold << " (slowdown = " << a << " + " << b
+										   << " * utilization, " << samples.size() << " runs)";
+	current_threshold = new_threshold;
+}
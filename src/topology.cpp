@@ -0,0 +1,239 @@
+#include "poncos/topology.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "poncos/poncos.hpp"
+
+// inititalize fast-lib log
+FASTLIB_LOG_INIT(topology_log, "topology")
+FASTLIB_LOG_SET_LEVEL_GLOBAL(topology_log, info);
+
+// parses lists in the sysfs format, e.g. "0-5,12-17"
+static std::vector<unsigned int> parse_list(const std::string &list) {
+	std::vector<unsigned int> ret;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		if (range.empty() || range == "\n") continue;
+
+		const auto dash = range.find('-');
+		const auto first = static_cast<unsigned int>(std::stoul(range.substr(0, dash)));
+		const auto last =
+			dash == std::string::npos ? first : static_cast<unsigned int>(std::stoul(range.substr(dash + 1)));
+		for (unsigned int i = first; i <= last; ++i) {
+			ret.push_back(i);
+		}
+	}
+	return ret;
+}
+
+static std::string read_line(const std::string &filename) {
+	std::ifstream file(filename);
+	std::string line;
+	std::getline(file, line);
+	return line;
+}
+
+static bool file_exists(const std::string &filename) { return std::ifstream(filename).good(); }
+
+slot_strategyT slot_strategy_from_string(const std::string &name) {
+	if (name == "per-socket") return slot_strategyT::per_socket;
+	if (name == "per-numa") return slot_strategyT::per_numa;
+	assert(name == "interleaved");
+	return slot_strategyT::interleaved;
+}
+
+topologyT::topologyT(const std::string &sysfs_root) {
+	const std::string cpu_root = sysfs_root + "/cpu";
+	const std::string node_root = sysfs_root + "/node";
+
+	assert(file_exists(cpu_root + "/online"));
+	for (const auto id : parse_list(read_line(cpu_root + "/online"))) {
+		const std::string cpu_path = cpu_root + "/cpu" + std::to_string(id);
+
+		cpu_infoT info;
+		info.id = id;
+		info.core = static_cast<unsigned int>(std::stoul(read_line(cpu_path + "/topology/core_id")));
+		info.package = static_cast<unsigned int>(std::stoul(read_line(cpu_path + "/topology/physical_package_id")));
+		info.node = 0;
+		info.l3 = info.package;
+
+		// the L3 is typically index3, but search all indices to be sure
+		for (size_t index = 0; file_exists(cpu_path + "/cache/index" + std::to_string(index) + "/level"); ++index) {
+			const std::string cache_path = cpu_path + "/cache/index" + std::to_string(index);
+			if (read_line(cache_path + "/level") != "3") continue;
+
+			// older kernels provide no id, use the first CPU sharing the cache instead
+			if (file_exists(cache_path + "/id")) {
+				info.l3 = static_cast<unsigned int>(std::stoul(read_line(cache_path + "/id")));
+			} else {
+				info.l3 = parse_list(read_line(cache_path + "/shared_cpu_list")).front();
+			}
+		}
+		cpus.push_back(info);
+	}
+	assert(!cpus.empty());
+
+	// NUMA nodes are optional, e.g. not available on kernels without NUMA support
+	if (file_exists(node_root + "/online")) {
+		for (const auto node : parse_list(read_line(node_root + "/online"))) {
+			for (const auto id : parse_list(read_line(node_root + "/node" + std::to_string(node) + "/cpulist"))) {
+				auto iter = std::find_if(cpus.begin(), cpus.end(), [id](const cpu_infoT &c) { return c.id == id; });
+				if (iter != cpus.end()) iter->node = node;
+			}
+		}
+	}
+
+	// group SMT siblings
+	std::map<std::pair<unsigned int, unsigned int>, std::vector<unsigned int>> siblings;
+	for (const auto &c : cpus) {
+		siblings[std::make_pair(c.package, c.core)].push_back(c.id);
+	}
+	for (const auto &s : siblings) {
+		cores.push_back(s.second);
+	}
+	std::sort(cores.begin(), cores.end());
+}
+
+const cpu_infoT &topologyT::cpu(const unsigned int id) const {
+	const auto iter = std::find_if(cpus.begin(), cpus.end(), [id](const cpu_infoT &c) { return c.id == id; });
+	assert(iter != cpus.end());
+	return *iter;
+}
+
+std::vector<unsigned int> topologyT::nodes_of(const std::vector<unsigned int> &cpu_ids) const {
+	std::set<unsigned int> nodes;
+	for (const auto id : cpu_ids) {
+		nodes.insert(cpu(id).node);
+	}
+	return std::vector<unsigned int>(nodes.begin(), nodes.end());
+}
+
+template <typename F> std::vector<std::vector<unsigned int>> topologyT::group_cores(F key) const {
+	std::map<unsigned int, std::vector<unsigned int>> groups;
+	for (const auto &core : cores) {
+		auto &group = groups[key(cpu(core.front()))];
+		group.insert(group.end(), core.begin(), core.end());
+	}
+
+	std::vector<std::vector<unsigned int>> ret;
+	for (auto &g : groups) {
+		std::sort(g.second.begin(), g.second.end());
+		ret.push_back(g.second);
+	}
+	return ret;
+}
+
+system_configT topologyT::generate(const slot_strategyT strategy, const size_t slots) const {
+	std::vector<slotT> slot_list;
+
+	switch (strategy) {
+	case slot_strategyT::per_socket:
+		for (const auto &group : group_cores([](const cpu_infoT &c) { return c.package; })) {
+			slot_list.emplace_back(group, nodes_of(group));
+		}
+		break;
+	case slot_strategyT::per_numa:
+		for (const auto &group : group_cores([](const cpu_infoT &c) { return c.node; })) {
+			slot_list.emplace_back(group, nodes_of(group));
+		}
+		break;
+	case slot_strategyT::interleaved: {
+		assert(slots > 0);
+		slot_list.resize(slots);
+
+		// split the cores of every L3 cache evenly between the slots
+		std::map<unsigned int, std::vector<std::vector<unsigned int>>> cores_per_l3;
+		for (const auto &core : cores) {
+			cores_per_l3[cpu(core.front()).l3].push_back(core);
+		}
+		for (const auto &l3 : cores_per_l3) {
+			const size_t share = l3.second.size() / slots;
+			if (l3.second.size() % slots != 0) {
+				FASTLIB_LOG(topology_log, warn) << "L3 " << l3.first << ": " << l3.second.size() % slots
+											  << " cores do not fit evenly into the slots and are left unused";
+			}
+
+			for (size_t s = 0; s < slots; ++s) {
+				for (size_t c = s * share; c < (s + 1) * share; ++c) {
+					slot_list[s].cpus.insert(slot_list[s].cpus.end(), l3.second[c].begin(), l3.second[c].end());
+				}
+			}
+		}
+		for (auto &slot : slot_list) {
+			std::sort(slot.cpus.begin(), slot.cpus.end());
+			slot.mems = nodes_of(slot.cpus);
+		}
+		break;
+	}
+	}
+
+	// the SMT siblings of the CPUs used by the slots
+	system_configT config(slot_list);
+	for (const auto &core : cores) {
+		for (const auto &slot : slot_list) {
+			if (std::find(slot.cpus.begin(), slot.cpus.end(), core.front()) == slot.cpus.end()) continue;
+			config.cores.push_back(core);
+			break;
+		}
+	}
+	return config;
+}
+
+std::vector<std::string> topologyT::validate(const system_configT &config) const {
+	std::vector<std::string> warnings;
+	std::map<unsigned int, size_t> cpu_to_slot;
+
+	for (size_t s = 0; s < config.slots.size(); ++s) {
+		const slotT &slot = config[s];
+		const std::string slot_name = "slot " + std::to_string(s) + ": ";
+
+		if (slot.cpus.size() != config.slot_size()) {
+			warnings.push_back(slot_name + "size differs from slot 0");
+		}
+
+		std::vector<unsigned int> known_cpus;
+		for (const auto id : slot.cpus) {
+			if (std::none_of(cpus.begin(), cpus.end(), [id](const cpu_infoT &c) { return c.id == id; })) {
+				warnings.push_back(slot_name + "CPU " + std::to_string(id) + " is not online");
+				continue;
+			}
+			known_cpus.push_back(id);
+
+			const auto iter = cpu_to_slot.find(id);
+			if (iter != cpu_to_slot.end()) {
+				warnings.push_back(slot_name + "CPU " + std::to_string(id) + " is also used by slot " +
+								   std::to_string(iter->second));
+			}
+			cpu_to_slot[id] = s;
+		}
+
+		// all memory nodes of the slot's CPUs should be listed in mems
+		for (const auto node : nodes_of(known_cpus)) {
+			if (std::find(slot.mems.begin(), slot.mems.end(), node) == slot.mems.end()) {
+				warnings.push_back(slot_name + "CPUs of NUMA node " + std::to_string(node) +
+								   " are used, but the node is missing in mems");
+			}
+		}
+	}
+
+	// hyperthreads of a core must not be split between slots
+	for (const auto &core : cores) {
+		const auto first = cpu_to_slot.find(core.front());
+		for (const auto id : core) {
+			const auto iter = cpu_to_slot.find(id);
+			if (first == cpu_to_slot.end() && iter == cpu_to_slot.end()) continue;
+			if (first == cpu_to_slot.end() || iter == cpu_to_slot.end() || iter->second != first->second) {
+				warnings.push_back("SMT siblings " + std::to_string(core.front()) + " and " + std::to_string(id) +
+								   " are not assigned to the same slot");
+			}
+		}
+	}
+
+	return warnings;
+}
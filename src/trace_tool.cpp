@@ -0,0 +1,146 @@
+/**
+ * Trace export
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ *
+ * Converts an event trace written with --trace into the Chrome trace event format, which can be opened with
+ * chrome://tracing or Perfetto, or summarizes the time spent waiting, frozen, migrating and measuring per job. Usage:
+ *
+ *   poncos_trace <trace> [<output.json>]
+ *   poncos_trace --summary <trace>
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "poncos/event_trace.hpp"
+
+[[noreturn]] static void print_help(const char *argv) {
+	std::cerr << "usage: " << argv << " <trace> [<output.json>]\n";
+	std::cerr << "       " << argv << " --summary <trace>\n";
+	exit(1);
+}
+
+struct job_summaryT {
+	// start of the pending interval in ns, 0 if there is none
+	uint64_t submitted = 0;
+	uint64_t started = 0;
+	uint64_t frozen_since = 0;
+	uint64_t migrating_since = 0;
+	uint64_t measuring_since = 0;
+
+	double waiting = 0;
+	double runtime = 0;
+	double frozen = 0;
+	double migrating = 0;
+	double measuring = 0;
+	size_t freezes = 0;
+	size_t migrations = 0;
+};
+
+// seconds elapsed since begin, begin is reset
+static double elapsed(uint64_t &begin, const uint64_t end) {
+	if (begin == 0) return 0;
+	const double ret = static_cast<double>(end - begin) / 1e9;
+	begin = 0;
+	return ret;
+}
+
+static void summarize(const std::vector<eventT> &events) {
+	// submissions carry the id of the job queue, the start of the job carries it in peer
+	std::map<uint64_t, uint64_t> started_as;
+	for (const auto &event : events) {
+		if (event.type == event_typeT::job_started && event.peer != event_traceT::none) {
+			started_as[event.peer] = event.id;
+		}
+	}
+
+	std::map<uint64_t, job_summaryT> jobs;
+	for (const auto &event : events) {
+		if (event.type == event_typeT::resize_started || event.type == event_typeT::resize_finished) continue;
+		// jobs never started are not listed
+		if (event.type == event_typeT::job_submitted && started_as.count(event.id) == 0) continue;
+
+		// 0 marks a missing begin, i.e. events at time 0 are moved by 1 ns
+		const uint64_t time = event.time == 0 ? 1 : event.time;
+		job_summaryT &job = jobs[event.type == event_typeT::job_submitted ? started_as[event.id] : event.id];
+		switch (event.type) {
+		case event_typeT::job_submitted:
+			job.submitted = time;
+			break;
+		case event_typeT::job_started:
+			job.waiting += elapsed(job.submitted, time);
+			job.started = time;
+			break;
+		case event_typeT::job_finished:
+			job.runtime += elapsed(job.started, time);
+			break;
+		case event_typeT::job_frozen:
+			job.frozen_since = time;
+			++job.freezes;
+			break;
+		case event_typeT::job_thawed:
+			job.frozen += elapsed(job.frozen_since, time);
+			break;
+		case event_typeT::migration_started:
+			job.migrating_since = time;
+			++job.migrations;
+			break;
+		case event_typeT::migration_finished:
+			job.migrating += elapsed(job.migrating_since, time);
+			break;
+		case event_typeT::measurement_started:
+			job.measuring_since = time;
+			break;
+		case event_typeT::measurement_finished:
+			job.measuring += elapsed(job.measuring_since, time);
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::cout << std::left << std::setw(8) << "job" << std::setw(12) << "waiting" << std::setw(12) << "runtime"
+			  << std::setw(12) << "frozen" << std::setw(10) << "freezes" << std::setw(12) << "migrating"
+			  << std::setw(12) << "migrations"
+			  << "measuring\n";
+	std::cout << std::fixed << std::setprecision(3);
+	for (const auto &job : jobs) {
+		const job_summaryT &s = job.second;
+		std::cout << std::setw(8) << job.first << std::setw(12) << s.waiting << std::setw(12) << s.runtime
+				  << std::setw(12) << s.frozen << std::setw(10) << s.freezes << std::setw(12) << s.migrating
+				  << std::setw(12) << s.migrations << s.measuring << "\n";
+	}
+}
+
+int main(int argc, char const *argv[]) {
+	if (argc < 2 || argc > 3) print_help(argv[0]);
+
+	const std::string arg(argv[1]);
+	if (arg == "--summary") {
+		if (argc != 3) print_help(argv[0]);
+		summarize(event_traceT::read(argv[2]));
+		return 0;
+	}
+
+	const auto events = event_traceT::read(arg);
+	if (argc == 2) {
+		event_traceT::export_chrome(events, std::cout);
+		return 0;
+	}
+
+	std::ofstream out(argv[2]);
+	if (!out.good()) {
+		std::cerr << "cannot write " << argv[2] << "\n";
+		return 1;
+	}
+	event_traceT::export_chrome(events, out);
+	return 0;
+}
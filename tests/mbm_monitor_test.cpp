@@ -0,0 +1,74 @@
+/**
+ * Tests of the MBM window computation against a mock resctrl tree
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "mock_tree.hpp"
+#include "poncos/mbm_monitor.hpp"
+
+constexpr std::chrono::milliseconds WINDOW(100);
+constexpr double PEAK_BW = 1e7;
+
+static void set_counters(const mock_treeT &tree, const std::string &group, const unsigned long long bytes) {
+	// the bytes are split between two L3 domains
+	tree.write("node0/" + group + "/mon_data/mon_L3_00/mbm_total_bytes", std::to_string(bytes / 4));
+	tree.write("node0/" + group + "/mon_data/mon_L3_01/mbm_total_bytes", std::to_string(bytes - bytes / 4));
+}
+
+// the bandwidth is the counter difference over the samples spanning the window, the samples are taken by poll() and
+// bandwidth() waits until a full window is covered
+static void test_window(const mock_treeT &tree) {
+	set_counters(tree, "poncos_1", 1000);
+	mbm_monitorT monitor(resctrlT(tree.root + "/%h"), PEAK_BW, WINDOW);
+	monitor.watch("node0", "poncos_1");
+
+	set_counters(tree, "poncos_1", 1000 + 1000000);
+	const auto start = std::chrono::steady_clock::now();
+	const double bandwidth = monitor.bandwidth("node0", "poncos_1");
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// the first sample was taken right before start
+	CHECK(bandwidth <= 1e6 / std::chrono::duration<double>(WINDOW).count());
+	CHECK(bandwidth >= 1e6 / (elapsed.count() + 0.05));
+	CHECK(monitor.utilization("node0", "poncos_1") == bandwidth / PEAK_BW);
+
+	// the window slides, i.e. a group without traffic drops to zero once the old samples left the window
+	for (int i = 0; i < 4; ++i) {
+		std::this_thread::sleep_for(WINDOW / 2);
+		monitor.poll();
+	}
+	CHECK(monitor.bandwidth("node0", "poncos_1") == 0.0);
+}
+
+// recreated groups start with reset counters, removed or missing groups have no bandwidth
+static void test_reset(const mock_treeT &tree) {
+	set_counters(tree, "poncos_2", 5000000);
+	mbm_monitorT monitor(resctrlT(tree.root + "/%h"), PEAK_BW, WINDOW);
+	monitor.watch("node0", "poncos_2");
+
+	set_counters(tree, "poncos_2", 100);
+	std::this_thread::sleep_for(WINDOW);
+	monitor.poll();
+	CHECK(monitor.bandwidth("node0", "poncos_2") == 0.0);
+
+	tree.remove("node0/poncos_2");
+	monitor.poll();
+	CHECK(monitor.bandwidth("node0", "poncos_2") == 0.0);
+	CHECK(monitor.bandwidth("node0", "poncos_3") == 0.0);
+}
+
+int main() {
+	const mock_treeT tree;
+	test_window(tree);
+	test_reset(tree);
+	return 0;
+}
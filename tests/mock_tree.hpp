@@ -0,0 +1,73 @@
+/**
+ * Poor mans scheduler
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncos_tests_mock_tree
+#define poncos_tests_mock_tree
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// fails the test with the location of the failed condition, also in release builds
+#define CHECK(cond)                                                                                                   \
+	do {                                                                                                              \
+		if (!(cond)) {                                                                                                \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << std::endl;                    \
+			std::exit(EXIT_FAILURE);                                                                                  \
+		}                                                                                                             \
+	} while (false)
+
+#define CHECK_NEAR(a, b, eps) CHECK(std::fabs((a) - (b)) <= (eps))
+
+// Mock of the file systems of the nodes (resctrl, cgroup) in a temporary directory, removed with the object
+class mock_treeT {
+  public:
+	mock_treeT() {
+		char dir_template[] = "/tmp/poncos_test_XXXXXX";
+		CHECK(mkdtemp(dir_template) != nullptr);
+		root = dir_template;
+	}
+	~mock_treeT() {
+		nftw(root.c_str(), [](const char *path, const struct stat *, int, struct FTW *) { return ::remove(path); }, 16,
+			 FTW_DEPTH | FTW_PHYS);
+	}
+
+	// writes content to the file at path (relative to the root), missing directories are created
+	void write(const std::string &path, const std::string &content) const {
+		mkdirs(path.substr(0, path.rfind('/')));
+		std::ofstream file(root + "/" + path);
+		CHECK(file.is_open());
+		file << content;
+	}
+
+	// creates the directory at path (relative to the root) and its parents
+	void mkdirs(const std::string &path) const {
+		for (size_t pos = 0; pos != std::string::npos;) {
+			pos = path.find('/', pos + 1);
+			mkdir((root + "/" + path.substr(0, pos)).c_str(), 0755);
+		}
+	}
+
+	void remove(const std::string &path) const {
+		nftw((root + "/" + path).c_str(),
+			 [](const char *file, const struct stat *, int, struct FTW *) { return ::remove(file); }, 16,
+			 FTW_DEPTH | FTW_PHYS);
+	}
+
+	std::string root;
+};
+
+#endif /* end of include guard: poncos_tests_mock_tree */
@@ -0,0 +1,86 @@
+/**
+ * Tests of the PSI averages against a mock cgroup tree
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <chrono>
+#include <string>
+
+#include "mock_tree.hpp"
+#include "poncos/psi_monitor.hpp"
+
+constexpr double ALPHA = 0.5;
+
+// writes the pressure files of a cgroup, the "full" line must be ignored
+static void set_totals(const mock_treeT &tree, const std::string &group, const unsigned long long cpu,
+					   const unsigned long long memory, const unsigned long long io) {
+	const auto content = [](const unsigned long long total) {
+		return "some avg10=12.00 avg60=1.00 avg300=0.10 total=" + std::to_string(total) + "\n" +
+			   "full avg10=0.00 avg60=0.00 avg300=0.00 total=999999999999\n";
+	};
+	tree.write("node0/" + group + "/cpu.pressure", content(cpu));
+	tree.write("node0/" + group + "/memory.pressure", content(memory));
+	tree.write("node0/" + group + "/io.pressure", content(io));
+}
+
+// the stall fraction is the increase of total over the elapsed time (capped at 1), averaged with weight alpha
+static void test_ewma(const mock_treeT &tree) {
+	set_totals(tree, "job_1", 100, 100, 100);
+	psi_monitorT monitor(tree.root + "/%h", std::chrono::milliseconds(100), ALPHA);
+	monitor.watch("node0", "job_1");
+
+	pressureT pressure = monitor.pressure("node0", "job_1");
+	CHECK(pressure.cpu == 0.0 && pressure.memory == 0.0 && pressure.io == 0.0);
+
+	// cpu stalls far longer than the elapsed time, memory and io not at all
+	set_totals(tree, "job_1", 100 + 1000000000000ull, 100, 100);
+	monitor.poll();
+	pressure = monitor.pressure("node0", "job_1");
+	CHECK_NEAR(pressure.cpu, ALPHA, 1e-9);
+	CHECK(pressure.memory == 0.0 && pressure.io == 0.0);
+
+	// no new stalls, the average decays
+	monitor.poll();
+	pressure = monitor.pressure("node0", "job_1");
+	CHECK_NEAR(pressure.cpu, ALPHA * (1 - ALPHA), 1e-9);
+
+	// a reset counter does not count as a stall
+	set_totals(tree, "job_1", 0, 0, 0);
+	monitor.poll();
+	pressure = monitor.pressure("node0", "job_1");
+	CHECK_NEAR(pressure.cpu, ALPHA * (1 - ALPHA) * (1 - ALPHA), 1e-9);
+}
+
+// cgroups without a "some" line or that were removed are not watched
+static void test_missing(const mock_treeT &tree) {
+	psi_monitorT monitor(tree.root + "/%h", std::chrono::milliseconds(100), ALPHA);
+
+	set_totals(tree, "job_2", 100, 100, 100);
+	tree.write("node0/job_2/io.pressure", "full avg10=0.00 avg60=0.00 avg300=0.00 total=100\n");
+	monitor.watch("node0", "job_2");
+	set_totals(tree, "job_2", 100 + 1000000000000ull, 100, 100);
+	monitor.poll();
+	CHECK(monitor.pressure("node0", "job_2").cpu == 0.0);
+
+	set_totals(tree, "job_3", 100, 100, 100);
+	monitor.watch("node0", "job_3");
+	set_totals(tree, "job_3", 100 + 1000000000000ull, 100, 100);
+	monitor.poll();
+	CHECK(monitor.pressure("node0", "job_3").cpu > 0.0);
+
+	tree.remove("node0/job_3");
+	monitor.poll();
+	CHECK(monitor.pressure("node0", "job_3").cpu == 0.0);
+}
+
+int main() {
+	const mock_treeT tree;
+	test_ewma(tree);
+	test_missing(tree);
+	return 0;
+}
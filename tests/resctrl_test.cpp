@@ -0,0 +1,65 @@
+/**
+ * Tests of the resctrl wrapper against a mock resctrl tree
+ *
+ * Copyright 2017 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU General Public License 2.0 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "mock_tree.hpp"
+#include "poncos/resctrl.hpp"
+
+static std::string read(const std::string &path) {
+	std::ifstream file(path);
+	std::stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+// the kernel aligns the resources of the root schemata with leading spaces
+static void test_schemata(const mock_treeT &tree) {
+	tree.write("node0/schemata", "    L3:0=fff;1=fff\n    MB:0=100;1=100\n");
+	const resctrlT resctrl(tree.root + "/%h");
+
+	CHECK(resctrl.generate_schemata("node0", 50, "f0") == "L3:0=f0;1=f0\nMB:0=50;1=50\n");
+	CHECK(resctrl.generate_schemata("node0", 0, "f0") == "L3:0=f0;1=f0\n");
+	CHECK(resctrl.generate_schemata("node0", 0, "").empty());
+
+	resctrl.create_group("node0", "poncos_1", resctrl.generate_schemata("node0", 50, ""));
+	CHECK(resctrl.group_exists("node0", "poncos_1"));
+	CHECK(read(resctrl.group_path("node0", "poncos_1") + "/schemata") == "MB:0=50;1=50\n");
+
+	resctrl.write_schemata("node0", "poncos_1", resctrl.generate_schemata("node0", 100, ""));
+	CHECK(read(resctrl.group_path("node0", "poncos_1") + "/schemata") == "MB:0=100;1=100\n");
+
+	resctrl.remove_group("node0", "poncos_1");
+	CHECK(!resctrl.group_exists("node0", "poncos_1"));
+}
+
+// the counters of all L3 domains of a group are summed up, other monitoring directories are ignored
+static void test_mbm(const mock_treeT &tree) {
+	tree.write("node1/poncos_2/mon_data/mon_L3_00/mbm_total_bytes", "1000\n");
+	tree.write("node1/poncos_2/mon_data/mon_L3_00/mbm_local_bytes", "600\n");
+	tree.write("node1/poncos_2/mon_data/mon_L3_01/mbm_total_bytes", "234\n");
+	tree.write("node1/poncos_2/mon_data/mon_L3_01/mbm_local_bytes", "34\n");
+	tree.write("node1/poncos_2/mon_data/mon_MB_00/mbm_total_bytes", "99999\n");
+	const resctrlT resctrl(tree.root + "/%h");
+
+	CHECK(resctrl.group_exists("node1", "poncos_2"));
+	CHECK(!resctrl.group_exists("node0", "poncos_2"));
+	CHECK(resctrl.mbm_bytes("node1", "poncos_2", "mbm_total_bytes") == 1234);
+	CHECK(resctrl.mbm_bytes("node1", "poncos_2", "mbm_local_bytes") == 634);
+}
+
+int main() {
+	const mock_treeT tree;
+	test_schemata(tree);
+	test_mbm(tree);
+	return 0;
+}